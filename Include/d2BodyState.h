@@ -0,0 +1,51 @@
+/**************************************************************************************\
+** File: d2BodyState.h
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Header file for batch body state queries
+**
+\**************************************************************************************/
+#pragma once
+namespace d2d
+{
+	//+--------------------------------\--------------------------------------
+	//|			  BodyStates		   |
+	//\--------------------------------/
+	//	Batch version of CalculateKineticEnergy for systems that query many
+	//	bodies every tick. GatherBodyStates copies each body's mass, inertia,
+	//	linear velocity and angular velocity into one array per field, and
+	//	the queries below run over those arrays with SIMD. Gather once per
+	//	tick, after the world step, and run as many queries as needed on the
+	//	result. A null body gathers as all zeros, like CalculateKineticEnergy.
+	//
+	//	Each output span must hold states.GetSize() values; value i is for
+	//	states.bodies[i].
+	//------------------------------------------------------------------------
+	struct BodyStates
+	{
+		std::vector<b2Body*> bodies;
+		std::vector<float> masses;
+		std::vector<float> inertias;
+		std::vector<float> velocityXs;
+		std::vector<float> velocityYs;
+		std::vector<float> angularVelocities;
+
+		size_t GetSize() const { return bodies.size(); }
+	};
+	void GatherBodyStates(std::span<b2Body* const> bodies, BodyStates& statesOut);
+
+	// Linear plus rotational kinetic energy
+	void CalculateKineticEnergies(const BodyStates& states, std::span<float> energiesOut);
+
+	// Magnitude of linear momentum
+	void CalculateMomenta(const BodyStates& states, std::span<float> momentaOut);
+
+	// Magnitude of linear velocity
+	void CalculateSpeeds(const BodyStates& states, std::span<float> speedsOut);
+
+	// Replaces bodiesOut with the bodies whose kinetic energy is above
+	//	threshold, in gathered order
+	void FindBodiesAboveKineticEnergy(const BodyStates& states, float threshold, std::vector<b2Body*>& bodiesOut);
+}
@@ -29,6 +29,33 @@ namespace d2d
 	Color operator*(float left, const Color& right);
 	Color operator*(const Color& left, const Color& right);
 
+	// out[i] = Lerp(a[i], b[i], percentB[i]), clamped to valid color values.
+	//	All spans must be the same size. Vectorized with SSE2/AVX when available.
+	void LerpColors(std::span<const Color> a, std::span<const Color> b,
+		std::span<const float> percentB, std::span<Color> out);
+
+	//+----------------\------------------------------------------
+	//|	    Color32	   |
+	//\----------------/
+	//	Packed 8-bit color for vertex data. Bytes are laid out red, green,
+	//	blue, alpha, which matches GL_RGBA / GL_UNSIGNED_BYTE color arrays.
+	//------------------------------------------------------------
+	struct Color32
+	{
+		Uint8 red{};
+		Uint8 green{};
+		Uint8 blue{};
+		Uint8 alpha{};
+
+		Color32() = default;
+		Color32(Uint8 r, Uint8 g, Uint8 b, Uint8 a = 255);
+		explicit Color32(const Color& color);
+		Color ToColor() const;
+	};
+	static_assert(sizeof(Color32) == 4, "Color32 must stay tightly packed for vertex arrays");
+	bool operator==(const Color32& left, const Color32& right);
+	bool operator!=(const Color32& left, const Color32& right);
+
 	inline const Color WHITE_OPAQUE{ 1.0f,1.0f,1.0f,1.0f };
 	inline const Color COLOR_ZERO{ 0.0f,0.0f,0.0f,0.0f };
 	inline const Color BLACK_OPAQUE{ 0.0f,0.0f,0.0f,1.0f };
@@ -44,5 +71,9 @@ namespace d2d
 		ColorRange(const Color& min, const Color& max);
 		void Set(const Color& min, const Color& max);
 		Color Lerp(float percentMax) const;
+
+		// out[i] = Color32{ Lerp(percentMax[i]) }. Spans must be the same size.
+		//	Converts four colors per SSE2 iteration when available.
+		void LerpMany(std::span<const float> percentMax, std::span<Color32> out) const;
 	};
 }
@@ -0,0 +1,33 @@
+/**************************************************************************************\
+** File: d2Compression.h
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Header file for LZ compression functions
+**
+\**************************************************************************************/
+#pragma once
+namespace d2d
+{
+	//+--------------------------------\--------------------------------------
+	//|			LZ compression		   |
+	//\--------------------------------/
+	//	A fast byte-oriented LZ77 codec using the LZ4 block format: sequences
+	//	of literal runs and (offset, length) matches within a 64 KiB window,
+	//	found with a single-probe hash table. The compressed data does not
+	//	record its own size, so the caller must store it for decompression.
+	//	DecompressLZ checks every length and offset, and throws
+	//	CompressionException on corrupt input. It also refuses sizes above
+	//	MAX_DECOMPRESSED_BYTES before allocating, so a corrupt size field
+	//	cannot make it reserve gigabytes.
+	//------------------------------------------------------------------------
+	const size_t MAX_DECOMPRESSED_BYTES{ 16 * 1024 * 1024 };
+	size_t GetMaxCompressedSize(size_t numBytes);
+
+	// Appends the compressed data to out and returns the number of bytes appended
+	size_t CompressLZ(std::span<const Uint8> data, std::vector<Uint8>& out);
+
+	// Appends exactly decompressedSize bytes to out. On failure out is left as it was.
+	void DecompressLZ(std::span<const Uint8> compressed, size_t decompressedSize, std::vector<Uint8>& out);
+}
@@ -0,0 +1,98 @@
+/**************************************************************************************\
+** File: d2File.h
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Header file for reading and mapping files
+**
+\**************************************************************************************/
+#pragma once
+namespace d2d
+{
+	//+--------------------------------\--------------------------------------
+	//|			   Reading			   |
+	//\--------------------------------/
+	//	ReadFile sizes out from the file's size and fills it with a single
+	//	read, reusing out's capacity. Files are read in binary mode, so line
+	//	endings are left as they are. Throws FileException if the file cannot
+	//	be opened or read.
+	//------------------------------------------------------------------------
+	void ReadFile(const std::string& filePath, std::vector<Uint8>& out);
+	void ReadFile(const std::string& filePath, std::string& out);
+
+	// Asks the OS to start reading these files in the background, so that
+	//	loading many small files one after another waits on the disk less.
+	//	Files that cannot be opened are skipped. Does nothing on Windows.
+	void PrefetchFiles(std::span<const std::string> filePaths);
+
+	//+--------------------------------\--------------------------------------
+	//|			  MappedFile		   |
+	//\--------------------------------/
+	//	A read-only view of a whole file. The views stay valid until the
+	//	MappedFile is closed, destroyed or moved from. Files of at least
+	//	MIN_MAPPED_FILE_BYTES are memory-mapped, which avoids copying them.
+	//	Mapping has a fixed cost that a read beats for small files, so those
+	//	are read into a buffer owned by the MappedFile instead. Empty files
+	//	give empty views. Throws FileException if the file cannot be opened,
+	//	read or mapped.
+	//	With readAhead, a mapping is read in up front for parsing from start
+	//	to end. Without it pages load on first touch, which suits large files
+	//	that are only read in parts, such as archives.
+	//------------------------------------------------------------------------
+	const size_t MIN_MAPPED_FILE_BYTES{ 128 * 1024 };
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		explicit MappedFile(const std::string& filePath, bool readAhead = true);
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile();
+
+		void Open(const std::string& filePath, bool readAhead = true);
+		void Close();
+		bool IsOpen() const
+		{
+			return m_isOpen;
+		}
+		std::span<const Uint8> GetBytes() const
+		{
+			return { m_data, m_size };
+		}
+		std::string_view GetText() const
+		{
+			return { (const char*)m_data, m_size };
+		}
+		size_t GetSize() const
+		{
+			return m_size;
+		}
+	private:
+		const Uint8* m_data{ nullptr };
+		size_t m_size{ 0 };
+		bool m_isOpen{ false };
+		bool m_isMapped{ false };
+		std::vector<Uint8> m_buffer;
+	};
+
+	//+--------------------------------\--------------------------------------
+	//|		  MemoryInputStream		   |
+	//\--------------------------------/
+	//	An std::istream over bytes in memory, such as a MappedFile's view, for
+	//	parsers that only take streams. The bytes are not copied and must
+	//	outlive the stream.
+	//------------------------------------------------------------------------
+	class MemoryInputStream : private std::streambuf, public std::istream
+	{
+	public:
+		explicit MemoryInputStream(std::string_view text)
+			: std::istream{ this }
+		{
+			char* begin{ const_cast<char*>(text.data()) };
+			setg(begin, begin, begin + text.size());
+		}
+	};
+}
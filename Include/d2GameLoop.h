@@ -0,0 +1,81 @@
+/**************************************************************************************\
+** File: d2GameLoop.h
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Header file for the GameLoop class
+**
+\**************************************************************************************/
+#pragma once
+namespace d2d
+{
+	//+--------------------------------\--------------------------------------
+	//|			   GameLoop			   |
+	//\--------------------------------/
+	//	Fixed timestep updates with interpolated rendering. Each frame, real
+	//	time goes into an accumulator and is used up in whole steps of
+	//	stepSeconds, so the simulation always sees the same dt:
+	//
+	//		loop.BeginFrame();
+	//		while(loop.Step())
+	//			world.Step(loop.GetStepSeconds(), ...);
+	//		Draw(loop.GetAlpha());
+	//		loop.EndFrame();
+	//
+	//	GetAlpha is how far real time has gone past the last step, as a
+	//	fraction of a step, for blending the previous and current states.
+	//	At most maxStepsPerFrame steps run per frame. If the simulation
+	//	cannot keep up, the rest of the backlog is dropped rather than
+	//	carried over, so a slow frame never leads to an even slower one.
+	//	With targetFrameSeconds set, EndFrame sleeps away what is left of
+	//	the frame, then yields for the last sleepMarginSeconds, because
+	//	SDL_Delay can oversleep. Leave it 0 when vsync already limits the rate.
+	//------------------------------------------------------------------------
+	struct GameLoopDef
+	{
+		float stepSeconds{ 1.0f / 60.0f };
+		unsigned maxStepsPerFrame{ 5 };
+		float targetFrameSeconds{ 0.0f };
+		float sleepMarginSeconds{ 0.002f };
+	};
+	struct GameLoopStats
+	{
+		Uint64 frames{ 0 };
+		Uint64 steps{ 0 };
+
+		// Steps skipped because a frame hit maxStepsPerFrame
+		Uint64 droppedSteps{ 0 };
+		double sleptSeconds{ 0.0 };
+	};
+	class GameLoop
+	{
+	public:
+		explicit GameLoop(const GameLoopDef& def = GameLoopDef{});
+
+		// Restarts the clock and empties the accumulator
+		void Reset();
+
+		// Adds the real time since the last frame.
+		//	The overload takes the frame time instead, for replays and tests.
+		void BeginFrame();
+		void BeginFrame(float frameSeconds);
+
+		// Returns true while another fixed step is due this frame
+		bool Step();
+		void EndFrame();
+
+		float GetStepSeconds() const;
+		float GetAlpha() const;
+		unsigned GetStepsThisFrame() const;
+		const GameLoopStats& GetStats() const;
+
+	private:
+		GameLoopDef m_def;
+		double m_accumulator{ 0.0 };
+		unsigned m_stepsThisFrame{ 0 };
+		Uint64 m_lastTicks{ 0 };
+		Uint64 m_frameStartTicks{ 0 };
+		GameLoopStats m_stats;
+	};
+}
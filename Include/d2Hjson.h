@@ -9,6 +9,7 @@
 \**************************************************************************************/
 #pragma once
 #include "d2Color.h"
+#include <algorithm>
 namespace d2d
 {
 	using HjsonValue = Hjson::Value;
@@ -32,4 +33,279 @@ namespace d2d
 
 	Color GetColorFloat(const HjsonValue& data, const std::string& name);
 	Color GetColorInt(const HjsonValue& data, const std::string& name);
+
+	//+--------------------------------\--------------------------------------
+	//|		   Struct binding		   |
+	//\--------------------------------/
+	//	A type is HjsonBindable when it has a static hjsonFields() function
+	//	returning a tuple of field descriptors, like the serialization schemas:
+	//
+	//		struct ShipDef
+	//		{
+	//			std::string name;
+	//			float maxSpeed;
+	//			Color color;
+	//			bool canWarp{ false };
+	//			static auto hjsonFields()
+	//			{
+	//				return std::make_tuple(
+	//					MakeHjsonField("name", &ShipDef::name),
+	//					MakeHjsonField("maxSpeed", &ShipDef::maxSpeed),
+	//					MakeHjsonField("color", &ShipDef::color),
+	//					MakeOptionalHjsonField("canWarp", &ShipDef::canWarp));
+	//			}
+	//		};
+	//		ShipDef ship;
+	//		BindHjson(FileToHJSON(path), ship);
+	//
+	//	BindHjson walks the map once, in key order, alongside the field names
+	//	sorted once per type, and reads each value in place without copying
+	//	it. Every missing or mistyped field is collected and all of them are
+	//	reported in one HjsonFailedQueryException, with paths like
+	//	"engine.thrust" or "waypoints[2]". The object may be partly filled
+	//	when it throws. Null counts as missing, optional fields keep their
+	//	value when missing, and keys with no field are ignored.
+	//	Supported types: bool, integers, float and double (which also accept
+	//	integer values), std::string, b2Vec2 as [x, y], Color as float
+	//	[r, g, b, a] (MakeHjsonIntColorField for 0-255 ints), std::vector of
+	//	any of these, and nested HjsonBindable types.
+	//------------------------------------------------------------------------
+	template <typename T>
+	concept HjsonBindable = requires { T::hjsonFields(); };
+
+	// Location of a value, built on the stack and only turned into a string
+	//	when reporting an error
+	struct HjsonPath
+	{
+		const HjsonPath* parent{ nullptr };
+		std::string_view key;
+		size_t index{ 0 };
+		bool isIndex{ false };
+		std::string ToString() const;
+	};
+	class HjsonBindErrors
+	{
+	public:
+		void AddMissing(const HjsonPath& path);
+		void AddMismatch(const HjsonPath& path, Hjson::Type actual, const char* expected);
+		// Throws HjsonFailedQueryException listing every error, if there are any
+		void ThrowIfAny() const;
+		bool IsEmpty() const
+		{
+			return m_errors.empty();
+		}
+	private:
+		std::vector<std::string> m_errors;
+	};
+
+	// Leaf readers return false, leaving out unchanged, if the value has the wrong type.
+	//	Integers outside the range of the field's type are also rejected.
+	bool ReadHjsonValue(const HjsonValue& value, bool& out);
+	bool ReadHjsonValue(const HjsonValue& value, float& out);
+	bool ReadHjsonValue(const HjsonValue& value, double& out);
+	bool ReadHjsonValue(const HjsonValue& value, std::string& out);
+	bool ReadHjsonValue(const HjsonValue& value, b2Vec2& out);
+	bool ReadHjsonValue(const HjsonValue& value, Color& out);
+	bool ReadHjsonIntColor(const HjsonValue& value, Color& out);
+	template <typename T> requires std::is_integral_v<T>
+	bool ReadHjsonValue(const HjsonValue& value, T& out)
+	{
+		if(value.type() != Hjson::Type::Int64)
+			return false;
+		const std::int64_t integer{ value.to_int64() };
+		if constexpr(std::is_signed_v<T>)
+		{
+			if(integer < (std::int64_t)std::numeric_limits<T>::min() || integer > (std::int64_t)std::numeric_limits<T>::max())
+				return false;
+		}
+		else if(integer < 0 || (std::uint64_t)integer > (std::uint64_t)std::numeric_limits<T>::max())
+			return false;
+		out = (T)integer;
+		return true;
+	}
+	template <typename T> constexpr const char* GetHjsonTypeName()
+	{
+		if constexpr(std::is_same_v<T, bool>)
+			return "bool";
+		else if constexpr(std::is_integral_v<T> && sizeof(T) < sizeof(std::int64_t))
+		{
+			// Names the range, since an out of range integer is also a mismatch
+			if constexpr(sizeof(T) == 1)
+				return std::is_signed_v<T> ? "integer from -128 to 127" : "integer from 0 to 255";
+			else if constexpr(sizeof(T) == 2)
+				return std::is_signed_v<T> ? "integer from -32768 to 32767" : "integer from 0 to 65535";
+			else
+				return std::is_signed_v<T> ? "integer from -2147483648 to 2147483647" : "integer from 0 to 4294967295";
+		}
+		else if constexpr(std::is_integral_v<T>)
+			return std::is_signed_v<T> ? "integer" : "integer from 0";
+		else if constexpr(std::is_floating_point_v<T>)
+			return "number";
+		else if constexpr(std::is_same_v<T, std::string>)
+			return "string";
+		else if constexpr(std::is_same_v<T, b2Vec2>)
+			return "[x, y]";
+		else if constexpr(std::is_same_v<T, Color>)
+			return "[r, g, b, a]";
+		else
+			return "value";
+	}
+
+	template <typename T> struct IsStdVector : std::false_type {};
+	template <typename T> struct IsStdVector<std::vector<T>> : std::true_type {};
+
+	template <HjsonBindable T> void BindHjsonFields(const HjsonValue& data, T& object, HjsonBindErrors& errors, const HjsonPath& path);
+
+	template <typename T> void ReadHjsonField(const HjsonValue& value, T& out, HjsonBindErrors& errors, const HjsonPath& path)
+	{
+		if constexpr(HjsonBindable<T>)
+			BindHjsonFields(value, out, errors, path);
+		else if constexpr(IsStdVector<T>::value)
+		{
+			if(value.type() != Hjson::Type::Vector)
+			{
+				errors.AddMismatch(path, value.type(), "array");
+				return;
+			}
+			out.resize(value.size());
+			for(size_t i = 0; i < out.size(); ++i)
+				ReadHjsonField(value[(int)i], out[i], errors, HjsonPath{ &path, {}, i, true });
+		}
+		else if constexpr(requires { ReadHjsonValue(value, out); })
+		{
+			if(!ReadHjsonValue(value, out))
+				errors.AddMismatch(path, value.type(), GetHjsonTypeName<T>());
+		}
+		else
+			static_assert(sizeof(T) == 0, "Type has no HJSON binding; give it an hjsonFields() function");
+	}
+
+	// Field descriptors
+	template <typename C, typename T>
+	struct HjsonField
+	{
+		std::string_view name;
+		T C::* member;
+		bool required;
+		void Read(const HjsonValue& value, C& object, HjsonBindErrors& errors, const HjsonPath& path) const
+		{
+			ReadHjsonField(value, object.*member, errors, path);
+		}
+	};
+	template <typename C>
+	struct HjsonIntColorField
+	{
+		std::string_view name;
+		Color C::* member;
+		bool required;
+		void Read(const HjsonValue& value, C& object, HjsonBindErrors& errors, const HjsonPath& path) const
+		{
+			if(!ReadHjsonIntColor(value, object.*member))
+				errors.AddMismatch(path, value.type(), "[r, g, b, a] from 0 to 255");
+		}
+	};
+
+	// Field descriptor factories
+	template <typename C, typename T> HjsonField<C, T> MakeHjsonField(std::string_view name, T C::* member)
+	{
+		return { name, member, true };
+	}
+	template <typename C, typename T> HjsonField<C, T> MakeOptionalHjsonField(std::string_view name, T C::* member)
+	{
+		return { name, member, false };
+	}
+	template <typename C> HjsonIntColorField<C> MakeHjsonIntColorField(std::string_view name, Color C::* member, bool required = true)
+	{
+		return { name, member, required };
+	}
+
+	// Per-type field table, built on first use
+	template <HjsonBindable T>
+	class HjsonBinding
+	{
+	public:
+		using Fields = decltype(T::hjsonFields());
+		static constexpr size_t NUM_FIELDS{ std::tuple_size_v<Fields> };
+		using Reader = void(*)(const Fields&, const HjsonValue&, T&, HjsonBindErrors&, const HjsonPath&);
+
+		static const HjsonBinding& Get()
+		{
+			static const HjsonBinding binding;
+			return binding;
+		}
+		void Bind(const HjsonValue& data, T& object, HjsonBindErrors& errors, const HjsonPath& path) const
+		{
+			if(data.type() != Hjson::Type::Map)
+			{
+				errors.AddMismatch(path, data.type(), "map");
+				return;
+			}
+			// Both the map and m_sortedFields are in key order, so one pass matches them up
+			std::array<bool, NUM_FIELDS> found{};
+			auto memberIt{ data.begin() };
+			size_t sortedIndex{ 0 };
+			while(memberIt != data.end() && sortedIndex < NUM_FIELDS)
+			{
+				const size_t fieldIndex{ m_sortedFields[sortedIndex] };
+				const int comparison{ std::string_view{ memberIt->first }.compare(m_names[fieldIndex]) };
+				if(comparison < 0)
+					++memberIt;
+				else if(comparison > 0)
+					++sortedIndex;
+				else
+				{
+					if(IsNonNull(memberIt->second))
+					{
+						found[fieldIndex] = true;
+						m_readers[fieldIndex](m_fields, memberIt->second, object, errors, HjsonPath{ &path, m_names[fieldIndex] });
+					}
+					++memberIt;
+					++sortedIndex;
+				}
+			}
+			for(size_t i = 0; i < NUM_FIELDS; ++i)
+				if(!found[i] && m_required[i])
+					errors.AddMissing(HjsonPath{ &path, m_names[i] });
+		}
+	private:
+		HjsonBinding()
+			: m_fields{ T::hjsonFields() }
+		{
+			std::apply([&](const auto&... fields)
+			{
+				size_t i{ 0 };
+				((m_names[i] = fields.name, m_required[i] = fields.required, ++i), ...);
+			}, m_fields);
+			[&]<size_t... I>(std::index_sequence<I...>)
+			{
+				m_readers = { [](const Fields& fields, const HjsonValue& value, T& object, HjsonBindErrors& errors, const HjsonPath& path)
+				{
+					std::get<I>(fields).Read(value, object, errors, path);
+				}... };
+			}(std::make_index_sequence<NUM_FIELDS>{});
+			for(size_t i = 0; i < NUM_FIELDS; ++i)
+				m_sortedFields[i] = i;
+			std::sort(m_sortedFields.begin(), m_sortedFields.end(),
+				[&](size_t a, size_t b) { return m_names[a] < m_names[b]; });
+			for(size_t i = 1; i < NUM_FIELDS; ++i)
+				d2AssertRelease(m_names[m_sortedFields[i - 1]] != m_names[m_sortedFields[i]]);
+		}
+
+		const Fields m_fields;
+		std::array<std::string_view, NUM_FIELDS> m_names;
+		std::array<bool, NUM_FIELDS> m_required;
+		std::array<Reader, NUM_FIELDS> m_readers;
+		std::array<size_t, NUM_FIELDS> m_sortedFields;
+	};
+
+	template <HjsonBindable T> void BindHjsonFields(const HjsonValue& data, T& object, HjsonBindErrors& errors, const HjsonPath& path)
+	{
+		HjsonBinding<T>::Get().Bind(data, object, errors, path);
+	}
+	template <HjsonBindable T> void BindHjson(const HjsonValue& data, T& object)
+	{
+		HjsonBindErrors errors;
+		BindHjsonFields(data, object, errors, HjsonPath{});
+		errors.ThrowIfAny();
+	}
 }
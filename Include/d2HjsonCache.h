@@ -0,0 +1,54 @@
+/**************************************************************************************\
+** File: d2HjsonCache.h
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Header file for caching parsed HJSON files in binary form
+**
+\**************************************************************************************/
+#pragma once
+#include "d2Hjson.h"
+namespace d2d
+{
+	//+--------------------------------\--------------------------------------
+	//|			  HjsonCache		   |
+	//\--------------------------------/
+	//	Keeps one binary cache file per HJSON file in a cache directory, named
+	//	after a hash of the file's path. Each records the path, modification
+	//	time, size and content hash of the file it came from.
+	//	Load returns the cached value when the time and size still match,
+	//	without reading the HJSON file. When they differ but the content hash
+	//	matches (a checkout or touch), it uses the cache and updates the
+	//	times. Otherwise it parses the file and rewrites the cache.
+	//	Missing, corrupt or unwritable cache files just mean a parse.
+	//	Comments are not cached, so only use this for values that are read.
+	//	Not thread-safe.
+	//------------------------------------------------------------------------
+	struct HjsonCacheStats
+	{
+		unsigned hits{ 0 };
+		unsigned rehashedHits{ 0 };
+		unsigned misses{ 0 };
+	};
+	class HjsonCache
+	{
+	public:
+		explicit HjsonCache(const std::string& cacheDirectory);
+		// Same as FileToHJSON(filePath), parsing only when the file changed
+		HjsonValue Load(const std::string& filePath);
+		const HjsonCacheStats& GetStats() const
+		{
+			return m_stats;
+		}
+	private:
+		std::filesystem::path m_cacheDirectory;
+		std::vector<Uint8> m_buffer;
+		HjsonCacheStats m_stats;
+	};
+
+	// The binary form used by the cache. Maps keep their insertion order.
+	//	ReadHjsonBinary throws SerializationException on truncated or bad data.
+	void WriteHjsonBinary(const HjsonValue& value, std::vector<Uint8>& out);
+	HjsonValue ReadHjsonBinary(std::span<const Uint8> data);
+}
@@ -19,33 +19,28 @@ namespace d2d
 	//+--------------------------------\--------------------------------------
 	//|		   NetworkMessage   	   |
 	//\--------------------------------/--------------------------------------
-	const int bufferBytes{ 256 };
-	typedef char ByteBuffer[bufferBytes];
+	//	A binary payload of any size up to MAX_MESSAGE_BYTES. Sockets send
+	//	each message as one frame: a varint header holding the payload size
+	//	and frame type, followed by the payload bytes.
+	const size_t MAX_MESSAGE_BYTES{ 16 * 1024 * 1024 };
 	class NetworkMessage
 	{
 	public:
-		NetworkMessage();
-		virtual int NumToLoad();
-		virtual int NumToUnload();
+		NetworkMessage() = default;
+		NetworkMessage(const void* data, size_t numBytes);
+		void Set(const void* data, size_t numBytes);
+		void Append(const void* data, size_t numBytes);
+		void Clear();
 
-		void LoadBytes(ByteBuffer& inBuffer, int numBytes);
-		void UnloadBytes(ByteBuffer& outBuffer);
+		std::span<const Uint8> GetPayload() const;
+		size_t GetSize() const;
+		bool IsEmpty() const;
 
-		//set the state object to full. No more data to be loaded
-		void Finish();
+		// Direct access for code that builds payloads in place
+		std::vector<Uint8>& GetBuffer();
 
-	protected:
-		ByteBuffer m_buffer;
-		enum class BufferState
-		{
-			EMPTY,
-			READING,
-			WRITING,
-			FULL
-		} m_bufferState;
-
-		// reset message: fulfill it with zeroes and change its state to EMPTY
-		void Reset();
+	private:
+		std::vector<Uint8> m_payload;
 	};
 
 	//+--------------------------------\--------------------------------------
@@ -62,6 +57,7 @@ namespace d2d
 		IPaddress GetSDL_IPaddress() const;
 		Uint32 GetHost() const;
 		Uint16 GetPort() const;
+		bool operator==(const IpAddress& other) const;
 
 	private:
 		IPaddress m_ip;
@@ -77,11 +73,15 @@ namespace d2d
 		virtual ~TcpSocket();
 		virtual void Set(TCPsocket sdl_TCPsocket);
 		bool Valid() const;
-		bool Ready() const;
+		bool Ready(Uint32 timeoutMilliseconds = 0) const;
+		TCPsocket GetSDL_TCPsocket() const;
 		virtual void OnReady(); // Pure virtual
 	protected:
 		TCPsocket m_socket;
-		SDLNet_SocketSet m_socketSet;
+
+		// Created by the first call to Ready()
+		mutable SDLNet_SocketSet m_socketSet;
+		void FreeSocketSet() const;
 	};
 
 	//+--------------------------------\--------------------------------------
@@ -105,7 +105,56 @@ namespace d2d
 
 	//+--------------------------------\--------------------------------------
 	//|		   ClientTcpSocket		   |
-	//\--------------------------------/--------------------------------------
+	//\--------------------------------/
+	//	Send queues one message and flushes, so it also writes any messages
+	//	queued before it. To batch a tick's output, call QueueSend for each
+	//	message and then Flush once. Queued payloads are
+	//	referenced, not copied, so they must stay alive and unchanged until
+	//	Flush returns. Flush packs small frames into one buffer and writes it
+	//	with a single send. Payloads of at least DIRECT_SEND_MIN_BYTES are
+	//	written straight from the caller's buffer instead of being copied.
+	//
+	//	Each socket keeps SocketStats since it was connected or last reset.
+	//	Control frames (PING, PONG and HELLO) count towards bytes and calls
+	//	but not messages; they are answered and consumed inside ExtractMessage.
+	//
+	//	Compression is negotiated: on connecting, each side sends a HELLO
+	//	saying whether it accepts compressed frames. Once both sides have
+	//	enabled it, Flush compresses payloads of at least thresholdBytes
+	//	with CompressLZ, and sends them compressed only if that saved space.
+	//	Incoming compressed frames are always accepted.
+	//------------------------------------------------------------------------
+	const size_t DIRECT_SEND_MIN_BYTES{ 16 * 1024 };
+	const size_t DEFAULT_COMPRESSION_THRESHOLD_BYTES{ 256 };
+	struct SocketStats
+	{
+		Uint64 bytesSent{ 0 };
+		Uint64 bytesReceived{ 0 };
+		Uint64 messagesSent{ 0 };
+		Uint64 messagesReceived{ 0 };
+		Uint64 sendCalls{ 0 };
+		Uint64 receiveCalls{ 0 };
+
+		// Reads that left the frame being assembled still incomplete
+		Uint64 partialReads{ 0 };
+		Uint64 flushes{ 0 };
+		Uint64 payloadBytesCopied{ 0 };
+
+		// Most recent Flush only
+		unsigned lastFlushMessages{ 0 };
+		unsigned lastFlushSendCalls{ 0 };
+
+		// Smoothed over PING/PONG round trips; 0 until the first PONG
+		Uint64 pingsSent{ 0 };
+		Uint64 pongsReceived{ 0 };
+		float roundTripMilliseconds{ 0.0f };
+
+		// Compressed data frames, with payload sizes before and after
+		Uint64 compressedMessagesSent{ 0 };
+		Uint64 compressedMessagesReceived{ 0 };
+		Uint64 bytesBeforeCompression{ 0 };
+		Uint64 bytesAfterCompression{ 0 };
+	};
 	class ClientTcpSocket : public TcpSocket
 	{
 	public:
@@ -124,10 +173,193 @@ namespace d2d
 		IpAddress GetRemoteIpAddress() const;
 
 		virtual void OnReady(); // Pure virtual
+		bool IsConnected() const;
 
+		// Returns true if a complete message was copied into inData.
+		//	Never blocks: reads only when the socket is ready, and keeps
+		//	partial frames buffered until the rest arrives on a later call.
 		bool Receive(NetworkMessage& inData);
-		bool Send(NetworkMessage& outData);
+		bool Send(const NetworkMessage& outData);
+		bool Send(std::span<const Uint8> payload);
+
+		// Batched sending
+		void QueueSend(const NetworkMessage& outData);
+		void QueueSend(std::span<const Uint8> payload);
+		bool Flush();
+		void ClearSendQueue();
+		size_t GetQueuedMessageCount() const;
+
+		// Statistics
+		const SocketStats& GetStats() const;
+		void ResetStats();
+		size_t GetBufferedReceiveBytes() const;
+		void LogStats() const;
+
+		// Sends a PING now; the peer's PONG updates the round trip time.
+		//	Does nothing, and counts nothing, if the socket is not connected.
+		void SendPing();
+
+		// While Update is called, sends a PING every pingInterval seconds and
+		//	logs the stats every logInterval seconds. 0 disables either.
+		void SetPingInterval(float seconds);
+		void SetStatsLogInterval(float seconds);
+		void Update(float dt);
+
+		// Compression is off by default. Changing it while connected tells the peer.
+		void SetCompression(bool enabled, size_t thresholdBytes = DEFAULT_COMPRESSION_THRESHOLD_BYTES);
+		bool IsCompressionActive() const;
+
+		// Receive in two steps, for callers that already know the socket is ready.
+		//	ReceiveAvailable performs one read and returns false on disconnect.
+		//	ExtractMessage returns false until a whole frame is buffered.
+		bool ReceiveAvailable();
+		bool ExtractMessage(NetworkMessage& inData);
+
 	private:
 		IpAddress m_remoteIp;
+		bool m_connected{ false };
+
+		// Bytes [m_receiveStart, m_receiveEnd) of m_receiveBuffer are unparsed.
+		//	The buffer grows to fit the largest frame seen and is then reused.
+		std::vector<Uint8> m_receiveBuffer;
+		size_t m_receiveStart{ 0 };
+		size_t m_receiveEnd{ 0 };
+		size_t m_pendingFrameBytes{ 0 };
+
+		void SendRaw(const Uint8* data, size_t numBytes);
+		bool SendControlFrame(Uint8 controlType, std::span<const Uint8> controlData);
+		void ProcessControlFrame(std::span<const Uint8> payload);
+		void SendHello();
+		bool CompressFrame(std::span<const Uint8> payload);
+
+		// Each queued frame's varint header lives in m_sendHeaders at headerOffset
+		struct QueuedFrame
+		{
+			size_t headerOffset;
+			size_t headerBytes;
+			std::span<const Uint8> payload;
+		};
+		std::vector<QueuedFrame> m_sendQueue;
+		std::vector<Uint8> m_sendHeaders;
+		std::vector<Uint8> m_sendBuffer;
+		std::vector<Uint8> m_compressBuffer;
+
+		bool m_compressionEnabled{ false };
+		bool m_peerAcceptsCompression{ false };
+		size_t m_compressionThreshold{ DEFAULT_COMPRESSION_THRESHOLD_BYTES };
+
+		SocketStats m_stats;
+		float m_pingInterval{ 0.0f };
+		float m_pingTimer{ 0.0f };
+		float m_statsLogInterval{ 0.0f };
+		float m_statsLogTimer{ 0.0f };
+	};
+
+	//+--------------------------------\--------------------------------------
+	//|		  DatagramTransport		   |
+	//\--------------------------------/
+	//	Anything that moves whole datagrams: a UdpSocket, or one end of a
+	//	SimulatedLink for testing without a real network.
+	//------------------------------------------------------------------------
+	class DatagramTransport
+	{
+	public:
+		virtual ~DatagramTransport() = default;
+		virtual bool Send(const IpAddress& destination, std::span<const Uint8> data) = 0;
+
+		// Never blocks. Returns false when no datagram is waiting.
+		virtual bool Receive(std::vector<Uint8>& dataOut, IpAddress& sourceOut) = 0;
+	};
+
+	//+--------------------------------\--------------------------------------
+	//|			  UdpSocket			   |
+	//\--------------------------------/--------------------------------------
+	const size_t MAX_DATAGRAM_BYTES{ 65507 };
+	class UdpSocket : public DatagramTransport
+	{
+	public:
+		// Port 0 lets the system choose
+		explicit UdpSocket(Uint16 port = 0);
+		~UdpSocket();
+		UdpSocket(const UdpSocket&) = delete;
+		UdpSocket& operator=(const UdpSocket&) = delete;
+
+		bool Send(const IpAddress& destination, std::span<const Uint8> data) override;
+		bool Receive(std::vector<Uint8>& dataOut, IpAddress& sourceOut) override;
+		UDPsocket GetSDL_UDPsocket() const;
+		IpAddress GetLocalIpAddress() const;
+
+	private:
+		UDPsocket m_socket{ nullptr };
+		UDPpacket* m_receivePacketPtr{ nullptr };
+	};
+
+	//+--------------------------------\--------------------------------------
+	//|			NetworkReactor		   |
+	//\--------------------------------/
+	//	Owns a listening socket and every connection it accepts, and polls
+	//	them all through one shared socket set: one SDLNet_CheckSockets call
+	//	per Poll no matter how many clients are connected.
+	//	Poll dispatches at most maxMessages messages, starting from a
+	//	different connection each time so that busy clients cannot starve
+	//	the rest. Messages beyond the budget stay buffered for the next Poll.
+	//	Callbacks may call Send and Disconnect. Disconnects requested during
+	//	Poll take effect before Poll returns.
+	//	A connection whose socket fails, that sends a malformed frame, or
+	//	whose onMessage callback throws is closed; the other connections are
+	//	still serviced. Likewise a failed send in Broadcast closes only that
+	//	connection.
+	//------------------------------------------------------------------------
+	using ConnectionID = unsigned;
+	struct NetworkReactorCallbacks
+	{
+		std::function<void(ConnectionID id)> onConnect;
+		std::function<void(ConnectionID id, const NetworkMessage& message)> onMessage;
+		std::function<void(ConnectionID id)> onDisconnect;
+	};
+	class NetworkReactor
+	{
+	public:
+		NetworkReactor(Uint16 port, unsigned maxConnections, const NetworkReactorCallbacks& callbacks);
+		~NetworkReactor();
+		NetworkReactor(const NetworkReactor&) = delete;
+		NetworkReactor& operator=(const NetworkReactor&) = delete;
+
+		// Returns the number of messages dispatched
+		unsigned Poll(Uint32 timeoutMilliseconds = 0, unsigned maxMessages = UINT_MAX);
+
+		bool Send(ConnectionID id, const NetworkMessage& message);
+		void Broadcast(const NetworkMessage& message);
+		void Disconnect(ConnectionID id);
+		bool IsConnected(ConnectionID id) const;
+		unsigned GetConnectionCount() const;
+		const SocketStats& GetStats(ConnectionID id) const;
+
+		// Applies to current and future connections
+		void SetCompression(bool enabled, size_t thresholdBytes = DEFAULT_COMPRESSION_THRESHOLD_BYTES);
+
+	private:
+		void AcceptPending();
+		bool ServiceConnection(ConnectionID id, bool anyReady, unsigned maxMessages, unsigned& numDispatched);
+		void ClosePendingDisconnects();
+		void Close(ConnectionID id);
+
+		ServerTcpSocket m_listener;
+		SDLNet_SocketSet m_socketSet;
+		unsigned m_maxConnections;
+		NetworkReactorCallbacks m_callbacks;
+
+		// Indexed by ConnectionID; null entries are free
+		std::vector<std::unique_ptr<ClientTcpSocket>> m_connections;
+		std::vector<ConnectionID> m_freeIDs;
+		unsigned m_connectionCount{ 0 };
+		ConnectionID m_nextToService{ 0 };
+
+		bool m_polling{ false };
+		std::vector<ConnectionID> m_pendingDisconnects;
+		NetworkMessage m_message;
+
+		bool m_compressionEnabled{ false };
+		size_t m_compressionThreshold{ DEFAULT_COMPRESSION_THRESHOLD_BYTES };
 	};
 }
@@ -0,0 +1,98 @@
+/**************************************************************************************\
+** File: d2NetworkThread.h
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Header file for the NetworkThread class
+**
+\**************************************************************************************/
+#pragma once
+#include "d2Network.h"
+#include "d2SpscQueue.h"
+namespace d2d
+{
+	//+--------------------------------\--------------------------------------
+	//|			NetworkThread		   |
+	//\--------------------------------/
+	//	Runs a connected ClientTcpSocket on its own worker thread. The game
+	//	thread exchanges messages with the worker through two SpscQueues, so
+	//	Send and Receive never touch the socket and never block.
+	//	Each pass, the worker sends everything queued as one batched Flush,
+	//	then waits up to waitMilliseconds for incoming data. waitMilliseconds
+	//	therefore bounds the extra latency a queued message can see.
+	//	If the incoming queue is full, the worker stops reading the socket
+	//	until the game thread catches up, leaving TCP to apply backpressure.
+	//	If the worker hits any error it logs it and stops; IsConnected then
+	//	returns false, and messages already received can still be drained.
+	//------------------------------------------------------------------------
+	struct NetworkThreadDef
+	{
+		size_t queueCapacity{ 1024 };
+		Uint32 waitMilliseconds{ 1 };
+	};
+	struct NetworkThreadStats
+	{
+		Uint64 messagesSent{ 0 };
+		Uint64 messagesReceived{ 0 };
+		Uint64 sendQueueFullCount{ 0 };
+
+		// From Send on the game thread to the socket write on the worker
+		double averageSendLatencyMicroseconds{ 0.0 };
+		double maxSendLatencyMicroseconds{ 0.0 };
+	};
+	class NetworkThread
+	{
+	public:
+		// Takes over the socket, which no other thread may use afterwards
+		explicit NetworkThread(std::unique_ptr<ClientTcpSocket> socketPtr, const NetworkThreadDef& def = NetworkThreadDef{});
+		~NetworkThread();
+		NetworkThread(const NetworkThread&) = delete;
+		NetworkThread& operator=(const NetworkThread&) = delete;
+
+		// Game thread only.
+		//	Send swaps message into the outgoing queue and hands back an
+		//	empty recycled message in its place. Returns false, leaving
+		//	message untouched, if the outgoing queue is full.
+		bool Send(NetworkMessage& message);
+		bool Receive(NetworkMessage& messageOut);
+		bool IsConnected() const;
+		NetworkThreadStats GetStats() const;
+
+		// Stops and joins the worker. Queued messages that were not sent are dropped.
+		void Stop();
+
+	private:
+		void Run();
+		bool DeliverIncoming();
+
+		struct OutgoingMessage
+		{
+			NetworkMessage message;
+			Uint64 enqueueTicks{ 0 };
+		};
+		std::unique_ptr<ClientTcpSocket> m_socketPtr;
+		NetworkThreadDef m_def;
+		SpscQueue<OutgoingMessage> m_outgoing;
+		SpscQueue<NetworkMessage> m_incoming;
+
+		// Game thread only
+		OutgoingMessage m_outgoingScratch;
+		Uint64 m_sendQueueFullCount{ 0 };
+
+		// Worker only
+		std::vector<OutgoingMessage> m_batch;
+		NetworkMessage m_pendingIncoming;
+		bool m_hasPendingIncoming{ false };
+
+		// Shared
+		std::atomic<bool> m_stopRequested{ false };
+		std::atomic<bool> m_connected{ false };
+		std::atomic<Uint64> m_messagesSent{ 0 };
+		std::atomic<Uint64> m_messagesReceived{ 0 };
+		std::atomic<Uint64> m_latencyTotalTicks{ 0 };
+		std::atomic<Uint64> m_latencyMaxTicks{ 0 };
+
+		std::thread m_thread;
+	};
+}
@@ -114,6 +114,21 @@ namespace d2d
 	float GetWrappedDegrees(float angleDegrees);
 	void WrapDegrees(float& angleDegrees);
 
+	// Batch wrapping, clamping and interpolation
+	//	In-place span versions of the functions above, vectorized with SSE2/AVX
+	//	when available. Wrapping and clamping give the same values as the scalar
+	//	versions; wrapping computes fmodf exactly, in double where needed.
+	void WrapFloats(std::span<float> values, const Range<float>& range);
+	void WrapFloats(std::span<float> values, float modulus);
+	void WrapVectors(std::span<b2Vec2> values, const Rect& rect);
+	void WrapVectors(std::span<b2Vec2> values, const b2Vec2& low, const b2Vec2& high);
+	void WrapRadians(std::span<float> angles);
+	void WrapDegrees(std::span<float> anglesDegrees);
+	void ClampFloats(std::span<float> values, const Range<float>& range);
+
+	// out[i] = Lerp(a[i], b[i], percentB). All spans must be the same size.
+	void LerpFloats(std::span<const float> a, std::span<const float> b, float percentB, std::span<float> out);
+
 	// Rounding
 	int GetRoundedFloat(float value);
 	void RoundFloat(float& value);
@@ -0,0 +1,89 @@
+/**************************************************************************************\
+** File: d2Particle.h
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Header file for the ParticleEmitter class
+**
+\**************************************************************************************/
+#pragma once
+#include "d2Color.h"
+#include "d2Range.h"
+#include "d2Rect.h"
+#include "d2Random.h"
+#include "d2Texture.h"
+namespace d2d
+{
+	//+--------------------------------\--------------------------------------
+	//|		  ParticleEmitterDef	   |
+	//\--------------------------------/
+	//	spawnRect is relative to the emitter position.
+	//	directionRange is in radians.
+	//	Particle colors move through colorRange over their lifetime: from
+	//	its min at birth to its max at death, or the reverse if colorMinAtBirth
+	//	is false (e.g. fading alpha out).
+	//	If texturePtr is null, particles are drawn as points of particleSize.
+	//------------------------------------------------------------------------
+	struct ParticleEmitterDef
+	{
+		unsigned capacity{ 1000 };
+		float particlesPerSecond{ 100.0f };
+		Range<float> lifetimeRange{ 1.0f, 1.0f };
+		Range<float> speedRange{ 0.0f, 1.0f };
+		Range<float> directionRange{ 0.0f, 0.0f };
+		Rect spawnRect{ b2Vec2_zero, b2Vec2_zero };
+		ColorRange colorRange{ WHITE_OPAQUE, WHITE_OPAQUE };
+		bool colorMinAtBirth{ true };
+		b2Vec2 particleSize{ 1.0f, 1.0f };
+		const Texture* texturePtr{ nullptr };
+	};
+
+	//+--------------------------------\--------------------------------------
+	//|		   ParticleEmitter		   |
+	//\--------------------------------/
+	//	Particles are stored as parallel arrays in a pool allocated once by
+	//	Init. Dead particles are removed by swapping the last live particle
+	//	into their slot, so live particles are always [0, GetCount()).
+	//
+	//	Update(dt) does everything on the calling thread. To split the work
+	//	across threads, call Spawn(dt) once, then UpdateRange(dt, first, count)
+	//	on disjoint ranges from any number of threads, then RemoveExpired()
+	//	once after all ranges are done.
+	//------------------------------------------------------------------------
+	class ParticleEmitter
+	{
+	public:
+		void Init(const ParticleEmitterDef& def, const RandomStream& randomStream = RandomStream{});
+		void SetPosition(const b2Vec2& position);
+		void SetEmitting(bool emitting);
+		bool IsEmitting() const;
+		void Emit(unsigned numParticles);
+		void Clear();
+
+		void Update(float dt);
+		void Spawn(float dt);
+		void UpdateRange(float dt, unsigned first, unsigned count);
+		void RemoveExpired();
+
+		void Draw() const;
+		unsigned GetCount() const;
+		unsigned GetCapacity() const;
+
+	private:
+		ParticleEmitterDef m_def;
+		RandomStream m_randomStream;
+		b2Vec2 m_position{ b2Vec2_zero };
+		bool m_emitting{ true };
+		float m_emitAccumulator{ 0.0f };
+		unsigned m_count{ 0 };
+
+		// Particle pool
+		std::vector<b2Vec2> m_positions;
+		std::vector<b2Vec2> m_velocities;
+		std::vector<float> m_ages;
+		std::vector<float> m_lifetimes;
+		std::vector<float> m_colorPercents;
+		std::vector<Color32> m_colors;
+	};
+}
@@ -0,0 +1,123 @@
+/**************************************************************************************\
+** File: d2PhysicsWorld.h
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Header file for the PhysicsWorld class
+**
+\**************************************************************************************/
+#pragma once
+namespace d2d
+{
+	//+--------------------------------\--------------------------------------
+	//|			 PhysicsWorld		   |
+	//\--------------------------------/
+	//	Owns a b2World and steps it. Each Step(dt) runs subSteps world steps
+	//	of dt / subSteps. Forces applied before the step act on every
+	//	substep, and are cleared after the last. After stepping, the world's
+	//	b2Profile (summed over the substeps) and its body, awake body,
+	//	contact and proxy counts are gathered into PhysicsStats, and every
+	//	body's transform is copied into a snapshot.
+	//
+	//	StepAsync runs the same step on a worker thread, so it can overlap
+	//	with drawing the previous step's snapshot:
+	//
+	//		physics.WaitForStep();			// publishes the finished step
+	//		... update game objects through GetWorld() ...
+	//		physics.StepAsync(dt);
+	//		Draw(physics.GetTransforms());	// previous step, safe to read
+	//
+	//	The snapshot is double-buffered: the worker writes the back buffer,
+	//	and WaitForStep swaps it to the front. Between StepAsync and
+	//	WaitForStep the b2World belongs to the worker and must not be
+	//	touched; GetWorld asserts this.
+	//
+	//	A transform's bodyPtr identifies its body. Only dereference it
+	//	between WaitForStep and StepAsync, when the body is not being
+	//	stepped. Destroy bodies with DestroyBody, not through GetWorld:
+	//	the published transforms still list the body until the next step
+	//	is published, and DestroyBody sets its bodyPtr to null so nothing
+	//	reads a destroyed body, or mistakes a new body created at the same
+	//	address for it.
+	//------------------------------------------------------------------------
+	struct PhysicsWorldDef
+	{
+		b2Vec2 gravity{ b2Vec2_zero };
+		unsigned subSteps{ 1 };
+		int velocityIterations{ 8 };
+		int positionIterations{ 3 };
+		bool allowSleeping{ true };
+	};
+	struct PhysicsStats
+	{
+		// Most recent step, summed over its substeps
+		b2Profile profile{};
+		float stepMilliseconds{ 0.0f };
+
+		unsigned bodyCount{ 0 };
+		unsigned awakeBodyCount{ 0 };
+		unsigned contactCount{ 0 };
+		unsigned proxyCount{ 0 };
+		Uint64 steps{ 0 };
+	};
+	struct BodyTransform
+	{
+		const b2Body* bodyPtr;
+		b2Vec2 position;
+		float angle;
+	};
+	class PhysicsWorld
+	{
+	public:
+		explicit PhysicsWorld(const PhysicsWorldDef& def = PhysicsWorldDef{});
+		~PhysicsWorld();
+		PhysicsWorld(const PhysicsWorld&) = delete;
+		PhysicsWorld& operator=(const PhysicsWorld&) = delete;
+
+		b2World& GetWorld();
+		void DestroyBody(b2Body* bodyPtr);
+		void Step(float dt);
+
+		// Starts the worker thread on first use. IsStepping is true from
+		//	StepAsync until the matching WaitForStep, even if the worker
+		//	finished earlier.
+		void StepAsync(float dt);
+		void WaitForStep();
+		bool IsStepping() const;
+
+		// Bodies in world order as of the last published step.
+		//	bodyPtr is null for bodies destroyed since then.
+		std::span<const BodyTransform> GetTransforms() const;
+		const PhysicsStats& GetStats() const;
+
+	private:
+		void RunStep(float dt);
+		void RunWorker();
+		void PublishStep();
+
+		PhysicsWorldDef m_def;
+		b2World m_world;
+
+		// Written by whichever thread steps, read after WaitForStep
+		PhysicsStats m_backStats;
+		std::vector<BodyTransform> m_backTransforms;
+		PhysicsStats m_stats;
+		std::vector<BodyTransform> m_transforms;
+
+		// Calling thread only
+		bool m_waitPending{ false };
+
+		// Index into m_transforms by body, built by the first DestroyBody after a step is published
+		std::unordered_map<const b2Body*, size_t> m_transformIndex;
+		bool m_transformIndexValid{ false };
+
+		std::thread m_thread;
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		float m_requestedDt{ 0.0f };
+		bool m_stepRequested{ false };
+		bool m_stepping{ false };
+		bool m_stopRequested{ false };
+	};
+}
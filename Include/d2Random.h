@@ -12,14 +12,65 @@
 #include "d2Rect.h"
 namespace d2d
 {
+	const Uint64 DEFAULT_RANDOM_SEED{ 5489u };
+
+	//+---------------------\-------------------------------------
+	//|	   RandomStream		|
+	//\---------------------/
+	//	A xoshiro128** generator identified by a 64-bit key.
+	//	Keys are derived with the counter-based Philox4x32-10 function:
+	//	a stream's key comes from (seed, streamID), and the key of its n-th
+	//	child comes from (parent key, n). Children therefore depend only on
+	//	the order of Split calls, never on how many numbers were drawn or on
+	//	which thread drew them, so a job system can split one stream per
+	//	worker and replay the same results bit for bit.
+	//	NextFloat and Fill(float) return values in [min,max).
+	//	NextInt and Fill(int) return values in [min,max].
+	//------------------------------------------------------------
+	class RandomStream
+	{
+	public:
+		explicit RandomStream(Uint64 seed = DEFAULT_RANDOM_SEED, Uint64 streamID = 0);
+		void Seed(Uint64 seed, Uint64 streamID = 0);
+		Uint64 GetKey() const;
+
+		// Splitting
+		RandomStream Split();
+		void Split(std::span<RandomStream> childrenOut);
+
+		Uint32 NextUint32();
+		float NextFloatPercent();
+		float NextFloat(const Range<float>& range);
+		int NextInt(const Range<int>& range);
+		bool NextBool();
+		b2Vec2 NextVec2InRect(const Rect& rect);
+		b2Vec2 NextVec2InRange(const b2Vec2& low, const b2Vec2& high);
+
+		void Fill(std::span<float> out, const Range<float>& range);
+		void Fill(std::span<int> out, const Range<int>& range);
+		void FillVec2InRect(std::span<b2Vec2> out, const Rect& rect);
+
+	private:
+		void SetKey(Uint64 key);
+
+		Uint64 m_key;
+		Uint64 m_splitCount;
+		Uint32 m_state[4];
+	};
+
 	//+---------------------\-------------------------------------
 	//|	  Random numbers	|
 	//\---------------------/
-	//	If half_open is TRUE, returns a random value in [0f,1f).
-	//	If half_open is FALSE, returns a random value in [0f,1f].
-	//	The result only has a resolution of RAND_MAX+1 values!
+	//	Wrappers over the calling thread's default RandomStream, so these
+	//	are safe to call from any thread. SeedRandomNumberGenerator and
+	//	SetDefaultRandomStream only affect the calling thread; a job worker
+	//	can install a child stream split from a shared parent to keep its
+	//	results reproducible.
 	//------------------------------------------------------------
+	RandomStream& GetDefaultRandomStream();
+	void SetDefaultRandomStream(const RandomStream& stream);
 	void SeedRandomNumberGenerator(unsigned newSeed = SDL_GetPerformanceCounter());
+	void SeedRandomNumberGenerator(Uint64 newSeed, Uint64 streamID);
 	float RandomFloatPercent();
 	float RandomFloat(const Range<float>& range);
 	int RandomInt(const Range<int>& range);
@@ -27,4 +78,9 @@ namespace d2d
 
 	b2Vec2 RandomVec2InRect(const Rect& rect);
 	b2Vec2 RandomVec2InRange(const b2Vec2& low, const b2Vec2& high);
+
+	// Bulk versions
+	void RandomFloats(std::span<float> out, const Range<float>& range);
+	void RandomInts(std::span<int> out, const Range<int>& range);
+	void RandomVec2sInRect(std::span<b2Vec2> out, const Rect& rect);
 }
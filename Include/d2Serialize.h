@@ -0,0 +1,390 @@
+/**************************************************************************************\
+** File: d2Serialize.h
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Header file for binary serialization templates
+**
+\**************************************************************************************/
+#pragma once
+#include "d2Network.h"
+#include "d2NumberManip.h"
+#include "d2Range.h"
+#include "d2Rect.h"
+#include "d2Utility.h"
+namespace d2d
+{
+	//+--------------------------------\--------------------------------------
+	//|			  BitWriter			   |
+	//\--------------------------------/
+	//	Appends bits to a byte vector, least significant bit first, so
+	//	multi-byte values come out little-endian on any host.
+	//	Call Finish after the last write to store the final partial byte.
+	//------------------------------------------------------------------------
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<Uint8>& buffer)
+			: m_buffer{ buffer }
+		{}
+		void WriteBits(Uint32 value, unsigned numBits)
+		{
+			d2Assert(numBits <= 32);
+			if(numBits < 32)
+				value &= (1u << numBits) - 1;
+			m_scratch |= (Uint64)value << m_scratchBits;
+			m_scratchBits += numBits;
+			while(m_scratchBits >= 8)
+			{
+				m_buffer.push_back((Uint8)m_scratch);
+				m_scratch >>= 8;
+				m_scratchBits -= 8;
+			}
+			m_bitCount += numBits;
+		}
+		void WriteBool(bool value)
+		{
+			WriteBits(value ? 1u : 0u, 1);
+		}
+		void WriteUint64(Uint64 value)
+		{
+			WriteBits((Uint32)value, 32);
+			WriteBits((Uint32)(value >> 32), 32);
+		}
+		void WriteFloat(float value)
+		{
+			WriteBits(std::bit_cast<Uint32>(value), 32);
+		}
+		void Finish()
+		{
+			if(m_scratchBits > 0)
+				m_buffer.push_back((Uint8)m_scratch);
+			m_scratch = 0;
+			m_scratchBits = 0;
+		}
+		size_t GetBitCount() const
+		{
+			return m_bitCount;
+		}
+	private:
+		std::vector<Uint8>& m_buffer;
+		Uint64 m_scratch{ 0 };
+		unsigned m_scratchBits{ 0 };
+		size_t m_bitCount{ 0 };
+	};
+
+	//+--------------------------------\--------------------------------------
+	//|			  BitReader			   |
+	//\--------------------------------/
+	//	Reads what BitWriter wrote. Throws SerializationException when asked
+	//	for more bits than the data holds.
+	//------------------------------------------------------------------------
+	class BitReader
+	{
+	public:
+		explicit BitReader(std::span<const Uint8> data)
+			: m_data{ data }
+		{}
+		Uint32 ReadBits(unsigned numBits)
+		{
+			d2Assert(numBits <= 32);
+			while(m_scratchBits < numBits)
+			{
+				if(m_position >= m_data.size())
+					throw SerializationException{ "Read past the end of serialized data"s };
+				m_scratch |= (Uint64)m_data[m_position++] << m_scratchBits;
+				m_scratchBits += 8;
+			}
+			Uint32 value{ (Uint32)(m_scratch & ((1ull << numBits) - 1)) };
+			m_scratch >>= numBits;
+			m_scratchBits -= numBits;
+			return value;
+		}
+		bool ReadBool()
+		{
+			return ReadBits(1) != 0;
+		}
+		Uint64 ReadUint64()
+		{
+			Uint64 low{ ReadBits(32) };
+			return low | ((Uint64)ReadBits(32) << 32);
+		}
+		float ReadFloat()
+		{
+			return std::bit_cast<float>(ReadBits(32));
+		}
+		// Skips the rest of the current byte, matching BitWriter::Finish
+		void AlignToByte()
+		{
+			m_scratch = 0;
+			m_scratchBits = 0;
+		}
+		bool IsAtEnd() const
+		{
+			return m_position >= m_data.size() && m_scratchBits == 0;
+		}
+		size_t GetBytesRead() const
+		{
+			return m_position;
+		}
+	private:
+		std::span<const Uint8> m_data;
+		size_t m_position{ 0 };
+		Uint64 m_scratch{ 0 };
+		unsigned m_scratchBits{ 0 };
+	};
+
+	//+--------------------------------\--------------------------------------
+	//|			 Quantization		   |
+	//\--------------------------------/
+	//	Floats are clamped to range and mapped onto 2^numBits evenly spaced
+	//	steps that include both ends of the range. Angles are wrapped to
+	//	[0, 2pi) and mapped onto 2^numBits steps around the circle, so they
+	//	decode to [0, 2pi).
+	//------------------------------------------------------------------------
+	inline Uint32 GetMaxQuantizedStep(unsigned numBits)
+	{
+		d2Assert(numBits > 0 && numBits < 32);
+		return (1u << numBits) - 1;
+	}
+	inline Uint32 QuantizeFloat(float value, const Range<float>& range, unsigned numBits)
+	{
+		const Uint32 maxStep{ GetMaxQuantizedStep(numBits) };
+		if(range.GetSize() <= 0.0f)
+			return 0;
+		double percent{ std::clamp(((double)value - range.GetMin()) / range.GetSize(), 0.0, 1.0) };
+		return (Uint32)(percent * maxStep + 0.5);
+	}
+	inline float DequantizeFloat(Uint32 step, const Range<float>& range, unsigned numBits)
+	{
+		const Uint32 maxStep{ GetMaxQuantizedStep(numBits) };
+		return (float)(range.GetMin() + (double)step / maxStep * range.GetSize());
+	}
+	inline Uint32 QuantizeAngle(float radians, unsigned numBits)
+	{
+		const Uint32 maxStep{ GetMaxQuantizedStep(numBits) };
+		double percent{ (double)GetWrappedRadians(radians) / TWO_PI };
+		return (Uint32)(percent * (maxStep + 1.0) + 0.5) & maxStep;
+	}
+	inline float DequantizeAngle(Uint32 step, unsigned numBits)
+	{
+		const Uint32 maxStep{ GetMaxQuantizedStep(numBits) };
+		return (float)((double)step / (maxStep + 1.0) * TWO_PI);
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			  Schemas			   |
+	//\--------------------------------/
+	//	A type is Serializable when it has a static fields() function that
+	//	returns a tuple of field descriptors, for example:
+	//
+	//		struct ShipState
+	//		{
+	//			b2Vec2 position;
+	//			float angle;
+	//			bool thrusting;
+	//			Uint16 health;
+	//			static auto fields()
+	//			{
+	//				return std::make_tuple(
+	//					MakeQuantizedField(&ShipState::position, WORLD_RECT, 16),
+	//					MakeAngleField(&ShipState::angle, 10),
+	//					MakeField(&ShipState::thrusting),
+	//					MakeBitsField(&ShipState::health, 10));
+	//			}
+	//		};
+	//
+	//	MakeField writes arithmetic types at full width (bool as 1 bit),
+	//	enums as their underlying type, b2Vec2 as two floats, and nested
+	//	Serializable types field by field.
+	//	MakeBitsField packs an unsigned integer or enum into numBits bits.
+	//------------------------------------------------------------------------
+	template <typename T>
+	concept Serializable = requires { T::fields(); };
+
+	template <Serializable T> void Serialize(BitWriter& writer, const T& object);
+	template <Serializable T> void Deserialize(BitReader& reader, T& object);
+
+	template <typename T> void WriteValue(BitWriter& writer, const T& value)
+	{
+		if constexpr(Serializable<T>)
+			Serialize(writer, value);
+		else if constexpr(std::is_same_v<T, bool>)
+			writer.WriteBool(value);
+		else if constexpr(std::is_enum_v<T>)
+			WriteValue(writer, (std::underlying_type_t<T>)value);
+		else if constexpr(std::is_same_v<T, float>)
+			writer.WriteFloat(value);
+		else if constexpr(std::is_same_v<T, double>)
+			writer.WriteUint64(std::bit_cast<Uint64>(value));
+		else if constexpr(std::is_integral_v<T> && sizeof(T) == 8)
+			writer.WriteUint64((Uint64)value);
+		else if constexpr(std::is_integral_v<T>)
+			writer.WriteBits((Uint32)value, sizeof(T) * 8);
+		else if constexpr(std::is_same_v<T, b2Vec2>)
+		{
+			writer.WriteFloat(value.x);
+			writer.WriteFloat(value.y);
+		}
+		else
+			static_assert(sizeof(T) == 0, "Type has no serialization; give it a fields() function");
+	}
+	template <typename T> void ReadValue(BitReader& reader, T& value)
+	{
+		if constexpr(Serializable<T>)
+			Deserialize(reader, value);
+		else if constexpr(std::is_same_v<T, bool>)
+			value = reader.ReadBool();
+		else if constexpr(std::is_enum_v<T>)
+		{
+			std::underlying_type_t<T> underlying;
+			ReadValue(reader, underlying);
+			value = (T)underlying;
+		}
+		else if constexpr(std::is_same_v<T, float>)
+			value = reader.ReadFloat();
+		else if constexpr(std::is_same_v<T, double>)
+			value = std::bit_cast<double>(reader.ReadUint64());
+		else if constexpr(std::is_integral_v<T> && sizeof(T) == 8)
+			value = (T)reader.ReadUint64();
+		else if constexpr(std::is_integral_v<T>)
+			value = (T)reader.ReadBits(sizeof(T) * 8);
+		else if constexpr(std::is_same_v<T, b2Vec2>)
+		{
+			value.x = reader.ReadFloat();
+			value.y = reader.ReadFloat();
+		}
+		else
+			static_assert(sizeof(T) == 0, "Type has no serialization; give it a fields() function");
+	}
+
+	// Field descriptors
+	template <typename C, typename T>
+	struct Field
+	{
+		T C::* member;
+		void Write(BitWriter& writer, const C& object) const
+		{
+			WriteValue(writer, object.*member);
+		}
+		void Read(BitReader& reader, C& object) const
+		{
+			ReadValue(reader, object.*member);
+		}
+	};
+	template <typename C, typename T>
+	struct BitsField
+	{
+		static_assert(std::is_enum_v<T> || std::is_unsigned_v<T>, "BitsField holds unsigned integers and enums");
+		T C::* member;
+		unsigned numBits;
+		void Write(BitWriter& writer, const C& object) const
+		{
+			d2Assert(numBits == 32 || (Uint64)(object.*member) < (1ull << numBits));
+			writer.WriteBits((Uint32)(object.*member), numBits);
+		}
+		void Read(BitReader& reader, C& object) const
+		{
+			object.*member = (T)reader.ReadBits(numBits);
+		}
+	};
+	template <typename C>
+	struct QuantizedFloatField
+	{
+		float C::* member;
+		Range<float> range;
+		unsigned numBits;
+		void Write(BitWriter& writer, const C& object) const
+		{
+			writer.WriteBits(QuantizeFloat(object.*member, range, numBits), numBits);
+		}
+		void Read(BitReader& reader, C& object) const
+		{
+			object.*member = DequantizeFloat(reader.ReadBits(numBits), range, numBits);
+		}
+	};
+	// numBits per axis
+	template <typename C>
+	struct QuantizedVec2Field
+	{
+		b2Vec2 C::* member;
+		Rect bounds;
+		unsigned numBits;
+		void Write(BitWriter& writer, const C& object) const
+		{
+			const b2Vec2& value{ object.*member };
+			writer.WriteBits(QuantizeFloat(value.x, { bounds.lowerBound.x, bounds.upperBound.x }, numBits), numBits);
+			writer.WriteBits(QuantizeFloat(value.y, { bounds.lowerBound.y, bounds.upperBound.y }, numBits), numBits);
+		}
+		void Read(BitReader& reader, C& object) const
+		{
+			b2Vec2& value{ object.*member };
+			value.x = DequantizeFloat(reader.ReadBits(numBits), { bounds.lowerBound.x, bounds.upperBound.x }, numBits);
+			value.y = DequantizeFloat(reader.ReadBits(numBits), { bounds.lowerBound.y, bounds.upperBound.y }, numBits);
+		}
+	};
+	template <typename C>
+	struct AngleField
+	{
+		float C::* member;
+		unsigned numBits;
+		void Write(BitWriter& writer, const C& object) const
+		{
+			writer.WriteBits(QuantizeAngle(object.*member, numBits), numBits);
+		}
+		void Read(BitReader& reader, C& object) const
+		{
+			object.*member = DequantizeAngle(reader.ReadBits(numBits), numBits);
+		}
+	};
+
+	// Field descriptor factories
+	template <typename C, typename T> Field<C, T> MakeField(T C::* member)
+	{
+		return { member };
+	}
+	template <typename C, typename T> BitsField<C, T> MakeBitsField(T C::* member, unsigned numBits)
+	{
+		return { member, numBits };
+	}
+	template <typename C> QuantizedFloatField<C> MakeQuantizedField(float C::* member, const Range<float>& range, unsigned numBits)
+	{
+		return { member, range, numBits };
+	}
+	template <typename C> QuantizedVec2Field<C> MakeQuantizedField(b2Vec2 C::* member, const Rect& bounds, unsigned numBits)
+	{
+		return { member, bounds, numBits };
+	}
+	template <typename C> AngleField<C> MakeAngleField(float C::* member, unsigned numBits)
+	{
+		return { member, numBits };
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|		   Serialize/Deserialize   |
+	//\--------------------------------/
+	//	SerializeTo appends to the message's payload buffer in place, so a
+	//	message can be built and then passed to ClientTcpSocket::QueueSend
+	//	without another copy. Each SerializeTo call starts on a byte boundary.
+	//------------------------------------------------------------------------
+	template <Serializable T> void Serialize(BitWriter& writer, const T& object)
+	{
+		std::apply([&](const auto&... fields) { (fields.Write(writer, object), ...); }, T::fields());
+	}
+	template <Serializable T> void Deserialize(BitReader& reader, T& object)
+	{
+		std::apply([&](const auto&... fields) { (fields.Read(reader, object), ...); }, T::fields());
+	}
+	template <Serializable T> void SerializeTo(NetworkMessage& message, const T& object)
+	{
+		BitWriter writer{ message.GetBuffer() };
+		Serialize(writer, object);
+		writer.Finish();
+	}
+	template <Serializable T> void DeserializeFrom(const NetworkMessage& message, T& object)
+	{
+		BitReader reader{ message.GetPayload() };
+		Deserialize(reader, object);
+	}
+}
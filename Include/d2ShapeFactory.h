@@ -21,16 +21,19 @@ namespace d2d
 		b2Vec2 center;
 		float radiusRelativeToWidth;
 	};
+	// A polygon group's polygons are Body::polygons[firstPolygon, firstPolygon + numPolygons)
 	struct FixtureGroup
 	{
 		bool isCircle;
 		CircleShape circle;
-		std::vector<PolygonShape> polygons;
+		unsigned firstPolygon;
+		unsigned numPolygons;
 	};
 	struct Body
 	{
 		b2Vec2 sourceImageSize;
 		std::vector<FixtureGroup> fixtureGroups;
+		std::vector<PolygonShape> polygons;
 	};
 	const float MATERIAL_DEFAULT_DENSITY	{ 1.0f };
 	const float MATERIAL_DEFAULT_FRICTION	{ 0.4f };
@@ -64,21 +67,136 @@ namespace d2d
 		}
 		b2Filter filter;
 	};
+	//+--------------------------------\--------------------------------------
+	//|			 ShapeFactory		   |
+	//\--------------------------------/
+	//	AddShapes builds Box2D shapes from a loaded model, scaled to size and
+	//	moved by the local position and angle. The built shapes are cached
+	//	under (model, size, position, angle), so spawning many bodies from
+	//	the same arguments transforms the vertices and computes the polygon
+	//	hulls only once. Keys compare exactly, so cache hits need the same
+	//	float values each time, and they must be finite. Once the cache
+	//	holds shapeCacheCapacity entries, the next miss empties it before
+	//	caching its own shapes, so arguments that are no longer used cannot
+	//	keep the ones in use out. Loading a model again drops its cached shapes.
+	//
+	//	Each model name gets a ModelHandle when first loaded, and keeps it
+	//	when reloaded. Look the handle up once with GetModelHandle and spawn
+	//	with it; the string overload of AddShapes does the lookup every call.
+	//
+	//	LoadFrom reads either the body XML or the binary body format, which
+	//	it recognizes by BODY_FILE_MAGIC. XML is parsed in one streaming
+	//	pass with no DOM. The binary format holds the same data with
+	//	coordinates already divided by the image size, little-endian:
+	//		"D2BD", Uint32 version, Uint32 body count, then for each body:
+	//		Uint32 name bytes, name, float width, float height, Uint32 group
+	//		count, then for each group a Uint8 type and either a circle
+	//		(float x, y, radius) or a Uint32 polygon count followed by
+	//		polygons (Uint8 vertex count, float x and y per vertex).
+	//	SaveBinary writes every loaded model in that format, so converting
+	//	a file is LoadFrom on the XML followed by SaveBinary.
+	//	A file is parsed completely before any model is replaced, so a file
+	//	that fails to load leaves the loaded models as they were. LoadFrom
+	//	throws FileException if the file cannot be read and InitException if
+	//	its contents are bad.
+	//
+	//	SpawnBodies creates one body per BodySpawn from bodyDef, each with
+	//	the model's fixtures, sharing one cached shape set and fixture def.
+	//	The bodies go to bodiesOut and the fixtures to fixturesOut, which
+	//	holds GetFixtureCount(model) entries per body in spawn order. Either
+	//	buffer may be empty if the caller does not need the pointers.
+	//------------------------------------------------------------------------
+	using ModelHandle = unsigned;
+	const char BODY_FILE_MAGIC[4]{ 'D', '2', 'B', 'D' };
+	const Uint32 BODY_FILE_VERSION{ 1 };
+	const size_t SHAPE_CACHE_DEFAULT_CAPACITY{ 1024 };
+	struct BodySpawn
+	{
+		b2Vec2 position{ b2Vec2_zero };
+		float angle{ 0.0f };
+		b2Vec2 linearVelocity{ b2Vec2_zero };
+		float angularVelocity{ 0.0f };
+	};
+	struct ShapeCacheStats
+	{
+		Uint64 hits{ 0 };
+		Uint64 misses{ 0 };
+		size_t entries{ 0 };
+
+		// Times the cache was full and had to be emptied
+		Uint64 flushes{ 0 };
+	};
 	class ShapeFactory
 	{
 	public:
 		void LoadFrom(const std::string& filePath);
+		void SaveBinary(const std::string& filePath) const;
 		b2Fixture* AddCircleShape(b2Body& bodyRef, float size,
 			const d2d::Material& material, const Filter& filter,
 			bool isSensor = false, const b2Vec2& position = b2Vec2_zero);
 		b2Fixture* AddRectShape(b2Body& bodyRef, const b2Vec2& size,
 			const d2d::Material& material, const Filter& filter,
 			bool isSensor = false, const b2Vec2& position = b2Vec2_zero, float angle = 0.0f);
+		std::vector<b2Fixture*> AddShapes(b2Body& bodyRef, const b2Vec2& size, ModelHandle model,
+			const Material& material, const Filter& filter, bool isSensor=false,
+			const b2Vec2& position = b2Vec2_zero, float angle = 0.0f);
 		std::vector<b2Fixture*> AddShapes(b2Body& bodyRef, const b2Vec2& size, const std::string& modelName,
 			const Material& material, const Filter& filter, bool isSensor=false,
 			const b2Vec2& position = b2Vec2_zero, float angle = 0.0f);
 
+		// Batch spawning
+		size_t GetFixtureCount(ModelHandle model) const;
+		void SpawnBodies(b2World& world, const b2BodyDef& bodyDef, ModelHandle model, const b2Vec2& size,
+			const Material& material, const Filter& filter, std::span<const BodySpawn> spawns,
+			std::span<b2Body*> bodiesOut, std::span<b2Fixture*> fixturesOut, bool isSensor = false);
+
+		// Models
+		ModelHandle GetModelHandle(const std::string& modelName) const;
+		bool HasModel(const std::string& modelName) const;
+		const Body& GetModel(ModelHandle model) const;
+		size_t GetModelCount() const;
+
+		// Shape cache; capacity must be at least 1
+		void SetShapeCacheCapacity(size_t capacity);
+		void ClearShapeCache();
+		const ShapeCacheStats& GetShapeCacheStats() const;
+
 	private:
-		std::map<std::string, Body> m_bodyMap;
+		// Indexed by ModelHandle
+		std::vector<Body> m_bodies;
+		std::vector<std::string> m_modelNames;
+		std::unordered_map<std::string, ModelHandle> m_modelHandles;
+
+		// Loading
+		Body& BeginModel(const std::string& modelName);
+		Body& AddParsedModel(std::string_view modelName);
+		void CommitParsedModels();
+		void LoadXml(std::string_view text, const std::string& filePath);
+		void LoadBinary(std::span<const Uint8> data, const std::string& filePath);
+		std::vector<std::pair<std::string, Body>> m_parsedModels;
+		size_t m_numParsedModels{ 0 };
+
+		struct ShapeCacheKey
+		{
+			b2Vec2 size;
+			b2Vec2 position;
+			float angle;
+			bool operator<(const ShapeCacheKey& other) const;
+		};
+
+		// Shapes in fixture order; each pointer is into circles or polygons
+		struct ShapeSet
+		{
+			std::vector<b2CircleShape> circles;
+			std::vector<b2PolygonShape> polygons;
+			std::vector<const b2Shape*> shapes;
+		};
+		const ShapeSet& GetShapeSet(ModelHandle model, const ShapeCacheKey& key);
+		void BuildShapes(const Body& body, const ShapeCacheKey& key, ShapeSet& shapeSetOut) const;
+
+		// Cached shapes, indexed by ModelHandle
+		std::vector<std::map<ShapeCacheKey, ShapeSet>> m_shapeCache;
+		size_t m_shapeCacheCapacity{ SHAPE_CACHE_DEFAULT_CAPACITY };
+		ShapeCacheStats m_shapeCacheStats;
 	};
 }
@@ -0,0 +1,58 @@
+/**************************************************************************************\
+** File: d2Simd.h
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Header file for SIMD instruction set selection and runtime dispatch
+**
+\**************************************************************************************/
+#pragma once
+
+// D2_SIMD_SSE2: SSE2 is part of the x86-64 baseline, so it is used unconditionally
+//	whenever the compiler targets it.
+// D2_SIMD_AVX: AVX code paths are compiled in with per-function target attributes
+//	and only selected at runtime when the CPU supports them (see CpuHasAVX()).
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define D2_SIMD_SSE2
+#include <immintrin.h>
+#endif
+
+#if defined(D2_SIMD_SSE2) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define D2_SIMD_AVX
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define D2_TARGET_AVX __attribute__((target("avx")))
+#else
+#define D2_TARGET_AVX
+#endif
+
+namespace d2d
+{
+	namespace SimdInternal
+	{
+		inline bool& AVXSelected()
+		{
+#ifdef D2_SIMD_AVX
+			static bool selected{ SDL_HasAVX() == SDL_TRUE };
+#else
+			static bool selected{ false };
+#endif
+			return selected;
+		}
+	}
+	// Cached result of SDL's CPU feature detection
+	inline bool CpuHasAVX()
+	{
+		return SimdInternal::AVXSelected();
+	}
+	// Lets tests and benchmarks run the SSE2 paths on an AVX machine.
+	//	Enabling has no effect when the CPU lacks AVX. Not thread-safe.
+	inline void SetAVXEnabled(bool enabled)
+	{
+#ifdef D2_SIMD_AVX
+		SimdInternal::AVXSelected() = enabled && SDL_HasAVX() == SDL_TRUE;
+#endif
+	}
+}
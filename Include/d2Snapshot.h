@@ -0,0 +1,148 @@
+/**************************************************************************************\
+** File: d2Snapshot.h
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Header file for delta-compressed world snapshot replication
+**
+\**************************************************************************************/
+#pragma once
+#include "d2Network.h"
+#include "d2Range.h"
+#include "d2Rect.h"
+namespace d2d
+{
+	//+--------------------------------\--------------------------------------
+	//|			 SnapshotDef		   |
+	//\--------------------------------/
+	//	Quantization settings shared by server and client; both sides must
+	//	use the same def. Positions are clamped to worldBounds, velocities to
+	//	their ranges. Angles wrap, so they decode to [0, 2pi).
+	//	historySize is how many past snapshots each side keeps as possible
+	//	baselines. A client that has not acked anything within that window
+	//	gets a full snapshot.
+	//------------------------------------------------------------------------
+	struct SnapshotDef
+	{
+		Rect worldBounds{ { -1000.0f, -1000.0f }, { 1000.0f, 1000.0f } };
+		unsigned positionBits{ 18 };
+		unsigned angleBits{ 12 };
+		Range<float> velocityRange{ -64.0f, 64.0f };
+		unsigned velocityBits{ 14 };
+		Range<float> angularVelocityRange{ -32.0f, 32.0f };
+		unsigned angularVelocityBits{ 12 };
+		unsigned historySize{ 32 };
+	};
+	struct EntityState
+	{
+		b2Vec2 position{ b2Vec2_zero };
+		float angle{ 0.0f };
+		b2Vec2 velocity{ b2Vec2_zero };
+		float angularVelocity{ 0.0f };
+	};
+
+	//+--------------------------------\--------------------------------------
+	//|		  Snapshot encoding		   |
+	//\--------------------------------/
+	//	Entities live in numbered slots. Each tick the server quantizes every
+	//	slot and keeps the result in a ring of recent snapshots. A client's
+	//	snapshot is encoded against the newest snapshot that client has
+	//	acked. Per slot the encoding is:
+	//		1 bit: changed since baseline
+	//		if changed, 1 bit: present
+	//		if present, a bitmask of changed fields, then each changed field
+	//			as a small signed delta when it fits, otherwise in full.
+	//	Unchanged slots therefore cost one bit.
+	//------------------------------------------------------------------------
+	enum class SnapshotField : unsigned
+	{
+		POSITION_X, POSITION_Y, ANGLE, VELOCITY_X, VELOCITY_Y, ANGULAR_VELOCITY, COUNT
+	};
+	const unsigned NUM_SNAPSHOT_FIELDS{ (unsigned)SnapshotField::COUNT };
+	struct QuantizedEntityState
+	{
+		bool present{ false };
+		std::array<Uint32, NUM_SNAPSHOT_FIELDS> fields{};
+	};
+	struct Snapshot
+	{
+		Uint32 sequence{ 0 };
+		std::vector<QuantizedEntityState> slots;
+	};
+
+	//+--------------------------------\--------------------------------------
+	//|			SnapshotServer		   |
+	//\--------------------------------/
+	//	Clients are keyed by ConnectionID so the server can sit directly on a
+	//	NetworkReactor: call WriteSnapshot from the tick and pass it to Send,
+	//	and call ReadAck from onMessage.
+	//------------------------------------------------------------------------
+	class SnapshotServer
+	{
+	public:
+		explicit SnapshotServer(const SnapshotDef& def = SnapshotDef{});
+
+		void SetEntity(unsigned slot, const EntityState& state);
+		void RemoveEntity(unsigned slot);
+		void ClearEntities();
+
+		// Quantizes the current entity states into a new snapshot and returns its sequence
+		Uint32 Capture();
+
+		void AddClient(ConnectionID id);
+		void RemoveClient(ConnectionID id);
+
+		// Replaces message with the latest captured snapshot, delta encoded
+		//	against the client's newest acked snapshot
+		void WriteSnapshot(ConnectionID id, NetworkMessage& message);
+
+		// Returns false, changing nothing, if the client is unknown or the
+		//	message is not a well formed ack. Acks that are stale, or name a
+		//	snapshot not written to this client, are accepted but ignored.
+		bool ReadAck(ConnectionID id, const NetworkMessage& message);
+		Uint32 GetAckedSequence(ConnectionID id) const;
+
+	private:
+		const Snapshot* FindSnapshot(Uint32 sequence) const;
+
+		SnapshotDef m_def;
+		std::vector<EntityState> m_entityStates;
+		std::vector<bool> m_entityPresent;
+		std::vector<Snapshot> m_history;
+		Uint32 m_latestSequence{ 0 };
+
+		// Indexed by ConnectionID; sequence 0 means no ack yet
+		std::vector<Uint32> m_ackedSequences;
+		std::vector<bool> m_clientActive;
+
+		// historySize entries per client, indexed like m_history: the
+		//	sequence last written to that client in each history slot
+		std::vector<Uint32> m_sentSequences;
+	};
+
+	//+--------------------------------\--------------------------------------
+	//|			SnapshotClient		   |
+	//\--------------------------------/
+	class SnapshotClient
+	{
+	public:
+		explicit SnapshotClient(const SnapshotDef& def = SnapshotDef{});
+
+		// Returns false for a snapshot older than the latest one
+		bool ReadSnapshot(const NetworkMessage& message);
+		void WriteAck(NetworkMessage& message) const;
+
+		Uint32 GetLatestSequence() const;
+		unsigned GetSlotCount() const;
+
+		// Returns false if the slot is empty
+		bool GetEntity(unsigned slot, EntityState& stateOut) const;
+
+	private:
+		SnapshotDef m_def;
+		std::vector<Snapshot> m_history;
+		Snapshot m_decoded;
+		Uint32 m_latestSequence{ 0 };
+	};
+}
@@ -0,0 +1,91 @@
+/**************************************************************************************\
+** File: d2SpscQueue.h
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Header file for the SpscQueue template
+**
+\**************************************************************************************/
+#pragma once
+namespace d2d
+{
+	//+--------------------------------\--------------------------------------
+	//|			  SpscQueue			   |
+	//\--------------------------------/
+	//	Bounded lock-free queue for exactly one producer thread and one
+	//	consumer thread. Capacity is rounded up to a power of two.
+	//	TryPush and TryPop never block; they return false when the queue is
+	//	full or empty. Elements are swapped in and out of reused slots, so
+	//	after a successful TryPush the argument holds a recycled element
+	//	rather than an empty one. Types that own memory, like NetworkMessage,
+	//	therefore keep circulating their allocations instead of freeing them.
+	//------------------------------------------------------------------------
+	template <typename T>
+	class SpscQueue
+	{
+	public:
+		explicit SpscQueue(size_t capacity)
+		{
+			size_t roundedCapacity{ 1 };
+			while(roundedCapacity < capacity)
+				roundedCapacity <<= 1;
+			m_slots.resize(roundedCapacity);
+			m_mask = roundedCapacity - 1;
+		}
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		// Producer only
+		bool TryPush(T& value)
+		{
+			const size_t tail{ m_tail.load(std::memory_order_relaxed) };
+			if(tail - m_cachedHead > m_mask)
+			{
+				m_cachedHead = m_head.load(std::memory_order_acquire);
+				if(tail - m_cachedHead > m_mask)
+					return false;
+			}
+			std::swap(m_slots[tail & m_mask], value);
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer only
+		bool TryPop(T& valueOut)
+		{
+			const size_t head{ m_head.load(std::memory_order_relaxed) };
+			if(head == m_cachedTail)
+			{
+				m_cachedTail = m_tail.load(std::memory_order_acquire);
+				if(head == m_cachedTail)
+					return false;
+			}
+			std::swap(valueOut, m_slots[head & m_mask]);
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Approximate when called while the other thread is active
+		size_t GetSize() const
+		{
+			return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+		}
+		size_t GetCapacity() const
+		{
+			return m_mask + 1;
+		}
+
+	private:
+		std::vector<T> m_slots;
+		size_t m_mask;
+
+		// Producer and consumer indices on separate cache lines. Each side
+		//	caches the other's index so it only reads the shared one when
+		//	the queue looks full or empty.
+		alignas(64) std::atomic<size_t> m_head{ 0 };
+		size_t m_cachedTail{ 0 };
+		alignas(64) std::atomic<size_t> m_tail{ 0 };
+		size_t m_cachedHead{ 0 };
+	};
+}
@@ -0,0 +1,208 @@
+/**************************************************************************************\
+** File: d2UdpConnection.h
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Header file for the UdpConnection reliability layer and SimulatedLink
+**
+\**************************************************************************************/
+#pragma once
+#include "d2Network.h"
+#include "d2Random.h"
+namespace d2d
+{
+	//+--------------------------------\--------------------------------------
+	//|			UdpConnection		   |
+	//\--------------------------------/
+	//	A connection to one peer over any DatagramTransport. Every packet
+	//	starts with a 9 byte header:
+	//		sequence (16 bits), ack (16 bits), ack bitfield (32 bits), flags (8 bits)
+	//	ack is the newest sequence received from the peer, and bit n of the
+	//	bitfield acks sequence (ack - 1 - n). A packet is therefore acked as
+	//	long as any of the next 33 packets from the peer gets through.
+	//
+	//	Queued messages are coalesced into packets of at most mtuBytes.
+	//	UNRELIABLE messages are sent once and may be lost or reordered.
+	//	RELIABLE_ORDERED messages are resent every resendMilliseconds until a
+	//	packet carrying them is acked, and are delivered in the order queued.
+	//	A message must fit in one packet: there is no fragmentation.
+	//------------------------------------------------------------------------
+	enum class UdpChannel : Uint8
+	{
+		UNRELIABLE, RELIABLE_ORDERED
+	};
+	struct UdpConnectionDef
+	{
+		size_t mtuBytes{ 1200 };
+		Uint32 resendMilliseconds{ 100 };
+
+		// Most reliable messages that can be in flight at once (at most 32768).
+		//	Rounded up to a power of two, so that window slots divide the
+		//	16-bit ID space evenly and IDs keep their slot across wraparound.
+		unsigned reliableWindowSize{ 1024 };
+	};
+	struct UdpConnectionStats
+	{
+		Uint64 packetsSent{ 0 };
+		Uint64 packetsReceived{ 0 };
+		Uint64 packetsAcked{ 0 };
+
+		// Sent packets that dropped out of the history without being acked
+		Uint64 packetsLost{ 0 };
+
+		// Received packets that were duplicates, too old or malformed
+		Uint64 packetsDropped{ 0 };
+		Uint64 messagesSent{ 0 };
+		Uint64 messagesReceived{ 0 };
+		Uint64 reliableResends{ 0 };
+		float roundTripMilliseconds{ 0.0f };
+	};
+	class UdpConnection
+	{
+	public:
+		UdpConnection(DatagramTransport& transport, const IpAddress& peer, const UdpConnectionDef& def = UdpConnectionDef{});
+
+		// Copies the payload, which goes out on the next Flush. Throws
+		//	NetworkException if the message does not fit in one packet, or
+		//	if it is reliable and IsReliableWindowFull().
+		void Queue(std::span<const Uint8> payload, UdpChannel channel);
+		void Queue(const NetworkMessage& message, UdpChannel channel);
+
+		// Processes every datagram waiting on the transport, then flushes.
+		//	Datagrams from other addresses are discarded, so a server with
+		//	many peers should read its transport itself and pass each
+		//	datagram to the right connection's ProcessPacket.
+		void Update(Uint32 nowMilliseconds = SDL_GetTicks());
+		void ProcessPacket(std::span<const Uint8> packet, Uint32 nowMilliseconds);
+
+		// Sends queued messages and due resends. Sends an ack-only packet if
+		//	anything was received since the last send and nothing else is queued.
+		void Flush(Uint32 nowMilliseconds);
+
+		// Returns false when no message has been delivered
+		bool Receive(NetworkMessage& messageOut);
+
+		const IpAddress& GetPeer() const;
+		const UdpConnectionStats& GetStats() const;
+		unsigned GetUnackedReliableCount() const;
+
+		// True when no reliable message can be queued until older ones are acked
+		bool IsReliableWindowFull() const;
+
+	private:
+		void StartPacket();
+		void SendPacket(Uint32 nowMilliseconds);
+		void ProcessAck(Uint16 sequence, Uint32 nowMilliseconds);
+		bool ProcessMessages(const Uint8* data, size_t numBytes);
+		void DeliverReliable(Uint16 id, const Uint8* data, size_t numBytes);
+
+		DatagramTransport& m_transport;
+		IpAddress m_peer;
+		UdpConnectionDef m_def;
+		UdpConnectionStats m_stats;
+
+		// Packet acks. m_sentPackets is a ring indexed by sequence.
+		struct SentPacket
+		{
+			bool inUse{ false };
+			bool acked{ false };
+			Uint16 sequence{ 0 };
+			Uint32 sendTime{ 0 };
+			std::vector<Uint16> reliableIDs;
+		};
+		std::vector<SentPacket> m_sentPackets;
+		Uint16 m_nextSequence{ 0 };
+		bool m_receivedAny{ false };
+		bool m_ackPending{ false };
+		Uint16 m_remoteSequence{ 0 };
+		Uint32 m_remoteAckBits{ 0 };
+
+		// Reliable-ordered channel. Both windows are rings indexed by
+		//	message ID & m_reliableWindowMask.
+		struct ReliableMessage
+		{
+			bool inUse{ false };
+			bool everSent{ false };
+			Uint16 id{ 0 };
+			Uint32 lastSendTime{ 0 };
+			std::vector<Uint8> payload;
+		};
+		Uint16 m_reliableWindowMask{ 0 };
+		std::vector<ReliableMessage> m_sendWindow;
+		Uint16 m_oldestUnackedID{ 0 };
+		Uint16 m_nextReliableID{ 0 };
+		std::vector<ReliableMessage> m_receiveWindow;
+		Uint16 m_nextExpectedID{ 0 };
+
+		std::vector<std::vector<Uint8>> m_unreliableQueue;
+		size_t m_numUnreliableQueued{ 0 };
+		std::queue<std::vector<Uint8>> m_received;
+
+		// Reused scratch space
+		std::vector<Uint8> m_packet;
+		std::vector<Uint16> m_packetReliableIDs;
+		std::vector<Uint8> m_datagram;
+	};
+
+	//+--------------------------------\--------------------------------------
+	//|			SimulatedLink		   |
+	//\--------------------------------/
+	//	Two in-memory DatagramTransport endpoints joined by a link that drops,
+	//	delays and jitters datagrams, so UdpConnection can be exercised
+	//	without a network. Jitter can reorder datagrams, as a real network can.
+	//	The link keeps its own clock: a datagram becomes receivable once
+	//	SetTime reaches its delivery time.
+	//------------------------------------------------------------------------
+	struct SimulatedLinkDef
+	{
+		float lossPercent{ 0.0f };
+		Uint32 latencyMilliseconds{ 0 };
+		Uint32 jitterMilliseconds{ 0 };
+	};
+	class SimulatedLink
+	{
+	public:
+		explicit SimulatedLink(const SimulatedLinkDef& def = SimulatedLinkDef{}, const RandomStream& randomStream = RandomStream{});
+		SimulatedLink(const SimulatedLink&) = delete;
+		SimulatedLink& operator=(const SimulatedLink&) = delete;
+
+		// index is 0 or 1
+		DatagramTransport& GetEndpoint(unsigned index);
+		IpAddress GetAddress(unsigned index) const;
+
+		void SetDef(const SimulatedLinkDef& def);
+		void SetTime(Uint32 milliseconds);
+		Uint64 GetDroppedCount() const;
+
+	private:
+		class Endpoint : public DatagramTransport
+		{
+		public:
+			Endpoint(SimulatedLink& link, unsigned index);
+			bool Send(const IpAddress& destination, std::span<const Uint8> data) override;
+			bool Receive(std::vector<Uint8>& dataOut, IpAddress& sourceOut) override;
+		private:
+			SimulatedLink& m_link;
+			unsigned m_index;
+		};
+		struct Datagram
+		{
+			Uint32 deliveryTime;
+			Uint64 order;
+			std::vector<Uint8> data;
+		};
+		void Send(unsigned fromIndex, std::span<const Uint8> data);
+		bool Receive(unsigned toIndex, std::vector<Uint8>& dataOut);
+
+		SimulatedLinkDef m_def;
+		RandomStream m_randomStream;
+		Uint32 m_time{ 0 };
+		Uint64 m_nextOrder{ 0 };
+		Uint64 m_droppedCount{ 0 };
+
+		// Indexed by destination endpoint
+		std::array<std::vector<Datagram>, 2> m_inFlight;
+		std::array<Endpoint, 2> m_endpoints;
+	};
+}
@@ -74,12 +74,24 @@ namespace d2d
 	{
 		using Exception::Exception;
 	};
+	struct CompressionException : public Exception
+	{
+		using Exception::Exception;
+	};
+	struct SerializationException : public Exception
+	{
+		using Exception::Exception;
+	};
 	struct TextureException : public Exception
 	{
 		using Exception::Exception;
 	};
+	struct FileException : public Exception
+	{
+		using Exception::Exception;
+	};
 
-	// Physics
+	// Physics (see d2BodyState.h for many bodies at once)
 	float CalculateKineticEnergy(b2Body* bodyPtr);
 
 	// Alignment
@@ -101,6 +113,7 @@ namespace d2d
 	// Gamepads
 	float AxisToUnit(Sint16 value, float deadZone = 6700.0f, float aliveZone = 2000.0f);
 
-	// Files
+	// Files (see d2File.h for buffers and mapping)
+	// Reads through the virtual file system. Throws FileException if the file cannot be read.
 	std::string FileToString(const std::string& filePath);
 }
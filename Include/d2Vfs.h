@@ -0,0 +1,119 @@
+/**************************************************************************************\
+** File: d2Vfs.h
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Header file for packed asset archives and the virtual file system
+**
+\**************************************************************************************/
+#pragma once
+#include "d2File.h"
+namespace d2d
+{
+	//+--------------------------------\--------------------------------------
+	//|			   Archive			   |
+	//\--------------------------------/
+	//	A packed file of many assets, memory-mapped and looked up by path.
+	//	Little-endian layout:
+	//		"D2PK", Uint32 version, Uint32 entry count, then the table of
+	//		contents sorted by path, with for each entry: Uint64 offset,
+	//		Uint32 stored size, Uint32 size, Uint8 flags, Uint32 path bytes,
+	//		path. Entry data follows, each starting on an ARCHIVE_ALIGNMENT
+	//		byte boundary.
+	//	Entries flagged ARCHIVE_ENTRY_COMPRESSED hold d2Compression LZ data
+	//	and are at most MAX_DECOMPRESSED_BYTES when decompressed. Paths use
+	//	'/' separators. Throws FileException if the archive is malformed.
+	//------------------------------------------------------------------------
+	const size_t ARCHIVE_ALIGNMENT{ 64 };
+	const Uint8 ARCHIVE_ENTRY_COMPRESSED{ 1 };
+	struct ArchiveEntry
+	{
+		std::string path;
+		Uint64 offset;
+		Uint32 storedSize;
+		Uint32 size;
+		Uint8 flags;
+		bool IsCompressed() const
+		{
+			return (flags & ARCHIVE_ENTRY_COMPRESSED) != 0;
+		}
+	};
+	class Archive
+	{
+	public:
+		explicit Archive(const std::string& archivePath);
+		// Returns nullptr if the archive has no entry with this path
+		const ArchiveEntry* Find(std::string_view path) const;
+		// The entry's bytes as stored, viewed in place
+		std::span<const Uint8> GetStoredBytes(const ArchiveEntry& entry) const;
+		const std::vector<ArchiveEntry>& GetEntries() const
+		{
+			return m_entries;
+		}
+		const std::string& GetPath() const
+		{
+			return m_archivePath;
+		}
+	private:
+		std::string m_archivePath;
+		MappedFile m_file;
+		std::vector<ArchiveEntry> m_entries;
+	};
+
+	// A file to pack: its path in the archive, and where to read it from
+	struct ArchiveSource
+	{
+		std::string path;
+		std::string filePath;
+	};
+	// Every file under directory, with archive paths as they would be
+	//	opened, for example "Resources/Textures/ship.png"
+	std::vector<ArchiveSource> GetArchiveSources(const std::string& directory);
+	// Entries are compressed when that saves at least an eighth of their size
+	void WriteArchive(const std::string& archivePath, std::span<const ArchiveSource> sources);
+
+	//+--------------------------------\--------------------------------------
+	//|		  Virtual file system	   |
+	//\--------------------------------/
+	//	The d2d loaders (textures, texture atlases, fonts, body files,
+	//	FileToString and FileToHJSON) read through OpenFile. It looks a path
+	//	up in the mounted archives, newest first, and reads a loose file
+	//	from disk when no archive has it. With loose file override on, a
+	//	loose file wins over the archives, so edited assets show up during
+	//	development without repacking. That costs a file system lookup per
+	//	open, so it is off by default.
+	//	Mount and unmount before loading from other threads; OpenFile itself
+	//	may be called from several threads at once.
+	//------------------------------------------------------------------------
+	void MountArchive(const std::string& archivePath);
+	void UnmountArchives();
+	void SetLooseFileOverride(bool enabled);
+
+	// The contents of an opened file. Uncompressed archive entries are
+	//	viewed in place, compressed ones are decompressed into a buffer, and
+	//	loose files are a MappedFile.
+	class VfsFile
+	{
+	public:
+		std::span<const Uint8> GetBytes() const
+		{
+			return m_bytes;
+		}
+		std::string_view GetText() const
+		{
+			return { (const char*)m_bytes.data(), m_bytes.size() };
+		}
+		// A read-only SDL_RWops over the contents, for SDL loaders. It must
+		//	be closed before this VfsFile is destroyed.
+		SDL_RWops* GetRWops() const;
+	private:
+		friend VfsFile OpenFile(const std::string& filePath);
+		std::shared_ptr<const Archive> m_archive;
+		MappedFile m_looseFile;
+		std::vector<Uint8> m_buffer;
+		std::span<const Uint8> m_bytes;
+	};
+	// Throws FileException if no archive or loose file has this path
+	VfsFile OpenFile(const std::string& filePath);
+}
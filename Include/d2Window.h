@@ -139,6 +139,7 @@ namespace d2d
 		void SetPointSize(float size);
 		void SetLineWidth(float width);
 		void SetColor(const Color& newColor);
+		void SetColor(const Color32& newColor);
 		void EnableTextures();
 		void DisableTextures();
 		void EnableBlending();
@@ -162,6 +163,11 @@ namespace d2d
 		void DrawString(const std::string& text, float size, const FontReference& fontRefPtr, const AlignmentAnchor& anchor = {});
         void DrawTexture(const Texture& texture, const b2Vec2& size);
         void DrawTextureInRect(const Texture& texture, const Rect& drawRect);
+
+		// Batched draws: one glDrawArrays call for the whole array
+		void DrawPoints(const b2Vec2* positions, const Color32* colors, unsigned count);
+		void DrawTexturedQuads(const Texture& texture, const b2Vec2* centers,
+			const Color32* colors, unsigned count, const b2Vec2& size);
 		void ShowSimpleMessageBox(MessageBoxType type, const std::string& title, const std::string& message);
     }
 }
@@ -10,7 +10,10 @@
 #pragma once
 #include "d2pch.h"
 #include "d2Color.h"
+#include "d2File.h"
+#include "d2Vfs.h"
 #include "d2Hjson.h"
+#include "d2HjsonCache.h"
 #include "d2Main.h"
 #include "d2Menu.h"
 #include "d2NumberManip.h"
@@ -19,13 +22,22 @@
 #include "d2Rect.h"
 #include "d2Resource.h"
 #include "d2ShapeFactory.h"
+#include "d2PhysicsWorld.h"
+#include "d2BodyState.h"
 #include "d2StringManip.h"
 #include "d2Timer.h"
+#include "d2GameLoop.h"
 #include "d2Utility.h"
 #include "d2Window.h"
+#include "d2Compression.h"
 #include "d2Network.h"
+#include "d2NetworkThread.h"
+#include "d2Serialize.h"
+#include "d2Snapshot.h"
+#include "d2UdpConnection.h"
 #include "d2Texture.h"
 #include "d2Text.h"
 #include "d2Animation.h"
+#include "d2Particle.h"
 
 
@@ -44,13 +44,25 @@
 
 #include <vector>
 #include <array>
+#include <atomic>
+#include <bit>
+#include <span>
 #include <list>
 #include <queue>
 #include <stack>
 #include <map>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 #include <sstream>
 #include <fstream>
+#include <filesystem>
 #include <random>
 #include <climits>
 #include <string>
+#include <string_view>
+#include <charconv>
 using namespace std::string_literals;
@@ -0,0 +1,278 @@
+/**************************************************************************************\
+** File: d2BodyState.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Source code file for batch body state queries
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2BodyState.h"
+#include "d2Simd.h"
+namespace d2d
+{
+	namespace
+	{
+		// Pointers to the gathered arrays, so the kernels take one argument
+		struct StateArrays
+		{
+			const float* masses;
+			const float* inertias;
+			const float* velocityXs;
+			const float* velocityYs;
+			const float* angularVelocities;
+			size_t count;
+		};
+		StateArrays GetStateArrays(const BodyStates& states)
+		{
+			d2Assert(states.masses.size() == states.GetSize() && states.inertias.size() == states.GetSize() &&
+				states.velocityXs.size() == states.GetSize() && states.velocityYs.size() == states.GetSize() &&
+				states.angularVelocities.size() == states.GetSize());
+			return { states.masses.data(), states.inertias.data(), states.velocityXs.data(),
+				states.velocityYs.data(), states.angularVelocities.data(), states.GetSize() };
+		}
+
+		float KineticEnergyScalar(const StateArrays& s, size_t i)
+		{
+			float speedSquared{ s.velocityXs[i] * s.velocityXs[i] + s.velocityYs[i] * s.velocityYs[i] };
+			return 0.5f * (s.masses[i] * speedSquared + s.inertias[i] * s.angularVelocities[i] * s.angularVelocities[i]);
+		}
+		float SpeedScalar(const StateArrays& s, size_t i)
+		{
+			return sqrtf(s.velocityXs[i] * s.velocityXs[i] + s.velocityYs[i] * s.velocityYs[i]);
+		}
+
+#ifdef D2_SIMD_SSE2
+		__m128 KineticEnergySSE2(const StateArrays& s, size_t i)
+		{
+			__m128 vx{ _mm_loadu_ps(s.velocityXs + i) };
+			__m128 vy{ _mm_loadu_ps(s.velocityYs + i) };
+			__m128 w{ _mm_loadu_ps(s.angularVelocities + i) };
+			__m128 speedSquared{ _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)) };
+			__m128 linear{ _mm_mul_ps(_mm_loadu_ps(s.masses + i), speedSquared) };
+			__m128 angular{ _mm_mul_ps(_mm_loadu_ps(s.inertias + i), _mm_mul_ps(w, w)) };
+			return _mm_mul_ps(_mm_set1_ps(0.5f), _mm_add_ps(linear, angular));
+		}
+		__m128 SpeedSSE2(const StateArrays& s, size_t i)
+		{
+			__m128 vx{ _mm_loadu_ps(s.velocityXs + i) };
+			__m128 vy{ _mm_loadu_ps(s.velocityYs + i) };
+			return _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)));
+		}
+		size_t KineticEnergiesSSE2(const StateArrays& s, float* out)
+		{
+			size_t i{ 0 };
+			for(; i + 4 <= s.count; i += 4)
+				_mm_storeu_ps(out + i, KineticEnergySSE2(s, i));
+			return i;
+		}
+		size_t MomentaSSE2(const StateArrays& s, float* out)
+		{
+			size_t i{ 0 };
+			for(; i + 4 <= s.count; i += 4)
+				_mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(s.masses + i), SpeedSSE2(s, i)));
+			return i;
+		}
+		size_t SpeedsSSE2(const StateArrays& s, float* out)
+		{
+			size_t i{ 0 };
+			for(; i + 4 <= s.count; i += 4)
+				_mm_storeu_ps(out + i, SpeedSSE2(s, i));
+			return i;
+		}
+		size_t FindAboveKineticEnergySSE2(const StateArrays& s, b2Body* const* bodies, float threshold,
+			b2Body** bodiesOut, size_t& foundCount)
+		{
+			const __m128 thresholdV{ _mm_set1_ps(threshold) };
+			size_t i{ 0 };
+			for(; i + 4 <= s.count; i += 4)
+			{
+				unsigned mask{ (unsigned)_mm_movemask_ps(_mm_cmpgt_ps(KineticEnergySSE2(s, i), thresholdV)) };
+				// Branchless compaction: every lane is written, only passing
+				//	lanes advance the count
+				for(unsigned lane = 0; lane < 4; ++lane)
+				{
+					bodiesOut[foundCount] = bodies[i + lane];
+					foundCount += (mask >> lane) & 1;
+				}
+			}
+			return i;
+		}
+#endif
+
+#ifdef D2_SIMD_AVX
+		D2_TARGET_AVX __m256 KineticEnergyAVX(const StateArrays& s, size_t i)
+		{
+			__m256 vx{ _mm256_loadu_ps(s.velocityXs + i) };
+			__m256 vy{ _mm256_loadu_ps(s.velocityYs + i) };
+			__m256 w{ _mm256_loadu_ps(s.angularVelocities + i) };
+			__m256 speedSquared{ _mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)) };
+			__m256 linear{ _mm256_mul_ps(_mm256_loadu_ps(s.masses + i), speedSquared) };
+			__m256 angular{ _mm256_mul_ps(_mm256_loadu_ps(s.inertias + i), _mm256_mul_ps(w, w)) };
+			return _mm256_mul_ps(_mm256_set1_ps(0.5f), _mm256_add_ps(linear, angular));
+		}
+		D2_TARGET_AVX __m256 SpeedAVX(const StateArrays& s, size_t i)
+		{
+			__m256 vx{ _mm256_loadu_ps(s.velocityXs + i) };
+			__m256 vy{ _mm256_loadu_ps(s.velocityYs + i) };
+			return _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)));
+		}
+		D2_TARGET_AVX size_t KineticEnergiesAVX(const StateArrays& s, float* out)
+		{
+			size_t i{ 0 };
+			for(; i + 8 <= s.count; i += 8)
+				_mm256_storeu_ps(out + i, KineticEnergyAVX(s, i));
+			return i;
+		}
+		D2_TARGET_AVX size_t MomentaAVX(const StateArrays& s, float* out)
+		{
+			size_t i{ 0 };
+			for(; i + 8 <= s.count; i += 8)
+				_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(s.masses + i), SpeedAVX(s, i)));
+			return i;
+		}
+		D2_TARGET_AVX size_t SpeedsAVX(const StateArrays& s, float* out)
+		{
+			size_t i{ 0 };
+			for(; i + 8 <= s.count; i += 8)
+				_mm256_storeu_ps(out + i, SpeedAVX(s, i));
+			return i;
+		}
+		D2_TARGET_AVX size_t FindAboveKineticEnergyAVX(const StateArrays& s, b2Body* const* bodies, float threshold,
+			b2Body** bodiesOut, size_t& foundCount)
+		{
+			const __m256 thresholdV{ _mm256_set1_ps(threshold) };
+			size_t i{ 0 };
+			for(; i + 8 <= s.count; i += 8)
+			{
+				unsigned mask{ (unsigned)_mm256_movemask_ps(
+					_mm256_cmp_ps(KineticEnergyAVX(s, i), thresholdV, _CMP_GT_OQ)) };
+				for(unsigned lane = 0; lane < 8; ++lane)
+				{
+					bodiesOut[foundCount] = bodies[i + lane];
+					foundCount += (mask >> lane) & 1;
+				}
+			}
+			return i;
+		}
+#endif
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			   Gathering		   |
+	//\--------------------------------/--------------------------------------
+	void GatherBodyStates(std::span<b2Body* const> bodies, BodyStates& statesOut)
+	{
+		const size_t count{ bodies.size() };
+		statesOut.bodies.assign(bodies.begin(), bodies.end());
+		statesOut.masses.resize(count);
+		statesOut.inertias.resize(count);
+		statesOut.velocityXs.resize(count);
+		statesOut.velocityYs.resize(count);
+		statesOut.angularVelocities.resize(count);
+		float* masses{ statesOut.masses.data() };
+		float* inertias{ statesOut.inertias.data() };
+		float* velocityXs{ statesOut.velocityXs.data() };
+		float* velocityYs{ statesOut.velocityYs.data() };
+		float* angularVelocities{ statesOut.angularVelocities.data() };
+		for(size_t i = 0; i < count; ++i)
+		{
+			const b2Body* bodyPtr{ bodies[i] };
+			if(!bodyPtr)
+			{
+				masses[i] = inertias[i] = 0.0f;
+				velocityXs[i] = velocityYs[i] = angularVelocities[i] = 0.0f;
+				continue;
+			}
+			const b2Vec2& velocity{ bodyPtr->GetLinearVelocity() };
+			masses[i] = bodyPtr->GetMass();
+			inertias[i] = bodyPtr->GetInertia();
+			velocityXs[i] = velocity.x;
+			velocityYs[i] = velocity.y;
+			angularVelocities[i] = bodyPtr->GetAngularVelocity();
+		}
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|				Queries			   |
+	//\--------------------------------/--------------------------------------
+	void CalculateKineticEnergies(const BodyStates& states, std::span<float> energiesOut)
+	{
+		d2Assert(energiesOut.size() == states.GetSize());
+		StateArrays s{ GetStateArrays(states) };
+		s.count = std::min(s.count, energiesOut.size());
+		float* out{ energiesOut.data() };
+		size_t i{ 0 };
+#if defined(D2_SIMD_AVX)
+		if(CpuHasAVX())
+			i = KineticEnergiesAVX(s, out);
+		else
+			i = KineticEnergiesSSE2(s, out);
+#elif defined(D2_SIMD_SSE2)
+		i = KineticEnergiesSSE2(s, out);
+#endif
+		for(; i < s.count; ++i)
+			out[i] = KineticEnergyScalar(s, i);
+	}
+	void CalculateMomenta(const BodyStates& states, std::span<float> momentaOut)
+	{
+		d2Assert(momentaOut.size() == states.GetSize());
+		StateArrays s{ GetStateArrays(states) };
+		s.count = std::min(s.count, momentaOut.size());
+		float* out{ momentaOut.data() };
+		size_t i{ 0 };
+#if defined(D2_SIMD_AVX)
+		if(CpuHasAVX())
+			i = MomentaAVX(s, out);
+		else
+			i = MomentaSSE2(s, out);
+#elif defined(D2_SIMD_SSE2)
+		i = MomentaSSE2(s, out);
+#endif
+		for(; i < s.count; ++i)
+			out[i] = s.masses[i] * SpeedScalar(s, i);
+	}
+	void CalculateSpeeds(const BodyStates& states, std::span<float> speedsOut)
+	{
+		d2Assert(speedsOut.size() == states.GetSize());
+		StateArrays s{ GetStateArrays(states) };
+		s.count = std::min(s.count, speedsOut.size());
+		float* out{ speedsOut.data() };
+		size_t i{ 0 };
+#if defined(D2_SIMD_AVX)
+		if(CpuHasAVX())
+			i = SpeedsAVX(s, out);
+		else
+			i = SpeedsSSE2(s, out);
+#elif defined(D2_SIMD_SSE2)
+		i = SpeedsSSE2(s, out);
+#endif
+		for(; i < s.count; ++i)
+			out[i] = SpeedScalar(s, i);
+	}
+	void FindBodiesAboveKineticEnergy(const BodyStates& states, float threshold, std::vector<b2Body*>& bodiesOut)
+	{
+		const StateArrays s{ GetStateArrays(states) };
+		b2Body* const* bodies{ states.bodies.data() };
+
+		// Sized for the worst case and trimmed after, so the kernels write
+		//	without a capacity check per body
+		bodiesOut.resize(s.count);
+		b2Body** out{ bodiesOut.data() };
+		size_t foundCount{ 0 };
+		size_t i{ 0 };
+#if defined(D2_SIMD_AVX)
+		if(CpuHasAVX())
+			i = FindAboveKineticEnergyAVX(s, bodies, threshold, out, foundCount);
+		else
+			i = FindAboveKineticEnergySSE2(s, bodies, threshold, out, foundCount);
+#elif defined(D2_SIMD_SSE2)
+		i = FindAboveKineticEnergySSE2(s, bodies, threshold, out, foundCount);
+#endif
+		for(; i < s.count; ++i)
+			if(KineticEnergyScalar(s, i) > threshold)
+				out[foundCount++] = bodies[i];
+		bodiesOut.resize(foundCount);
+	}
+}
@@ -10,8 +10,11 @@
 #include "d2pch.h"
 #include "d2Color.h"
 #include "d2NumberManip.h"
+#include "d2Simd.h"
 namespace d2d
 {
+	static_assert(sizeof(Color) == 4 * sizeof(float), "LerpColors loads a Color as one float vector");
+
 	Color::Color()
 	{
 		*this = COLOR_ZERO;
@@ -71,6 +74,104 @@ namespace d2d
 		  d2d::GetClamped(left.alpha * right.alpha, VALID_PERCENT_RANGE) };
 	}
 
+	//+----------------\------------------------------------------
+	//|	    Color32	   |
+	//\----------------/------------------------------------------
+	namespace
+	{
+		Uint8 PercentToByte(float value)
+		{
+			return (Uint8)(d2d::GetClamped(value, VALID_PERCENT_RANGE) * 255.0f + 0.5f);
+		}
+	}
+	Color32::Color32(Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+		: red{ r }, green{ g }, blue{ b }, alpha{ a }
+	{ }
+	Color32::Color32(const Color& color)
+		: red{ PercentToByte(color.red) },
+		  green{ PercentToByte(color.green) },
+		  blue{ PercentToByte(color.blue) },
+		  alpha{ PercentToByte(color.alpha) }
+	{ }
+	Color Color32::ToColor() const
+	{
+		return Color{ (int)red, (int)green, (int)blue, (int)alpha };
+	}
+	bool operator==(const Color32& left, const Color32& right)
+	{
+		return left.red == right.red && left.green == right.green
+			&& left.blue == right.blue && left.alpha == right.alpha;
+	}
+	bool operator!=(const Color32& left, const Color32& right)
+	{
+		return !(left == right);
+	}
+
+	//+----------------\------------------------------------------
+	//|	  LerpColors   |
+	//\----------------/------------------------------------------
+	namespace
+	{
+#ifdef D2_SIMD_SSE2
+		size_t LerpColorsSSE2(const Color* a, const Color* b, const float* percentB, Color* out, size_t count)
+		{
+			const __m128 zero{ _mm_setzero_ps() };
+			const __m128 one{ _mm_set1_ps(1.0f) };
+			for(size_t i = 0; i < count; ++i)
+			{
+				__m128 percentBV{ _mm_set1_ps(percentB[i]) };
+				__m128 percentAV{ _mm_sub_ps(one, percentBV) };
+				__m128 result{ _mm_add_ps(_mm_mul_ps(percentBV, _mm_loadu_ps(&b[i].red)),
+										  _mm_mul_ps(percentAV, _mm_loadu_ps(&a[i].red))) };
+				_mm_storeu_ps(&out[i].red, _mm_min_ps(_mm_max_ps(result, zero), one));
+			}
+			return count;
+		}
+#endif
+#ifdef D2_SIMD_AVX
+		D2_TARGET_AVX size_t LerpColorsAVX(const Color* a, const Color* b, const float* percentB, Color* out, size_t count)
+		{
+			// Two colors per register: lanes 0-3 hold color i, lanes 4-7 hold color i+1
+			const __m256 zero{ _mm256_setzero_ps() };
+			const __m256 one{ _mm256_set1_ps(1.0f) };
+			size_t i{ 0 };
+			for(; i + 2 <= count; i += 2)
+			{
+				__m256 percentBV{ _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(percentB[i])),
+													   _mm_set1_ps(percentB[i + 1]), 1) };
+				__m256 percentAV{ _mm256_sub_ps(one, percentBV) };
+				__m256 result{ _mm256_add_ps(_mm256_mul_ps(percentBV, _mm256_loadu_ps(&b[i].red)),
+											 _mm256_mul_ps(percentAV, _mm256_loadu_ps(&a[i].red))) };
+				_mm256_storeu_ps(&out[i].red, _mm256_min_ps(_mm256_max_ps(result, zero), one));
+			}
+			return i;
+		}
+#endif
+	}
+	void LerpColors(std::span<const Color> a, std::span<const Color> b,
+		std::span<const float> percentB, std::span<Color> out)
+	{
+		d2Assert(a.size() == b.size() && a.size() == percentB.size() && a.size() == out.size());
+		size_t count{ std::min({ a.size(), b.size(), percentB.size(), out.size() }) };
+		size_t i{ 0 };
+#ifdef D2_SIMD_AVX
+		if(CpuHasAVX())
+			i = LerpColorsAVX(a.data(), b.data(), percentB.data(), out.data(), count);
+#endif
+#ifdef D2_SIMD_SSE2
+		i += LerpColorsSSE2(a.data() + i, b.data() + i, percentB.data() + i, out.data() + i, count - i);
+#endif
+		// Same formula as the kernels: clamp only the final result, not each product
+		for(; i < count; ++i)
+		{
+			float percentA{ 1.0f - percentB[i] };
+			out[i] = { percentB[i] * b[i].red + percentA * a[i].red,
+					   percentB[i] * b[i].green + percentA * a[i].green,
+					   percentB[i] * b[i].blue + percentA * a[i].blue,
+					   percentB[i] * b[i].alpha + percentA * a[i].alpha };
+		}
+	}
+
 	//+----------------\------------------------------------------
 	//|	  ColorRange   |
 	//\----------------/------------------------------------------
@@ -93,4 +194,37 @@ namespace d2d
 			d2d::Lerp(blueRange, percentMax),
 			d2d::Lerp(alphaRange, percentMax) };
 	}
+	void ColorRange::LerpMany(std::span<const float> percentMax, std::span<Color32> out) const
+	{
+		d2Assert(percentMax.size() == out.size());
+		size_t count{ std::min(percentMax.size(), out.size()) };
+		size_t i{ 0 };
+#ifdef D2_SIMD_SSE2
+		// Same expression as Lerp: percentMax * max + (1 - percentMax) * min,
+		// then scaled to bytes, rounded and clamped like Color32(const Color&)
+		const __m128 minV{ _mm_setr_ps(redRange.GetMin(), greenRange.GetMin(), blueRange.GetMin(), alphaRange.GetMin()) };
+		const __m128 maxV{ _mm_setr_ps(redRange.GetMax(), greenRange.GetMax(), blueRange.GetMax(), alphaRange.GetMax()) };
+		const __m128 zero{ _mm_setzero_ps() };
+		const __m128 one{ _mm_set1_ps(1.0f) };
+		const __m128 byteScale{ _mm_set1_ps(255.0f) };
+		const __m128 half{ _mm_set1_ps(0.5f) };
+		auto lerpToInts = [&](float percent)
+		{
+			__m128 percentMaxV{ _mm_set1_ps(percent) };
+			__m128 color{ _mm_add_ps(_mm_mul_ps(percentMaxV, maxV),
+									 _mm_mul_ps(_mm_sub_ps(one, percentMaxV), minV)) };
+			color = _mm_min_ps(_mm_max_ps(color, zero), one);
+			return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(color, byteScale), half));
+		};
+		for(; i + 4 <= count; i += 4)
+		{
+			// Pack 4 colors x 4 channels of int32 down to 16 bytes
+			__m128i colors01{ _mm_packs_epi32(lerpToInts(percentMax[i]), lerpToInts(percentMax[i + 1])) };
+			__m128i colors23{ _mm_packs_epi32(lerpToInts(percentMax[i + 2]), lerpToInts(percentMax[i + 3])) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&out[i]), _mm_packus_epi16(colors01, colors23));
+		}
+#endif
+		for(; i < count; ++i)
+			out[i] = Color32{ Lerp(percentMax[i]) };
+	}
 }
@@ -0,0 +1,196 @@
+/**************************************************************************************\
+** File: d2Compression.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Source code file for LZ compression functions
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Compression.h"
+#include "d2Utility.h"
+namespace d2d
+{
+	namespace
+	{
+		const size_t MIN_MATCH{ 4 };
+		const size_t MAX_OFFSET{ 65535 };
+
+		// Matches must start at least MATCH_START_MARGIN bytes before the end,
+		//	and the last LAST_LITERALS bytes are always literals
+		const size_t MATCH_START_MARGIN{ 12 };
+		const size_t LAST_LITERALS{ 5 };
+
+		const unsigned HASH_BITS{ 12 };
+		const unsigned SKIP_SHIFT{ 6 };
+
+		Uint32 Read32(const Uint8* data)
+		{
+			Uint32 value;
+			std::memcpy(&value, data, sizeof(value));
+			return value;
+		}
+		unsigned Hash(Uint32 value)
+		{
+			return (value * 2654435761u) >> (32 - HASH_BITS);
+		}
+		// Lengths of 15 or more spill into extra bytes of 255 and a remainder
+		void WriteLengthExtra(Uint8*& out, size_t length)
+		{
+			for(length -= 15; length >= 255; length -= 255)
+				*out++ = 255;
+			*out++ = (Uint8)length;
+		}
+		void WriteSequence(Uint8*& out, const Uint8* literals, size_t numLiterals, size_t offset, size_t matchLength)
+		{
+			Uint8* tokenPtr{ out++ };
+			*tokenPtr = (Uint8)(std::min<size_t>(numLiterals, 15) << 4);
+			if(numLiterals >= 15)
+				WriteLengthExtra(out, numLiterals);
+			if(numLiterals)
+				std::memcpy(out, literals, numLiterals);
+			out += numLiterals;
+			if(matchLength == 0)
+				return;
+
+			*out++ = (Uint8)offset;
+			*out++ = (Uint8)(offset >> 8);
+			const size_t matchCode{ matchLength - MIN_MATCH };
+			*tokenPtr |= (Uint8)std::min<size_t>(matchCode, 15);
+			if(matchCode >= 15)
+				WriteLengthExtra(out, matchCode);
+		}
+		size_t ReadLengthExtra(const Uint8* data, size_t numBytes, size_t& position)
+		{
+			size_t length{ 0 };
+			Uint8 byte;
+			do
+			{
+				if(position >= numBytes)
+					throw CompressionException{ "Compressed data ends inside a length"s };
+				byte = data[position++];
+				length += byte;
+			} while(byte == 255);
+			return length;
+		}
+		void DecompressInto(std::span<const Uint8> compressed, size_t decompressedSize, std::vector<Uint8>& out)
+		{
+			const size_t start{ out.size() };
+			out.resize(start + decompressedSize);
+			Uint8* const outBegin{ out.data() + start };
+			const Uint8* in{ compressed.data() };
+			const size_t numBytes{ compressed.size() };
+			size_t position{ 0 };
+			size_t produced{ 0 };
+			for(;;)
+			{
+				if(position >= numBytes)
+					throw CompressionException{ "Compressed data ends inside a sequence"s };
+				const Uint8 token{ in[position++] };
+
+				size_t numLiterals{ (size_t)(token >> 4) };
+				if(numLiterals == 15)
+					numLiterals += ReadLengthExtra(in, numBytes, position);
+				if(numLiterals > numBytes - position || numLiterals > decompressedSize - produced)
+					throw CompressionException{ "Compressed literal run is out of bounds"s };
+				if(numLiterals)
+					std::memcpy(outBegin + produced, in + position, numLiterals);
+				position += numLiterals;
+				produced += numLiterals;
+
+				// The last sequence has literals only
+				if(position == numBytes)
+					break;
+
+				if(numBytes - position < 2)
+					throw CompressionException{ "Compressed data ends inside an offset"s };
+				const size_t offset{ (size_t)in[position] | ((size_t)in[position + 1] << 8) };
+				position += 2;
+				if(offset == 0 || offset > produced)
+					throw CompressionException{ "Compressed match offset is out of bounds"s };
+				size_t matchLength{ (size_t)(token & 15) };
+				if(matchLength == 15)
+					matchLength += ReadLengthExtra(in, numBytes, position);
+				matchLength += MIN_MATCH;
+				if(matchLength > decompressedSize - produced)
+					throw CompressionException{ "Compressed match runs past the output"s };
+
+				// Overlapping matches repeat recent bytes, so copy forwards one at a time
+				Uint8* matchOut{ outBegin + produced };
+				const Uint8* matchIn{ matchOut - offset };
+				if(offset >= matchLength)
+					std::memcpy(matchOut, matchIn, matchLength);
+				else
+					for(size_t i = 0; i < matchLength; ++i)
+						matchOut[i] = matchIn[i];
+				produced += matchLength;
+			}
+			if(produced != decompressedSize)
+				throw CompressionException{ "Decompressed size does not match: "s + std::to_string(produced) };
+		}
+	}
+	size_t GetMaxCompressedSize(size_t numBytes)
+	{
+		return numBytes + numBytes / 255 + 16;
+	}
+	size_t CompressLZ(std::span<const Uint8> data, std::vector<Uint8>& out)
+	{
+		const size_t start{ out.size() };
+		out.resize(start + GetMaxCompressedSize(data.size()));
+		Uint8* const outBegin{ out.data() + start };
+		Uint8* outPtr{ outBegin };
+		const Uint8* in{ data.data() };
+		const size_t numBytes{ data.size() };
+
+		size_t anchor{ 0 };
+		if(numBytes > MATCH_START_MARGIN)
+		{
+			std::array<Uint32, 1u << HASH_BITS> table{};
+			const size_t matchStartLimit{ numBytes - MATCH_START_MARGIN };
+			const size_t matchEndLimit{ numBytes - LAST_LITERALS };
+			size_t position{ 1 };
+			while(position < matchStartLimit)
+			{
+				const Uint32 sequence{ Read32(in + position) };
+				const unsigned hash{ Hash(sequence) };
+				const size_t candidate{ table[hash] };
+				table[hash] = (Uint32)position;
+				if(position - candidate > MAX_OFFSET || Read32(in + candidate) != sequence)
+				{
+					// Step further the longer we go without a match
+					position += 1 + ((position - anchor) >> SKIP_SHIFT);
+					continue;
+				}
+				size_t matchLength{ MIN_MATCH };
+				while(position + matchLength < matchEndLimit && in[candidate + matchLength] == in[position + matchLength])
+					++matchLength;
+				WriteSequence(outPtr, in + anchor, position - anchor, position - candidate, matchLength);
+				position += matchLength;
+				anchor = position;
+				if(position < matchStartLimit)
+					table[Hash(Read32(in + position - 2))] = (Uint32)(position - 2);
+			}
+		}
+		WriteSequence(outPtr, in + anchor, numBytes - anchor, 0, 0);
+
+		const size_t numWritten{ (size_t)(outPtr - outBegin) };
+		out.resize(start + numWritten);
+		return numWritten;
+	}
+	void DecompressLZ(std::span<const Uint8> compressed, size_t decompressedSize, std::vector<Uint8>& out)
+	{
+		if(decompressedSize > MAX_DECOMPRESSED_BYTES)
+			throw CompressionException{ "Decompressed size is too large: "s + std::to_string(decompressedSize) };
+		const size_t start{ out.size() };
+		try
+		{
+			DecompressInto(compressed, decompressedSize, out);
+		}
+		catch(const CompressionException&)
+		{
+			out.resize(start);
+			throw;
+		}
+	}
+}
@@ -0,0 +1,267 @@
+/**************************************************************************************\
+** File: d2File.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Source code file for reading and mapping files
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2File.h"
+#include "d2Utility.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+namespace d2d
+{
+	namespace
+	{
+		std::string GetErrorText()
+		{
+#ifdef _WIN32
+			return "error " + std::to_string(GetLastError());
+#else
+			return std::strerror(errno);
+#endif
+		}
+		[[noreturn]] void ThrowFileException(const std::string& action, const std::string& filePath)
+		{
+			throw FileException{ "Failed to " + action + " " + filePath + ": " + GetErrorText() };
+		}
+
+		// Closes an OS file handle on every path out of a function
+		class FileHandle
+		{
+		public:
+#ifdef _WIN32
+			explicit FileHandle(const std::string& filePath)
+				: m_handle{ CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+					OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr) }
+			{ }
+			~FileHandle()
+			{
+				if(IsValid())
+					CloseHandle(m_handle);
+			}
+			bool IsValid() const
+			{
+				return m_handle != INVALID_HANDLE_VALUE;
+			}
+			bool GetSize(size_t& size) const
+			{
+				LARGE_INTEGER fileSize;
+				if(!GetFileSizeEx(m_handle, &fileSize))
+					return false;
+				size = (size_t)fileSize.QuadPart;
+				return true;
+			}
+			// Returns the number of bytes read, 0 at the end of the file, or -1 on error
+			ptrdiff_t Read(void* buffer, size_t numBytes) const
+			{
+				DWORD bytesRead;
+				const DWORD bytesToRead{ (DWORD)std::min<size_t>(numBytes, 1u << 30) };
+				if(!::ReadFile(m_handle, buffer, bytesToRead, &bytesRead, nullptr))
+					return -1;
+				return (ptrdiff_t)bytesRead;
+			}
+			HANDLE Get() const
+			{
+				return m_handle;
+			}
+		private:
+			HANDLE m_handle;
+#else
+			explicit FileHandle(const std::string& filePath)
+				: m_descriptor{ open(filePath.c_str(), O_RDONLY | O_CLOEXEC) }
+			{ }
+			~FileHandle()
+			{
+				if(IsValid())
+					close(m_descriptor);
+			}
+			bool IsValid() const
+			{
+				return m_descriptor >= 0;
+			}
+			bool GetSize(size_t& size) const
+			{
+				struct stat status;
+				if(fstat(m_descriptor, &status) != 0)
+					return false;
+				size = (size_t)status.st_size;
+				return true;
+			}
+			ptrdiff_t Read(void* buffer, size_t numBytes) const
+			{
+				ptrdiff_t bytesRead;
+				do
+					bytesRead = read(m_descriptor, buffer, numBytes);
+				while(bytesRead < 0 && errno == EINTR);
+				return bytesRead;
+			}
+			int Get() const
+			{
+				return m_descriptor;
+			}
+		private:
+			int m_descriptor;
+#endif
+			FileHandle(const FileHandle&) = delete;
+			FileHandle& operator=(const FileHandle&) = delete;
+		};
+
+		template <typename Buffer> void ReadFrom(const FileHandle& file, size_t fileSize, const std::string& filePath, Buffer& out)
+		{
+			// Stops early if the file shrank since the size was read
+			out.resize(fileSize);
+			size_t totalRead{ 0 };
+			while(totalRead < out.size())
+			{
+				const ptrdiff_t bytesRead{ file.Read(out.data() + totalRead, out.size() - totalRead) };
+				if(bytesRead < 0)
+					ThrowFileException("read", filePath);
+				if(bytesRead == 0)
+					break;
+				totalRead += (size_t)bytesRead;
+			}
+			out.resize(totalRead);
+		}
+		size_t GetFileSize(const FileHandle& file, const std::string& filePath)
+		{
+			size_t fileSize;
+			if(!file.IsValid())
+				ThrowFileException("open", filePath);
+			if(!file.GetSize(fileSize))
+				ThrowFileException("get the size of", filePath);
+			return fileSize;
+		}
+		template <typename Buffer> void ReadInto(const std::string& filePath, Buffer& out)
+		{
+			FileHandle file{ filePath };
+			ReadFrom(file, GetFileSize(file, filePath), filePath, out);
+		}
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			   Reading			   |
+	//\--------------------------------/--------------------------------------
+	void ReadFile(const std::string& filePath, std::vector<Uint8>& out)
+	{
+		ReadInto(filePath, out);
+	}
+	void ReadFile(const std::string& filePath, std::string& out)
+	{
+		ReadInto(filePath, out);
+	}
+	void PrefetchFiles(std::span<const std::string> filePaths)
+	{
+#ifndef _WIN32
+		for(const std::string& filePath : filePaths)
+		{
+			FileHandle file{ filePath };
+			if(file.IsValid())
+				posix_fadvise(file.Get(), 0, 0, POSIX_FADV_WILLNEED);
+		}
+#endif
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			  MappedFile		   |
+	//\--------------------------------/--------------------------------------
+	MappedFile::MappedFile(const std::string& filePath, bool readAhead)
+	{
+		Open(filePath, readAhead);
+	}
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+		: m_data{ std::exchange(other.m_data, nullptr) },
+		m_size{ std::exchange(other.m_size, 0) },
+		m_isOpen{ std::exchange(other.m_isOpen, false) },
+		m_isMapped{ std::exchange(other.m_isMapped, false) },
+		m_buffer{ std::move(other.m_buffer) }
+	{ }
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if(this != &other)
+		{
+			Close();
+			m_data = std::exchange(other.m_data, nullptr);
+			m_size = std::exchange(other.m_size, 0);
+			m_isOpen = std::exchange(other.m_isOpen, false);
+			m_isMapped = std::exchange(other.m_isMapped, false);
+			m_buffer = std::move(other.m_buffer);
+		}
+		return *this;
+	}
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+	void MappedFile::Open(const std::string& filePath, bool readAhead)
+	{
+		Close();
+		FileHandle file{ filePath };
+		const size_t fileSize{ GetFileSize(file, filePath) };
+		if(fileSize < MIN_MAPPED_FILE_BYTES)
+		{
+			ReadFrom(file, fileSize, filePath, m_buffer);
+			m_data = m_buffer.data();
+			m_size = m_buffer.size();
+		}
+		else
+		{
+#ifdef _WIN32
+			HANDLE mapping{ CreateFileMappingA(file.Get(), nullptr, PAGE_READONLY, 0, 0, nullptr) };
+			if(!mapping)
+				ThrowFileException("map", filePath);
+			// The view keeps the mapping alive
+			void* view{ MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) };
+			CloseHandle(mapping);
+			if(!view)
+				ThrowFileException("map", filePath);
+			(void)readAhead;
+#else
+			// Fault every page in with one call where we can
+			int flags{ MAP_PRIVATE };
+#ifdef MAP_POPULATE
+			if(readAhead)
+				flags |= MAP_POPULATE;
+#endif
+			void* view{ mmap(nullptr, fileSize, PROT_READ, flags, file.Get(), 0) };
+			if(view == MAP_FAILED)
+				ThrowFileException("map", filePath);
+#ifndef MAP_POPULATE
+			if(readAhead)
+				madvise(view, fileSize, MADV_WILLNEED);
+#endif
+#endif
+			m_data = (const Uint8*)view;
+			m_size = fileSize;
+			m_isMapped = true;
+		}
+		m_isOpen = true;
+	}
+	void MappedFile::Close()
+	{
+		if(m_isMapped)
+		{
+#ifdef _WIN32
+			UnmapViewOfFile(m_data);
+#else
+			munmap(const_cast<Uint8*>(m_data), m_size);
+#endif
+		}
+		m_data = nullptr;
+		m_size = 0;
+		m_isOpen = false;
+		m_isMapped = false;
+		m_buffer.clear();
+	}
+}
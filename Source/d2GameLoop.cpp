@@ -0,0 +1,99 @@
+/**************************************************************************************\
+** File: d2GameLoop.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Source code file for the GameLoop class
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2GameLoop.h"
+#include "d2Utility.h"
+namespace d2d
+{
+	namespace
+	{
+		double GetSecondsBetween(Uint64 startTicks, Uint64 endTicks)
+		{
+			return (double)(endTicks - startTicks) / (double)SDL_GetPerformanceFrequency();
+		}
+	}
+	GameLoop::GameLoop(const GameLoopDef& def)
+		: m_def{ def }
+	{
+		d2AssertRelease(m_def.stepSeconds > 0.0f);
+		d2AssertRelease(m_def.maxStepsPerFrame > 0);
+		Reset();
+	}
+	void GameLoop::Reset()
+	{
+		m_accumulator = 0.0;
+		m_stepsThisFrame = 0;
+		m_lastTicks = m_frameStartTicks = SDL_GetPerformanceCounter();
+	}
+	void GameLoop::BeginFrame()
+	{
+		const Uint64 now{ SDL_GetPerformanceCounter() };
+		const double frameSeconds{ GetSecondsBetween(m_lastTicks, now) };
+		m_lastTicks = now;
+		BeginFrame((float)frameSeconds);
+	}
+	void GameLoop::BeginFrame(float frameSeconds)
+	{
+		m_frameStartTicks = SDL_GetPerformanceCounter();
+		m_accumulator += std::max(frameSeconds, 0.0f);
+		m_stepsThisFrame = 0;
+		++m_stats.frames;
+	}
+	bool GameLoop::Step()
+	{
+		if(m_accumulator < m_def.stepSeconds)
+			return false;
+		if(m_stepsThisFrame >= m_def.maxStepsPerFrame)
+		{
+			// Over budget: drop whole steps, keeping the fraction for GetAlpha
+			const double droppedSteps{ std::floor(m_accumulator / m_def.stepSeconds) };
+			m_stats.droppedSteps += (Uint64)droppedSteps;
+			m_accumulator -= droppedSteps * m_def.stepSeconds;
+			return false;
+		}
+		m_accumulator -= m_def.stepSeconds;
+		++m_stepsThisFrame;
+		++m_stats.steps;
+		return true;
+	}
+	void GameLoop::EndFrame()
+	{
+		if(m_def.targetFrameSeconds <= 0.0f)
+			return;
+		const Uint64 frequency{ SDL_GetPerformanceFrequency() };
+		const Uint64 endTicks{ m_frameStartTicks + (Uint64)((double)m_def.targetFrameSeconds * (double)frequency) };
+		const Uint64 sleepStartTicks{ SDL_GetPerformanceCounter() };
+		if(sleepStartTicks >= endTicks)
+			return;
+
+		const double sleepSeconds{ GetSecondsBetween(sleepStartTicks, endTicks) - m_def.sleepMarginSeconds };
+		if(sleepSeconds >= 0.001)
+			SDL_Delay((Uint32)(sleepSeconds * 1000.0));
+		while(SDL_GetPerformanceCounter() < endTicks)
+			std::this_thread::yield();
+		m_stats.sleptSeconds += GetSecondsBetween(sleepStartTicks, SDL_GetPerformanceCounter());
+	}
+	float GameLoop::GetStepSeconds() const
+	{
+		return m_def.stepSeconds;
+	}
+	float GameLoop::GetAlpha() const
+	{
+		return std::clamp((float)(m_accumulator / m_def.stepSeconds), 0.0f, 1.0f);
+	}
+	unsigned GameLoop::GetStepsThisFrame() const
+	{
+		return m_stepsThisFrame;
+	}
+	const GameLoopStats& GameLoop::GetStats() const
+	{
+		return m_stats;
+	}
+}
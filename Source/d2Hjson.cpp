@@ -1,5 +1,5 @@
 /**************************************************************************************\
-** File: d2Hjson.h
+** File: d2Hjson.cpp
 ** Project:
 ** Author: David Leksen
 ** Date:
@@ -10,14 +10,17 @@
 #include "d2pch.h"
 #include "d2Hjson.h"
 #include "d2Utility.h"
+#include "d2Vfs.h"
 #include "d2NumberManip.h"
 #include "d2Color.h"
 namespace d2d
 {
 	HjsonValue FileToHJSON(const std::string& filePath)
 	{
-		std::string fileContentString{ FileToString(filePath) };
-		return Hjson::Unmarshal(fileContentString.c_str(), fileContentString.size());
+		// Parse straight from the file's view; Unmarshal stops at the size it is given
+		const VfsFile file{ OpenFile(filePath) };
+		const std::string_view text{ file.GetText() };
+		return Hjson::Unmarshal(text.empty() ? "" : text.data(), text.size());
 	}
 	bool IsNonNull(const HjsonValue& data)
 	{
@@ -25,8 +28,12 @@ namespace d2d
 	}
 	HjsonValue GetMemberValue(const HjsonValue& data, const std::string& name)
 	{
-		if(data.type() == Hjson::Type::Map && IsNonNull(data[name]))
-			return data[name];
+		if(data.type() == Hjson::Type::Map)
+		{
+			HjsonValue value{ data[name] };
+			if(IsNonNull(value))
+				return value;
+		}
 		throw HjsonFailedQueryException{ name };
 	}
 	std::string GetString(const HjsonValue& data, const std::string& name)
@@ -124,4 +131,118 @@ namespace d2d
 			GetVectorInt(data, name, 2),
 			GetVectorInt(data, name, 3) };
 	}
+
+	//+--------------------------------\--------------------------------------
+	//|		   Struct binding		   |
+	//\--------------------------------/
+	namespace
+	{
+		const char* GetTypeName(Hjson::Type type)
+		{
+			switch(type)
+			{
+			case Hjson::Type::Undefined: return "nothing";
+			case Hjson::Type::Null: return "null";
+			case Hjson::Type::Bool: return "bool";
+			case Hjson::Type::Double: return "number";
+			case Hjson::Type::Int64: return "integer";
+			case Hjson::Type::String: return "string";
+			case Hjson::Type::Vector: return "array";
+			case Hjson::Type::Map: return "map";
+			default: return "unknown";
+			}
+		}
+		bool ReadFloats(const HjsonValue& value, float* out, size_t count)
+		{
+			if(value.type() != Hjson::Type::Vector || value.size() != count)
+				return false;
+			for(size_t i = 0; i < count; ++i)
+				if(!value[(int)i].is_numeric())
+					return false;
+			for(size_t i = 0; i < count; ++i)
+				out[i] = (float)value[(int)i].to_double();
+			return true;
+		}
+	}
+	std::string HjsonPath::ToString() const
+	{
+		std::string prefix{ parent ? parent->ToString() : std::string{} };
+		if(isIndex)
+			return prefix + "[" + std::to_string(index) + "]";
+		if(prefix.empty())
+			return std::string{ key };
+		return prefix + "." + std::string{ key };
+	}
+	void HjsonBindErrors::AddMissing(const HjsonPath& path)
+	{
+		m_errors.push_back(path.ToString() + " is missing");
+	}
+	void HjsonBindErrors::AddMismatch(const HjsonPath& path, Hjson::Type actual, const char* expected)
+	{
+		std::string location{ path.ToString() };
+		m_errors.push_back((location.empty() ? "root" : location) + " is " + GetTypeName(actual) + ", expected " + expected);
+	}
+	void HjsonBindErrors::ThrowIfAny() const
+	{
+		if(m_errors.empty())
+			return;
+		std::string message{ "HJSON binding failed: " };
+		for(size_t i = 0; i < m_errors.size(); ++i)
+			message += (i ? "; " : "") + m_errors[i];
+		throw HjsonFailedQueryException{ message };
+	}
+	bool ReadHjsonValue(const HjsonValue& value, bool& out)
+	{
+		if(value.type() != Hjson::Type::Bool)
+			return false;
+		out = static_cast<bool>(value);
+		return true;
+	}
+	bool ReadHjsonValue(const HjsonValue& value, float& out)
+	{
+		if(!value.is_numeric())
+			return false;
+		out = (float)value.to_double();
+		return true;
+	}
+	bool ReadHjsonValue(const HjsonValue& value, double& out)
+	{
+		if(!value.is_numeric())
+			return false;
+		out = value.to_double();
+		return true;
+	}
+	bool ReadHjsonValue(const HjsonValue& value, std::string& out)
+	{
+		if(value.type() != Hjson::Type::String)
+			return false;
+		out = value.to_string();
+		return true;
+	}
+	bool ReadHjsonValue(const HjsonValue& value, b2Vec2& out)
+	{
+		float components[2];
+		if(!ReadFloats(value, components, 2))
+			return false;
+		out.Set(components[0], components[1]);
+		return true;
+	}
+	bool ReadHjsonValue(const HjsonValue& value, Color& out)
+	{
+		float components[4];
+		if(!ReadFloats(value, components, 4))
+			return false;
+		out.SetFloat(components[0], components[1], components[2], components[3]);
+		return true;
+	}
+	bool ReadHjsonIntColor(const HjsonValue& value, Color& out)
+	{
+		if(value.type() != Hjson::Type::Vector || value.size() != 4)
+			return false;
+		for(int i = 0; i < 4; ++i)
+			if(value[i].type() != Hjson::Type::Int64)
+				return false;
+		out.SetInt((int)value[0].to_int64(), (int)value[1].to_int64(), (int)value[2].to_int64(), (int)value[3].to_int64());
+		return true;
+	}
 }
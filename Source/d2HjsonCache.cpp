@@ -0,0 +1,325 @@
+/**************************************************************************************\
+** File: d2HjsonCache.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Source code file for caching parsed HJSON files in binary form
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2HjsonCache.h"
+#include "d2Utility.h"
+#include "d2File.h"
+namespace d2d
+{
+	namespace
+	{
+		const Uint8 CACHE_FILE_MAGIC[4]{ 'd', '2', 'h', 'c' };
+		const Uint32 CACHE_FILE_VERSION{ 1 };
+		const std::string CACHE_FILE_EXTENSION{ ".hjc" };
+		// Each level takes at least a byte, but corrupt data should not be able to overflow the stack
+		const unsigned MAX_DEPTH{ 256 };
+
+		Uint64 HashBytes(std::span<const Uint8> bytes)
+		{
+			// 64-bit FNV-1a
+			Uint64 hash{ 14695981039346656037ull };
+			for(Uint8 byte : bytes)
+			{
+				hash ^= byte;
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+		Uint64 HashString(std::string_view text)
+		{
+			return HashBytes({ (const Uint8*)text.data(), text.size() });
+		}
+
+		void AppendUint32(std::vector<Uint8>& out, Uint32 value)
+		{
+			value = SDL_SwapLE32(value);
+			const Uint8* bytes{ (const Uint8*)&value };
+			out.insert(out.end(), bytes, bytes + sizeof(value));
+		}
+		void AppendUint64(std::vector<Uint8>& out, Uint64 value)
+		{
+			value = SDL_SwapLE64(value);
+			const Uint8* bytes{ (const Uint8*)&value };
+			out.insert(out.end(), bytes, bytes + sizeof(value));
+		}
+		void AppendString(std::vector<Uint8>& out, std::string_view text)
+		{
+			AppendUint32(out, (Uint32)text.size());
+			out.insert(out.end(), (const Uint8*)text.data(), (const Uint8*)text.data() + text.size());
+		}
+		class BinaryReader
+		{
+		public:
+			explicit BinaryReader(std::span<const Uint8> data)
+				: m_data{ data }
+			{ }
+			const Uint8* ReadBytes(size_t numBytes)
+			{
+				if(numBytes > m_data.size() - m_position)
+					throw SerializationException{ "HJSON cache data is truncated"s };
+				const Uint8* bytes{ m_data.data() + m_position };
+				m_position += numBytes;
+				return bytes;
+			}
+			Uint8 ReadUint8()
+			{
+				return *ReadBytes(1);
+			}
+			Uint32 ReadUint32()
+			{
+				Uint32 value;
+				std::memcpy(&value, ReadBytes(sizeof(value)), sizeof(value));
+				return SDL_SwapLE32(value);
+			}
+			Uint64 ReadUint64()
+			{
+				Uint64 value;
+				std::memcpy(&value, ReadBytes(sizeof(value)), sizeof(value));
+				return SDL_SwapLE64(value);
+			}
+			std::string_view ReadString()
+			{
+				const Uint32 size{ ReadUint32() };
+				return { (const char*)ReadBytes(size), size };
+			}
+			// Every element takes at least one byte, so a larger count is corrupt
+			Uint32 ReadCount()
+			{
+				const Uint32 count{ ReadUint32() };
+				if(count > m_data.size() - m_position)
+					throw SerializationException{ "HJSON cache count is out of range"s };
+				return count;
+			}
+			bool IsAtEnd() const
+			{
+				return m_position == m_data.size();
+			}
+		private:
+			std::span<const Uint8> m_data;
+			size_t m_position{ 0 };
+		};
+
+		void WriteValue(const HjsonValue& value, std::vector<Uint8>& out)
+		{
+			out.push_back((Uint8)value.type());
+			switch(value.type())
+			{
+			case Hjson::Type::Bool:
+				out.push_back(static_cast<bool>(value) ? 1 : 0);
+				break;
+			case Hjson::Type::Double:
+				AppendUint64(out, std::bit_cast<Uint64>(value.to_double()));
+				break;
+			case Hjson::Type::Int64:
+				AppendUint64(out, (Uint64)value.to_int64());
+				break;
+			case Hjson::Type::String:
+				AppendString(out, value.to_string());
+				break;
+			case Hjson::Type::Vector:
+				AppendUint32(out, (Uint32)value.size());
+				for(int i = 0; i < (int)value.size(); ++i)
+					WriteValue(value[i], out);
+				break;
+			case Hjson::Type::Map:
+				AppendUint32(out, (Uint32)value.size());
+				for(int i = 0; i < (int)value.size(); ++i)
+				{
+					AppendString(out, value.key(i));
+					WriteValue(value[i], out);
+				}
+				break;
+			default:
+				break;
+			}
+		}
+		HjsonValue ReadValue(BinaryReader& reader, unsigned depth)
+		{
+			if(depth > MAX_DEPTH)
+				throw SerializationException{ "HJSON cache data is nested too deeply"s };
+			const Hjson::Type type{ (Hjson::Type)reader.ReadUint8() };
+			switch(type)
+			{
+			case Hjson::Type::Undefined:
+				return {};
+			case Hjson::Type::Null:
+				return HjsonValue{ Hjson::Type::Null };
+			case Hjson::Type::Bool:
+				return HjsonValue{ reader.ReadUint8() != 0 };
+			case Hjson::Type::Double:
+				return HjsonValue{ std::bit_cast<double>(reader.ReadUint64()) };
+			case Hjson::Type::Int64:
+				return HjsonValue{ (long long)reader.ReadUint64() };
+			case Hjson::Type::String:
+				return HjsonValue{ std::string{ reader.ReadString() } };
+			case Hjson::Type::Vector:
+			{
+				HjsonValue vector{ Hjson::Type::Vector };
+				const Uint32 count{ reader.ReadCount() };
+				for(Uint32 i = 0; i < count; ++i)
+					vector.push_back(ReadValue(reader, depth + 1));
+				return vector;
+			}
+			case Hjson::Type::Map:
+			{
+				HjsonValue map{ Hjson::Type::Map };
+				const Uint32 count{ reader.ReadCount() };
+				for(Uint32 i = 0; i < count; ++i)
+				{
+					const std::string key{ reader.ReadString() };
+					map[key] = ReadValue(reader, depth + 1);
+				}
+				return map;
+			}
+			default:
+				throw SerializationException{ "HJSON cache data has an unknown value type"s };
+			}
+		}
+		HjsonValue ReadLastValue(BinaryReader& reader)
+		{
+			HjsonValue value{ ReadValue(reader, 0) };
+			if(!reader.IsAtEnd())
+				throw SerializationException{ "HJSON cache data has trailing bytes"s };
+			return value;
+		}
+
+		// Cache file header, followed by the source path and then the value
+		struct CacheHeader
+		{
+			Uint64 modifiedTime;
+			Uint64 fileSize;
+			Uint64 contentHash;
+		};
+		void WriteCacheFile(const std::filesystem::path& cachePath, const std::string& filePath,
+			const CacheHeader& header, const HjsonValue& value, std::vector<Uint8>& buffer)
+		{
+			buffer.clear();
+			buffer.insert(buffer.end(), std::begin(CACHE_FILE_MAGIC), std::end(CACHE_FILE_MAGIC));
+			AppendUint32(buffer, CACHE_FILE_VERSION);
+			AppendUint64(buffer, header.modifiedTime);
+			AppendUint64(buffer, header.fileSize);
+			AppendUint64(buffer, header.contentHash);
+			AppendString(buffer, filePath);
+			WriteHjsonBinary(value, buffer);
+
+			// Write beside the cache file and rename over it, so a crash cannot leave half a file
+			std::filesystem::path tempPath{ cachePath };
+			tempPath += ".tmp";
+			{
+				std::ofstream outStream{ tempPath, std::ios::binary | std::ios::trunc };
+				if(!outStream.write((const char*)buffer.data(), (std::streamsize)buffer.size()))
+				{
+					d2LogWarning << "Failed to write HJSON cache file " << tempPath.string();
+					return;
+				}
+			}
+			std::error_code error;
+			std::filesystem::rename(tempPath, cachePath, error);
+			if(error)
+				d2LogWarning << "Failed to replace HJSON cache file " << cachePath.string() << ": " << error.message();
+		}
+	}
+
+	void WriteHjsonBinary(const HjsonValue& value, std::vector<Uint8>& out)
+	{
+		WriteValue(value, out);
+	}
+	HjsonValue ReadHjsonBinary(std::span<const Uint8> data)
+	{
+		BinaryReader reader{ data };
+		return ReadLastValue(reader);
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			  HjsonCache		   |
+	//\--------------------------------/--------------------------------------
+	HjsonCache::HjsonCache(const std::string& cacheDirectory)
+		: m_cacheDirectory{ cacheDirectory }
+	{
+		std::error_code error;
+		std::filesystem::create_directories(m_cacheDirectory, error);
+		if(error)
+			d2LogWarning << "Failed to create HJSON cache directory " << cacheDirectory << ": " << error.message();
+	}
+	HjsonValue HjsonCache::Load(const std::string& filePath)
+	{
+		std::error_code error;
+		const auto modifiedTime{ std::filesystem::last_write_time(filePath, error) };
+		const Uint64 fileSize{ error ? 0 : (Uint64)std::filesystem::file_size(filePath, error) };
+		if(error)
+			return FileToHJSON(filePath);
+		const CacheHeader current{ (Uint64)modifiedTime.time_since_epoch().count(), fileSize, 0 };
+
+		char cacheName[17];
+		std::snprintf(cacheName, sizeof(cacheName), "%016llx", (unsigned long long)HashString(filePath));
+		const std::filesystem::path cachePath{ m_cacheDirectory / (cacheName + CACHE_FILE_EXTENSION) };
+
+		MappedFile cacheFile;
+		if(std::filesystem::exists(cachePath, error))
+		{
+			try
+			{
+				cacheFile.Open(cachePath.string());
+			}
+			catch(const FileException&)
+			{
+				// Already logged; parse the file below instead
+			}
+		}
+		MappedFile sourceFile;
+		if(cacheFile.IsOpen())
+		{
+			try
+			{
+				BinaryReader reader{ cacheFile.GetBytes() };
+				if(std::memcmp(reader.ReadBytes(sizeof(CACHE_FILE_MAGIC)), CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC)) == 0
+					&& reader.ReadUint32() == CACHE_FILE_VERSION)
+				{
+					CacheHeader cached;
+					cached.modifiedTime = reader.ReadUint64();
+					cached.fileSize = reader.ReadUint64();
+					cached.contentHash = reader.ReadUint64();
+					if(reader.ReadString() == filePath)
+					{
+						if(cached.modifiedTime == current.modifiedTime && cached.fileSize == current.fileSize)
+						{
+							HjsonValue value{ ReadLastValue(reader) };
+							++m_stats.hits;
+							return value;
+						}
+						sourceFile.Open(filePath);
+						if(HashBytes(sourceFile.GetBytes()) == cached.contentHash)
+						{
+							HjsonValue value{ ReadLastValue(reader) };
+							// Windows cannot replace a file that is still mapped
+							cacheFile.Close();
+							WriteCacheFile(cachePath, filePath, { current.modifiedTime, current.fileSize, cached.contentHash }, value, m_buffer);
+							++m_stats.rehashedHits;
+							return value;
+						}
+					}
+				}
+			}
+			catch(const SerializationException&)
+			{
+				// Parse the file below and overwrite the corrupt cache
+			}
+			cacheFile.Close();
+		}
+
+		++m_stats.misses;
+		if(!sourceFile.IsOpen())
+			sourceFile.Open(filePath);
+		const std::string_view text{ sourceFile.GetText() };
+		HjsonValue value{ Hjson::Unmarshal(text.empty() ? "" : text.data(), text.size()) };
+		WriteCacheFile(cachePath, filePath, { current.modifiedTime, current.fileSize, HashBytes(sourceFile.GetBytes()) }, value, m_buffer);
+		return value;
+	}
+}
@@ -9,6 +9,7 @@
 \**************************************************************************************/
 #include "d2pch.h"
 #include "d2Network.h"
+#include "d2Compression.h"
 #include "d2StringManip.h"
 #include "d2Utility.h"
 
@@ -28,6 +29,76 @@ namespace d2d
 			octetsOut[2] = ((clientIPInteger >> 8) & 0xff);
 			octetsOut[3] = (clientIPInteger & 0xff);
 		}
+
+		//+--------------------------------\--------------------------------------
+		//|			   Framing			   |
+		//\--------------------------------/
+		//	Frame header: varint of (payload size << FRAME_TYPE_BITS | frame type).
+		//	Varints are little-endian base 128: 7 bits per byte, high bit set on
+		//	every byte except the last.
+		//	A DATA_COMPRESSED payload is a varint of the original size followed
+		//	by the CompressLZ output. A CONTROL payload is a ControlType byte
+		//	followed by its data; unknown control types are ignored.
+		//------------------------------------------------------------------------
+		const unsigned FRAME_TYPE_BITS{ 2 };
+		const size_t MAX_VARINT_BYTES{ 10 };
+		const size_t RECEIVE_CHUNK_BYTES{ 4096 };
+		const size_t MAX_CONTROL_DATA_BYTES{ 8 };
+		static_assert(MAX_MESSAGE_BYTES <= MAX_DECOMPRESSED_BYTES, "Compressed messages must fit the decompression limit");
+		enum class FrameType : Uint8
+		{
+			DATA = 0,
+			DATA_COMPRESSED = 1,
+			CONTROL = 2
+		};
+		enum class ControlType : Uint8
+		{
+			PING = 0,
+			PONG = 1,
+			HELLO = 2
+		};
+
+		// HELLO data: one byte of capability flags
+		const Uint8 CAPABILITY_COMPRESSION{ 1 };
+		const float ROUND_TRIP_SMOOTHING{ 0.1f };
+		size_t WriteVarint(Uint64 value, Uint8* out)
+		{
+			size_t numBytes{ 0 };
+			while(value >= 0x80)
+			{
+				out[numBytes++] = (Uint8)(value | 0x80);
+				value >>= 7;
+			}
+			out[numBytes++] = (Uint8)value;
+			return numBytes;
+		}
+		// Returns the number of bytes read, or 0 if the varint is incomplete
+		size_t ReadVarint(const Uint8* data, size_t numBytes, Uint64& valueOut)
+		{
+			valueOut = 0;
+			for(size_t i = 0; i < numBytes && i < MAX_VARINT_BYTES; ++i)
+			{
+				valueOut |= (Uint64)(data[i] & 0x7F) << (7 * i);
+				if(!(data[i] & 0x80))
+					return i + 1;
+			}
+			if(numBytes >= MAX_VARINT_BYTES)
+				throw NetworkException{ "Malformed frame header"s };
+			return 0;
+		}
+
+		// Sets a flag for the lifetime of the scope, and clears it however
+		//	the scope is left
+		class FlagScope
+		{
+		public:
+			explicit FlagScope(bool& flag) : m_flag{ flag } { m_flag = true; }
+			~FlagScope() { m_flag = false; }
+			FlagScope(const FlagScope&) = delete;
+			FlagScope& operator=(const FlagScope&) = delete;
+		private:
+			bool& m_flag;
+		};
 	}
 	std::string GetIPOctetsString(const IPaddress& ip)
 	{
@@ -45,46 +116,40 @@ namespace d2d
 	//+--------------------------------\--------------------------------------
 	//|		   NetworkMessage   	   |
 	//\--------------------------------/--------------------------------------
-	NetworkMessage::NetworkMessage()
+	NetworkMessage::NetworkMessage(const void* data, size_t numBytes)
 	{
-		Reset();
+		Set(data, numBytes);
 	}
-	void NetworkMessage::Reset()
+	void NetworkMessage::Set(const void* data, size_t numBytes)
 	{
-		for(int i = 0; i < 256; ++i)
-			m_buffer[i] = 0;
-		m_bufferState = BufferState::EMPTY;
+		// assign() keeps the existing allocation when it is big enough
+		const Uint8* bytes{ static_cast<const Uint8*>(data) };
+		m_payload.assign(bytes, bytes + numBytes);
 	}
-	void NetworkMessage::Finish()
+	void NetworkMessage::Append(const void* data, size_t numBytes)
 	{
-		if(m_bufferState == BufferState::READING)
-			m_bufferState = BufferState::FULL;
+		const Uint8* bytes{ static_cast<const Uint8*>(data) };
+		m_payload.insert(m_payload.end(), bytes, bytes + numBytes);
 	}
-	int NetworkMessage::NumToLoad()
+	void NetworkMessage::Clear()
 	{
-		if(m_bufferState == BufferState::EMPTY)
-			return 255;
-		else
-			return 0;
+		m_payload.clear();
 	}
-	int NetworkMessage::NumToUnload()
+	std::span<const Uint8> NetworkMessage::GetPayload() const
 	{
-		if(m_bufferState == BufferState::FULL)
-			return strlen(m_buffer) + 1;
-		else
-			return 0;
+		return m_payload;
+	}
+	size_t NetworkMessage::GetSize() const
+	{
+		return m_payload.size();
 	}
-	void NetworkMessage::LoadBytes(ByteBuffer& inBuffer, int numBytes)
+	bool NetworkMessage::IsEmpty() const
 	{
-		for(int i = 0; i < numBytes; ++i)
-			m_buffer[i] = inBuffer[i];
-		m_bufferState = BufferState::READING;
+		return m_payload.empty();
 	}
-	void NetworkMessage::UnloadBytes(ByteBuffer& outBuffer)
+	std::vector<Uint8>& NetworkMessage::GetBuffer()
 	{
-		for(int i = 0; i < this->NumToUnload(); ++i)
-			outBuffer[i] = m_buffer[i];
-		Reset();
+		return m_payload;
 	}
 
 	//+--------------------------------\--------------------------------------
@@ -133,55 +198,66 @@ namespace d2d
 	{
 		return m_ip.port;
 	}
+	bool IpAddress::operator==(const IpAddress& other) const
+	{
+		return m_ip.host == other.m_ip.host && m_ip.port == other.m_ip.port;
+	}
 
 	//+--------------------------------\--------------------------------------
 	//|			  TcpSocket			   |
 	//\--------------------------------/--------------------------------------
 	TcpSocket::TcpSocket()
 		: m_socket{ nullptr },
-		  m_socketSet{ SDLNet_AllocSocketSet(1) }
-	{
-		if(!m_socketSet)
-			throw NetworkException{ std::string{"SDLNet_AllocSocketSet: "} + SDLNet_GetError() };
-	}
+		  m_socketSet{ nullptr }
+	{ }
 	TcpSocket::~TcpSocket()
 	{
+		FreeSocketSet();
 		if(m_socket)
 		{
-			if(m_socketSet)
-				SDLNet_TCP_DelSocket(m_socketSet, m_socket);
 			SDLNet_TCP_Close(m_socket);
 			m_socket = nullptr;
 		}
-		if(m_socketSet)
-		{
-			SDLNet_FreeSocketSet(m_socketSet);
-			m_socketSet = nullptr;
-		}
 	}
 	void TcpSocket::Set(TCPsocket sdl_TCPsocket)
 	{
+		FreeSocketSet();
 		if(m_socket)
 		{
-			SDLNet_TCP_DelSocket(m_socketSet, m_socket);
 			SDLNet_TCP_Close(m_socket);
 			m_socket = nullptr;
 		}
 		m_socket = sdl_TCPsocket;
-		if(SDLNet_TCP_AddSocket(m_socketSet, m_socket) == -1)
-		{
-			m_socket = nullptr;
-			throw NetworkException{ std::string{"SDLNet_TCP_AddSocket: "} + SDLNet_GetError() };
-		}
 	}
 	bool TcpSocket::Valid() const
 	{
 		return (m_socket != nullptr);
 	}
-	bool TcpSocket::Ready() const
+	TCPsocket TcpSocket::GetSDL_TCPsocket() const
 	{
+		return m_socket;
+	}
+	bool TcpSocket::Ready(Uint32 timeoutMilliseconds) const
+	{
+		if(!m_socket)
+			return false;
+
+		// The one-socket set is only created for sockets polled on their own.
+		//	Sockets owned by a NetworkReactor are polled through its shared set.
+		if(!m_socketSet)
+		{
+			m_socketSet = SDLNet_AllocSocketSet(1);
+			if(!m_socketSet)
+				throw NetworkException{ std::string{"SDLNet_AllocSocketSet: "} + SDLNet_GetError() };
+			if(SDLNet_TCP_AddSocket(m_socketSet, m_socket) == -1)
+			{
+				FreeSocketSet();
+				throw NetworkException{ std::string{"SDLNet_TCP_AddSocket: "} + SDLNet_GetError() };
+			}
+		}
+
 		bool ready{ false };
-		int numready{ SDLNet_CheckSockets(m_socketSet, 0) };
+		int numready{ SDLNet_CheckSockets(m_socketSet, timeoutMilliseconds) };
 		if(numready == -1)
 			throw NetworkException{ std::string{"SDLNet_CheckSockets: "} + SDLNet_GetError() };
 		else
@@ -189,6 +265,16 @@ namespace d2d
 				ready = SDLNet_SocketReady(m_socket);
 		return ready;
 	}
+	void TcpSocket::FreeSocketSet() const
+	{
+		if(m_socketSet)
+		{
+			if(m_socket)
+				SDLNet_TCP_DelSocket(m_socketSet, m_socket);
+			SDLNet_FreeSocketSet(m_socketSet);
+			m_socketSet = nullptr;
+		}
+	}
 	void TcpSocket::OnReady()
 	{ }
 
@@ -200,11 +286,7 @@ namespace d2d
 		IPaddress SDL_IPaddress = ip.GetSDL_IPaddress();
 		m_socket = SDLNet_TCP_Open(&SDL_IPaddress);
 		if(!m_socket)
-		{
-			SDLNet_FreeSocketSet(m_socketSet);
-			m_socketSet = nullptr;
 			throw NetworkException{ std::string{"SDLNet_TCP_Open: "} + SDLNet_GetError() };
-		}
 	}
 	ServerTcpSocket::ServerTcpSocket(Uint16 port)
 	{
@@ -216,11 +298,7 @@ namespace d2d
 			IPaddress SDL_IPaddress = iplistener.GetSDL_IPaddress();
 			m_socket = SDLNet_TCP_Open(&SDL_IPaddress);
 			if(!m_socket)
-			{
-				SDLNet_FreeSocketSet(m_socketSet);
-				m_socketSet = nullptr;
 				throw NetworkException{ std::string{"SDLNet_TCP_Open: "} +SDLNet_GetError() };
-			}
 		}
 	}
 	bool ServerTcpSocket::Accept(TcpSocket& clientTcpSocket)
@@ -270,6 +348,11 @@ namespace d2d
 	void ClientTcpSocket::Set(TCPsocket sdl_TCPsocket)
 	{
 		TcpSocket::Set(sdl_TCPsocket);
+		m_connected = true;
+		m_receiveStart = m_receiveEnd = m_pendingFrameBytes = 0;
+		ClearSendQueue();
+		m_stats = SocketStats{};
+		m_peerAcceptsCompression = false;
 		IPaddress* sdlIPaddressPtr{ SDLNet_TCP_GetPeerAddress(m_socket) };
 		if(sdlIPaddressPtr)
 		{
@@ -284,48 +367,629 @@ namespace d2d
 		}
 		else
 			throw NetworkException{ std::string{"SDLNet_TCP_GetPeerAddress: "} + SDLNet_GetError() };
+		SendHello();
 	}
 	IpAddress ClientTcpSocket::GetRemoteIpAddress() const
 	{
 		return m_remoteIp;
 	}
+	bool ClientTcpSocket::IsConnected() const
+	{
+		return m_socket && m_connected;
+	}
 	bool ClientTcpSocket::Receive(NetworkMessage& inData)
 	{
-		// Firstly, check if there is a socket
-		if(!m_socket)
+		if(ExtractMessage(inData))
+			return true;
+		while(IsConnected() && Ready())
+		{
+			if(!ReceiveAvailable())
+				return false;
+			if(ExtractMessage(inData))
+				return true;
+		}
+		return false;
+	}
+	bool ClientTcpSocket::ReceiveAvailable()
+	{
+		if(!IsConnected())
 			return false;
 
-		ByteBuffer buffer;
+		// Move unparsed bytes to the front so the buffer does not creep forward
+		if(m_receiveStart > 0)
+		{
+			std::memmove(m_receiveBuffer.data(), m_receiveBuffer.data() + m_receiveStart, m_receiveEnd - m_receiveStart);
+			m_receiveEnd -= m_receiveStart;
+			m_receiveStart = 0;
+		}
+
+		// Read at least a chunk, or the rest of the frame being assembled
+		size_t numToRead{ RECEIVE_CHUNK_BYTES };
+		if(m_pendingFrameBytes > m_receiveEnd)
+			numToRead = std::max(numToRead, m_pendingFrameBytes - m_receiveEnd);
+		if(m_receiveBuffer.size() < m_receiveEnd + numToRead)
+			m_receiveBuffer.resize(m_receiveEnd + numToRead);
 
-		// Check if the instance can receive bytes, if it can, load the number of bytes specified by NumToLoad() virtual function
-		while(inData.NumToLoad() > 0)
+		int numReceived{ SDLNet_TCP_Recv(m_socket, m_receiveBuffer.data() + m_receiveEnd, (int)numToRead) };
+		++m_stats.receiveCalls;
+		if(numReceived <= 0)
 		{
-			if(SDLNet_TCP_Recv(m_socket, buffer, inData.NumToLoad()) > 0)
-				inData.LoadBytes(buffer, inData.NumToLoad());
-			else
-				return false;
+			m_connected = false;
+			return false;
 		}
-		inData.Finish();
+		m_receiveEnd += numReceived;
+		m_stats.bytesReceived += numReceived;
+		if(m_pendingFrameBytes > m_receiveEnd)
+			++m_stats.partialReads;
 		return true;
 	}
-	bool ClientTcpSocket::Send(NetworkMessage& outData)
+	bool ClientTcpSocket::ExtractMessage(NetworkMessage& inData)
 	{
-		// Check if there is a socket
-		if(!m_socket)
+		// Control frames are consumed here, so keep going until a data frame
+		for(;;)
+		{
+			const Uint8* data{ m_receiveBuffer.data() + m_receiveStart };
+			const size_t numBuffered{ m_receiveEnd - m_receiveStart };
+
+			Uint64 header;
+			size_t headerBytes{ ReadVarint(data, numBuffered, header) };
+			if(headerBytes == 0)
+				return false;
+
+			const Uint64 payloadBytes{ header >> FRAME_TYPE_BITS };
+			const FrameType frameType{ (FrameType)(header & ((1u << FRAME_TYPE_BITS) - 1)) };
+			if(payloadBytes > MAX_MESSAGE_BYTES)
+				throw NetworkException{ "Incoming message exceeds MAX_MESSAGE_BYTES: "s + std::to_string(payloadBytes) };
+			if(frameType != FrameType::DATA && frameType != FrameType::DATA_COMPRESSED && frameType != FrameType::CONTROL)
+				throw NetworkException{ "Unknown frame type: "s + std::to_string((unsigned)frameType) };
+
+			const size_t frameBytes{ headerBytes + (size_t)payloadBytes };
+			if(numBuffered < frameBytes)
+			{
+				m_pendingFrameBytes = frameBytes;
+				return false;
+			}
+			m_receiveStart += frameBytes;
+			m_pendingFrameBytes = 0;
+			const std::span<const Uint8> payload{ data + headerBytes, (size_t)payloadBytes };
+			if(frameType == FrameType::DATA)
+			{
+				inData.Set(payload.data(), payload.size());
+				++m_stats.messagesReceived;
+			}
+			else if(frameType == FrameType::DATA_COMPRESSED)
+			{
+				Uint64 originalBytes;
+				size_t sizeBytes{ ReadVarint(payload.data(), payload.size(), originalBytes) };
+				if(sizeBytes == 0 || originalBytes > MAX_MESSAGE_BYTES)
+					throw NetworkException{ "Malformed compressed frame"s };
+				inData.Clear();
+				try
+				{
+					DecompressLZ(payload.subspan(sizeBytes), (size_t)originalBytes, inData.GetBuffer());
+				}
+				catch(const CompressionException& e)
+				{
+					throw NetworkException{ "Corrupt compressed frame: "s + e.what() };
+				}
+				++m_stats.messagesReceived;
+				++m_stats.compressedMessagesReceived;
+			}
+			else
+				ProcessControlFrame(payload);
+			if(m_receiveStart == m_receiveEnd)
+				m_receiveStart = m_receiveEnd = 0;
+			if(frameType != FrameType::CONTROL)
+				return true;
+		}
+	}
+	void ClientTcpSocket::ProcessControlFrame(std::span<const Uint8> payload)
+	{
+		if(payload.empty())
+			return;
+		const ControlType controlType{ (ControlType)payload[0] };
+		const std::span<const Uint8> controlData{ payload.subspan(1) };
+		if(controlType == ControlType::PING && controlData.size() == sizeof(Uint64))
+			SendControlFrame((Uint8)ControlType::PONG, controlData);
+		else if(controlType == ControlType::HELLO && controlData.size() >= 1)
+			m_peerAcceptsCompression = (controlData[0] & CAPABILITY_COMPRESSION) != 0;
+		else if(controlType == ControlType::PONG && controlData.size() == sizeof(Uint64))
+		{
+			// The PONG echoes the performance counter value from our PING
+			Uint64 pingTicks;
+			std::memcpy(&pingTicks, controlData.data(), sizeof(pingTicks));
+			const float sample{ (float)((double)(SDL_GetPerformanceCounter() - pingTicks) * 1000.0
+				/ (double)SDL_GetPerformanceFrequency()) };
+			++m_stats.pongsReceived;
+			if(m_stats.pongsReceived == 1)
+				m_stats.roundTripMilliseconds = sample;
+			else
+				m_stats.roundTripMilliseconds += ROUND_TRIP_SMOOTHING * (sample - m_stats.roundTripMilliseconds);
+		}
+	}
+	bool ClientTcpSocket::Send(const NetworkMessage& outData)
+	{
+		return Send(outData.GetPayload());
+	}
+	bool ClientTcpSocket::Send(std::span<const Uint8> payload)
+	{
+		if(!IsConnected())
 			return false;
 
-		ByteBuffer buffer;
-		int length;
+		// Going through the queue keeps this message behind any queued ones
+		QueueSend(payload);
+		return Flush();
+	}
+	void ClientTcpSocket::QueueSend(const NetworkMessage& outData)
+	{
+		QueueSend(outData.GetPayload());
+	}
+	void ClientTcpSocket::QueueSend(std::span<const Uint8> payload)
+	{
+		if(payload.size() > MAX_MESSAGE_BYTES)
+			throw NetworkException{ "Outgoing message exceeds MAX_MESSAGE_BYTES: "s + std::to_string(payload.size()) };
 
-		// Check if the instance can send bytes, if it can, unload the number of bytes specified by NumToUnload() virtual function
-		while((length = outData.NumToUnload()) > 0)
+		const size_t headerOffset{ m_sendHeaders.size() };
+		m_sendHeaders.resize(headerOffset + MAX_VARINT_BYTES);
+		size_t headerBytes{ WriteVarint(((Uint64)payload.size() << FRAME_TYPE_BITS) | (Uint64)FrameType::DATA,
+			m_sendHeaders.data() + headerOffset) };
+		m_sendHeaders.resize(headerOffset + headerBytes);
+		m_sendQueue.push_back({ headerOffset, headerBytes, payload });
+	}
+	// Returns false if not connected. Throws on failure, after dropping the rest of the queue
+	bool ClientTcpSocket::Flush()
+	{
+		if(!IsConnected())
 		{
-			outData.UnloadBytes(buffer);
-			if(SDLNet_TCP_Send(m_socket, (void*)buffer, length) < length)
-				throw NetworkException{ std::string{"SDLNet_TCP_Send: "} + SDLNet_GetError() };
+			ClearSendQueue();
+			return false;
 		}
+		if(m_sendQueue.empty())
+			return true;
+
+		const Uint64 sendCallsBefore{ m_stats.sendCalls };
+		m_sendBuffer.clear();
+		const bool compress{ IsCompressionActive() };
+		for(const QueuedFrame& frame : m_sendQueue)
+		{
+			if(compress && frame.payload.size() >= m_compressionThreshold && CompressFrame(frame.payload))
+				continue;
+			const Uint8* header{ m_sendHeaders.data() + frame.headerOffset };
+			m_sendBuffer.insert(m_sendBuffer.end(), header, header + frame.headerBytes);
+			if(frame.payload.size() < DIRECT_SEND_MIN_BYTES)
+			{
+				m_sendBuffer.insert(m_sendBuffer.end(), frame.payload.begin(), frame.payload.end());
+				m_stats.payloadBytesCopied += frame.payload.size();
+			}
+			else
+			{
+				// Large payload: send what is packed so far, then the payload in place
+				SendRaw(m_sendBuffer.data(), m_sendBuffer.size());
+				SendRaw(frame.payload.data(), frame.payload.size());
+				m_sendBuffer.clear();
+			}
+		}
+		SendRaw(m_sendBuffer.data(), m_sendBuffer.size());
+
+		++m_stats.flushes;
+		m_stats.messagesSent += m_sendQueue.size();
+		m_stats.lastFlushMessages = (unsigned)m_sendQueue.size();
+		m_stats.lastFlushSendCalls = (unsigned)(m_stats.sendCalls - sendCallsBefore);
+		ClearSendQueue();
+		return true;
+	}
+	// Appends the payload to m_sendBuffer as a DATA_COMPRESSED frame.
+	//	Returns false, appending nothing, if compression would not save space.
+	bool ClientTcpSocket::CompressFrame(std::span<const Uint8> payload)
+	{
+		m_compressBuffer.resize(MAX_VARINT_BYTES);
+		m_compressBuffer.resize(WriteVarint(payload.size(), m_compressBuffer.data()));
+		CompressLZ(payload, m_compressBuffer);
+		if(m_compressBuffer.size() >= payload.size())
+			return false;
+
+		Uint8 header[MAX_VARINT_BYTES];
+		size_t headerBytes{ WriteVarint(((Uint64)m_compressBuffer.size() << FRAME_TYPE_BITS) | (Uint64)FrameType::DATA_COMPRESSED, header) };
+		m_sendBuffer.insert(m_sendBuffer.end(), header, header + headerBytes);
+		m_sendBuffer.insert(m_sendBuffer.end(), m_compressBuffer.begin(), m_compressBuffer.end());
+		++m_stats.compressedMessagesSent;
+		m_stats.bytesBeforeCompression += payload.size();
+		m_stats.bytesAfterCompression += m_compressBuffer.size();
+		return true;
+	}
+	void ClientTcpSocket::SendRaw(const Uint8* data, size_t numBytes)
+	{
+		if(numBytes == 0)
+			return;
+		++m_stats.sendCalls;
+		int length{ (int)numBytes };
+		if(SDLNet_TCP_Send(m_socket, data, length) < length)
+		{
+			ClearSendQueue();
+			throw NetworkException{ std::string{"SDLNet_TCP_Send: "} + SDLNet_GetError() };
+		}
+		m_stats.bytesSent += numBytes;
+	}
+	void ClientTcpSocket::ClearSendQueue()
+	{
+		m_sendQueue.clear();
+		m_sendHeaders.clear();
+	}
+	size_t ClientTcpSocket::GetQueuedMessageCount() const
+	{
+		return m_sendQueue.size();
+	}
+	// Control frames bypass the queue. Frames are always written whole,
+	//	so this cannot split a queued frame. Returns false if not connected.
+	bool ClientTcpSocket::SendControlFrame(Uint8 controlType, std::span<const Uint8> controlData)
+	{
+		if(!IsConnected())
+			return false;
+		Uint8 frame[MAX_VARINT_BYTES + 1 + MAX_CONTROL_DATA_BYTES];
+		d2Assert(controlData.size() <= MAX_CONTROL_DATA_BYTES);
+		const size_t payloadBytes{ 1 + controlData.size() };
+		size_t headerBytes{ WriteVarint(((Uint64)payloadBytes << FRAME_TYPE_BITS) | (Uint64)FrameType::CONTROL, frame) };
+		frame[headerBytes] = controlType;
+		std::memcpy(frame + headerBytes + 1, controlData.data(), controlData.size());
+		SendRaw(frame, headerBytes + payloadBytes);
 		return true;
 	}
+	void ClientTcpSocket::SendPing()
+	{
+		const Uint64 now{ SDL_GetPerformanceCounter() };
+		if(SendControlFrame((Uint8)ControlType::PING, { (const Uint8*)&now, sizeof(now) }))
+			++m_stats.pingsSent;
+	}
+	void ClientTcpSocket::SendHello()
+	{
+		const Uint8 capabilities{ m_compressionEnabled ? CAPABILITY_COMPRESSION : (Uint8)0 };
+		SendControlFrame((Uint8)ControlType::HELLO, { &capabilities, 1 });
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			 Compression		   |
+	//\--------------------------------/--------------------------------------
+	void ClientTcpSocket::SetCompression(bool enabled, size_t thresholdBytes)
+	{
+		m_compressionThreshold = thresholdBytes;
+		if(enabled == m_compressionEnabled)
+			return;
+		m_compressionEnabled = enabled;
+		SendHello();
+	}
+	bool ClientTcpSocket::IsCompressionActive() const
+	{
+		return m_compressionEnabled && m_peerAcceptsCompression;
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			  Statistics		   |
+	//\--------------------------------/--------------------------------------
+	const SocketStats& ClientTcpSocket::GetStats() const
+	{
+		return m_stats;
+	}
+	void ClientTcpSocket::ResetStats()
+	{
+		m_stats = SocketStats{};
+	}
+	size_t ClientTcpSocket::GetBufferedReceiveBytes() const
+	{
+		return m_receiveEnd - m_receiveStart;
+	}
+	void ClientTcpSocket::SetPingInterval(float seconds)
+	{
+		m_pingInterval = seconds;
+		m_pingTimer = 0.0f;
+	}
+	void ClientTcpSocket::SetStatsLogInterval(float seconds)
+	{
+		m_statsLogInterval = seconds;
+		m_statsLogTimer = 0.0f;
+	}
+	void ClientTcpSocket::Update(float dt)
+	{
+		if(!IsConnected())
+			return;
+		if(m_pingInterval > 0.0f)
+		{
+			m_pingTimer += dt;
+			if(m_pingTimer >= m_pingInterval)
+			{
+				m_pingTimer = 0.0f;
+				SendPing();
+			}
+		}
+		if(m_statsLogInterval > 0.0f)
+		{
+			m_statsLogTimer += dt;
+			if(m_statsLogTimer >= m_statsLogInterval)
+			{
+				m_statsLogTimer = 0.0f;
+				LogStats();
+			}
+		}
+	}
+	void ClientTcpSocket::LogStats() const
+	{
+		// One statement, so the stats stay one log record
+		std::string compression;
+		if(m_stats.compressedMessagesSent)
+			compression = ", compressed "s + std::to_string(m_stats.compressedMessagesSent) + " msgs from "
+				+ std::to_string(m_stats.bytesBeforeCompression) + " to " + std::to_string(m_stats.bytesAfterCompression) + " bytes";
+		d2LogInfo << "Network stats for " << GetIPOctetsString(m_remoteIp.GetSDL_IPaddress())
+			<< ": sent " << m_stats.messagesSent << " msgs/" << m_stats.bytesSent << " bytes in " << m_stats.sendCalls << " sends"
+			<< ", received " << m_stats.messagesReceived << " msgs/" << m_stats.bytesReceived << " bytes in " << m_stats.receiveCalls << " reads"
+			<< " (" << m_stats.partialReads << " partial)"
+			<< ", queued " << GetQueuedMessageCount() << " msgs, buffered " << GetBufferedReceiveBytes() << " bytes"
+			<< ", rtt " << m_stats.roundTripMilliseconds << " ms" << compression;
+	}
 	void ClientTcpSocket::OnReady()
 	{ }
+
+	//+--------------------------------\--------------------------------------
+	//|			  UdpSocket			   |
+	//\--------------------------------/--------------------------------------
+	UdpSocket::UdpSocket(Uint16 port)
+	{
+		m_socket = SDLNet_UDP_Open(port);
+		if(!m_socket)
+			throw NetworkException{ std::string{"SDLNet_UDP_Open: "} + SDLNet_GetError() };
+		m_receivePacketPtr = SDLNet_AllocPacket((int)MAX_DATAGRAM_BYTES);
+		if(!m_receivePacketPtr)
+		{
+			SDLNet_UDP_Close(m_socket);
+			m_socket = nullptr;
+			throw NetworkException{ std::string{"SDLNet_AllocPacket: "} + SDLNet_GetError() };
+		}
+	}
+	UdpSocket::~UdpSocket()
+	{
+		if(m_receivePacketPtr)
+			SDLNet_FreePacket(m_receivePacketPtr);
+		if(m_socket)
+			SDLNet_UDP_Close(m_socket);
+	}
+	bool UdpSocket::Send(const IpAddress& destination, std::span<const Uint8> data)
+	{
+		if(data.size() > MAX_DATAGRAM_BYTES)
+			throw NetworkException{ "Outgoing datagram exceeds MAX_DATAGRAM_BYTES: "s + std::to_string(data.size()) };
+
+		// SDL_net only reads the packet, so it can point straight at the caller's bytes
+		UDPpacket packet{};
+		packet.channel = -1;
+		packet.data = const_cast<Uint8*>(data.data());
+		packet.len = (int)data.size();
+		packet.maxlen = (int)data.size();
+		packet.address = destination.GetSDL_IPaddress();
+		return SDLNet_UDP_Send(m_socket, -1, &packet) > 0;
+	}
+	bool UdpSocket::Receive(std::vector<Uint8>& dataOut, IpAddress& sourceOut)
+	{
+		int result{ SDLNet_UDP_Recv(m_socket, m_receivePacketPtr) };
+		if(result == -1)
+			throw NetworkException{ std::string{"SDLNet_UDP_Recv: "} + SDLNet_GetError() };
+		if(result == 0)
+			return false;
+		dataOut.assign(m_receivePacketPtr->data, m_receivePacketPtr->data + m_receivePacketPtr->len);
+		sourceOut.Set(m_receivePacketPtr->address);
+		return true;
+	}
+	UDPsocket UdpSocket::GetSDL_UDPsocket() const
+	{
+		return m_socket;
+	}
+	IpAddress UdpSocket::GetLocalIpAddress() const
+	{
+		IpAddress localIp;
+		IPaddress* sdlIPaddressPtr{ SDLNet_UDP_GetPeerAddress(m_socket, -1) };
+		if(sdlIPaddressPtr)
+			localIp.Set(*sdlIPaddressPtr);
+		return localIp;
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			NetworkReactor		   |
+	//\--------------------------------/--------------------------------------
+	NetworkReactor::NetworkReactor(Uint16 port, unsigned maxConnections, const NetworkReactorCallbacks& callbacks)
+		: m_listener{ port },
+		  m_socketSet{ SDLNet_AllocSocketSet(maxConnections + 1) },
+		  m_maxConnections{ maxConnections },
+		  m_callbacks{ callbacks }
+	{
+		if(!m_socketSet)
+			throw NetworkException{ std::string{"SDLNet_AllocSocketSet: "} + SDLNet_GetError() };
+		if(!m_listener.Valid() || SDLNet_TCP_AddSocket(m_socketSet, m_listener.GetSDL_TCPsocket()) == -1)
+		{
+			SDLNet_FreeSocketSet(m_socketSet);
+			throw NetworkException{ std::string{"SDLNet_TCP_AddSocket: "} + SDLNet_GetError() };
+		}
+	}
+	NetworkReactor::~NetworkReactor()
+	{
+		for(auto& connectionPtr : m_connections)
+			if(connectionPtr)
+				SDLNet_TCP_DelSocket(m_socketSet, connectionPtr->GetSDL_TCPsocket());
+		SDLNet_TCP_DelSocket(m_socketSet, m_listener.GetSDL_TCPsocket());
+		SDLNet_FreeSocketSet(m_socketSet);
+	}
+	unsigned NetworkReactor::Poll(Uint32 timeoutMilliseconds, unsigned maxMessages)
+	{
+		// Left queued if the last Poll was interrupted by an exception
+		ClosePendingDisconnects();
+
+		int numReady{ SDLNet_CheckSockets(m_socketSet, timeoutMilliseconds) };
+		if(numReady == -1)
+			throw NetworkException{ std::string{"SDLNet_CheckSockets: "} + SDLNet_GetError() };
+
+		unsigned numDispatched{ 0 };
+		{
+			FlagScope pollingScope{ m_polling };
+			if(numReady > 0 && SDLNet_SocketReady(m_listener.GetSDL_TCPsocket()))
+				AcceptPending();
+
+			// Visit every connection: ready sockets get one read, and any buffered
+			// frames (including ones left over from the last Poll) are dispatched.
+			const ConnectionID numSlots{ (ConnectionID)m_connections.size() };
+			for(ConnectionID n = 0; n < numSlots; ++n)
+			{
+				ConnectionID id{ (m_nextToService + n) % numSlots };
+				if(!m_connections[id])
+					continue;
+				if(!ServiceConnection(id, numReady > 0, maxMessages, numDispatched))
+					m_pendingDisconnects.push_back(id);
+				if(numDispatched >= maxMessages)
+				{
+					m_nextToService = id;
+					break;
+				}
+			}
+			if(numDispatched < maxMessages && numSlots)
+				m_nextToService = (m_nextToService + 1) % numSlots;
+		}
+		ClosePendingDisconnects();
+		return numDispatched;
+	}
+	// Returns false if the connection should be closed: its socket failed,
+	//	it sent a malformed frame, or onMessage threw. Frames buffered
+	//	before a failed read are still dispatched.
+	bool NetworkReactor::ServiceConnection(ConnectionID id, bool anyReady, unsigned maxMessages, unsigned& numDispatched)
+	{
+		ClientTcpSocket& connection{ *m_connections[id] };
+		bool healthy{ true };
+		try
+		{
+			if(anyReady && SDLNet_SocketReady(connection.GetSDL_TCPsocket()))
+				healthy = connection.ReceiveAvailable();
+			while(numDispatched < maxMessages && connection.ExtractMessage(m_message))
+			{
+				++numDispatched;
+				if(m_callbacks.onMessage)
+					m_callbacks.onMessage(id, m_message);
+			}
+		}
+		catch(const std::exception& e)
+		{
+			d2LogError << "NetworkReactor: dropping connection " << id << ": " << e.what();
+			healthy = false;
+		}
+		return healthy;
+	}
+	void NetworkReactor::ClosePendingDisconnects()
+	{
+		// Close can run onDisconnect, which can queue more
+		for(size_t i = 0; i < m_pendingDisconnects.size(); ++i)
+			Close(m_pendingDisconnects[i]);
+		m_pendingDisconnects.clear();
+	}
+	void NetworkReactor::AcceptPending()
+	{
+		for(;;)
+		{
+			auto connectionPtr{ std::make_unique<ClientTcpSocket>() };
+
+			// Set before accepting, so the HELLO sent on connecting advertises it
+			connectionPtr->SetCompression(m_compressionEnabled, m_compressionThreshold);
+			if(!m_listener.Accept(*connectionPtr))
+				return;
+
+			// Over capacity: accept and immediately drop so the client sees a close
+			if(m_connectionCount >= m_maxConnections)
+			{
+				d2LogWarning << "NetworkReactor: connection limit reached, dropping client";
+				continue;
+			}
+			if(SDLNet_TCP_AddSocket(m_socketSet, connectionPtr->GetSDL_TCPsocket()) == -1)
+				throw NetworkException{ std::string{"SDLNet_TCP_AddSocket: "} + SDLNet_GetError() };
+
+			ConnectionID id;
+			if(m_freeIDs.empty())
+			{
+				id = (ConnectionID)m_connections.size();
+				m_connections.push_back(std::move(connectionPtr));
+			}
+			else
+			{
+				id = m_freeIDs.back();
+				m_freeIDs.pop_back();
+				m_connections[id] = std::move(connectionPtr);
+			}
+			++m_connectionCount;
+			if(m_callbacks.onConnect)
+				m_callbacks.onConnect(id);
+		}
+	}
+	bool NetworkReactor::Send(ConnectionID id, const NetworkMessage& message)
+	{
+		if(!IsConnected(id))
+			return false;
+		return m_connections[id]->Send(message);
+	}
+	// A failed send drops only that connection; the rest still get the message
+	void NetworkReactor::Broadcast(const NetworkMessage& message)
+	{
+		// Checked once here, so an oversized message is the caller's error
+		//	rather than a send failure on every connection
+		if(message.GetPayload().size() > MAX_MESSAGE_BYTES)
+			throw NetworkException{ "Outgoing message exceeds MAX_MESSAGE_BYTES: "s + std::to_string(message.GetPayload().size()) };
+		for(ConnectionID id = 0; id < (ConnectionID)m_connections.size(); ++id)
+		{
+			if(!m_connections[id])
+				continue;
+			bool sent;
+			try
+			{
+				sent = m_connections[id]->Send(message);
+			}
+			catch(const std::exception& e)
+			{
+				d2LogError << "NetworkReactor: dropping connection " << id << ": " << e.what();
+				sent = false;
+			}
+			if(!sent)
+				Disconnect(id);
+		}
+	}
+	void NetworkReactor::Disconnect(ConnectionID id)
+	{
+		if(!IsConnected(id))
+			return;
+		if(m_polling)
+			m_pendingDisconnects.push_back(id);
+		else
+			Close(id);
+	}
+	void NetworkReactor::Close(ConnectionID id)
+	{
+		// The same id can be queued twice (read failure and a callback request)
+		if(!IsConnected(id))
+			return;
+		SDLNet_TCP_DelSocket(m_socketSet, m_connections[id]->GetSDL_TCPsocket());
+		m_connections[id].reset();
+		m_freeIDs.push_back(id);
+		--m_connectionCount;
+		if(m_callbacks.onDisconnect)
+			m_callbacks.onDisconnect(id);
+	}
+	bool NetworkReactor::IsConnected(ConnectionID id) const
+	{
+		return id < m_connections.size() && m_connections[id];
+	}
+	unsigned NetworkReactor::GetConnectionCount() const
+	{
+		return m_connectionCount;
+	}
+	const SocketStats& NetworkReactor::GetStats(ConnectionID id) const
+	{
+		d2AssertRelease(IsConnected(id));
+		return m_connections[id]->GetStats();
+	}
+	void NetworkReactor::SetCompression(bool enabled, size_t thresholdBytes)
+	{
+		m_compressionEnabled = enabled;
+		m_compressionThreshold = thresholdBytes;
+		for(auto& connectionPtr : m_connections)
+			if(connectionPtr)
+				connectionPtr->SetCompression(enabled, thresholdBytes);
+	}
 }
@@ -0,0 +1,158 @@
+/**************************************************************************************\
+** File: d2NetworkThread.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Source code file for the NetworkThread class
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2NetworkThread.h"
+#include "d2Utility.h"
+namespace d2d
+{
+	NetworkThread::NetworkThread(std::unique_ptr<ClientTcpSocket> socketPtr, const NetworkThreadDef& def)
+		: m_socketPtr{ std::move(socketPtr) },
+		  m_def{ def },
+		  m_outgoing{ def.queueCapacity },
+		  m_incoming{ def.queueCapacity }
+	{
+		d2AssertRelease(m_socketPtr);
+		m_connected = m_socketPtr->IsConnected();
+		m_thread = std::thread{ &NetworkThread::Run, this };
+	}
+	NetworkThread::~NetworkThread()
+	{
+		Stop();
+	}
+	void NetworkThread::Stop()
+	{
+		m_stopRequested = true;
+		if(m_thread.joinable())
+			m_thread.join();
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			 Game thread		   |
+	//\--------------------------------/--------------------------------------
+	bool NetworkThread::Send(NetworkMessage& message)
+	{
+		if(!m_connected)
+			return false;
+		std::swap(m_outgoingScratch.message, message);
+		m_outgoingScratch.enqueueTicks = SDL_GetPerformanceCounter();
+		if(!m_outgoing.TryPush(m_outgoingScratch))
+		{
+			std::swap(m_outgoingScratch.message, message);
+			++m_sendQueueFullCount;
+			return false;
+		}
+
+		// The scratch now holds a recycled message from an earlier send
+		std::swap(m_outgoingScratch.message, message);
+		message.Clear();
+		return true;
+	}
+	bool NetworkThread::Receive(NetworkMessage& messageOut)
+	{
+		return m_incoming.TryPop(messageOut);
+	}
+	bool NetworkThread::IsConnected() const
+	{
+		return m_connected;
+	}
+	NetworkThreadStats NetworkThread::GetStats() const
+	{
+		NetworkThreadStats stats;
+		stats.messagesSent = m_messagesSent;
+		stats.messagesReceived = m_messagesReceived;
+		stats.sendQueueFullCount = m_sendQueueFullCount;
+		const double microsecondsPerTick{ 1.0e6 / (double)SDL_GetPerformanceFrequency() };
+		if(stats.messagesSent)
+			stats.averageSendLatencyMicroseconds = (double)m_latencyTotalTicks * microsecondsPerTick / (double)stats.messagesSent;
+		stats.maxSendLatencyMicroseconds = (double)m_latencyMaxTicks * microsecondsPerTick;
+		return stats;
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			Worker thread		   |
+	//\--------------------------------/--------------------------------------
+	void NetworkThread::Run()
+	{
+		ClientTcpSocket& socket{ *m_socketPtr };
+		try
+		{
+			while(!m_stopRequested && socket.IsConnected())
+			{
+				// Send everything queued in one batch
+				size_t numBatched{ 0 };
+				while(numBatched < m_def.queueCapacity)
+				{
+					if(numBatched == m_batch.size())
+						m_batch.emplace_back();
+					if(!m_outgoing.TryPop(m_batch[numBatched]))
+						break;
+					socket.QueueSend(m_batch[numBatched].message);
+					++numBatched;
+				}
+				if(numBatched)
+				{
+					socket.Flush();
+					const Uint64 now{ SDL_GetPerformanceCounter() };
+					Uint64 totalTicks{ 0 };
+					Uint64 maxTicks{ m_latencyMaxTicks };
+					for(size_t i = 0; i < numBatched; ++i)
+					{
+						const Uint64 ticks{ now - m_batch[i].enqueueTicks };
+						totalTicks += ticks;
+						maxTicks = std::max(maxTicks, ticks);
+					}
+					m_latencyTotalTicks += totalTicks;
+					m_latencyMaxTicks = maxTicks;
+					m_messagesSent += numBatched;
+				}
+
+				// Receive, unless the game thread is behind
+				if(!DeliverIncoming())
+				{
+					SDL_Delay(m_def.waitMilliseconds);
+					continue;
+				}
+				if(socket.Ready(numBatched ? 0 : m_def.waitMilliseconds))
+				{
+					if(!socket.ReceiveAvailable())
+						break;
+					DeliverIncoming();
+				}
+			}
+		}
+		catch(const NetworkException&)
+		{
+			// Already logged by the exception
+		}
+		catch(const std::exception& e)
+		{
+			// Nothing above the worker can catch this, so stop as if disconnected
+			d2LogError << "NetworkThread: stopping after error: " << e.what();
+		}
+		m_connected = false;
+	}
+	// Returns false if the incoming queue filled up
+	bool NetworkThread::DeliverIncoming()
+	{
+		for(;;)
+		{
+			if(!m_hasPendingIncoming)
+			{
+				if(!m_socketPtr->ExtractMessage(m_pendingIncoming))
+					return true;
+				m_hasPendingIncoming = true;
+			}
+			if(!m_incoming.TryPush(m_pendingIncoming))
+				return false;
+			m_hasPendingIncoming = false;
+			++m_messagesReceived;
+		}
+	}
+}
@@ -10,8 +10,11 @@
 #include "d2pch.h"
 #include "d2NumberManip.h"
 #include "d2Range.h"
+#include "d2Simd.h"
 namespace d2d
 {
+	static_assert(sizeof(b2Vec2) == 2 * sizeof(float), "WrapVectors treats b2Vec2 spans as float pairs");
+
 	//+---------------------------\-------------------------------
 	//|	  Angle unit conversion   |
 	//\---------------------------/-------------------------------
@@ -123,6 +126,240 @@ namespace d2d
 		WrapFloat(angleDegrees, 360.0f);
 	}
 
+	//+-------------------\---------------------------------------
+	//|	 Batch functions   |
+	//\-------------------/---------------------------------------
+	//	Each kernel works on whole SIMD registers and returns how many values it
+	//	processed; the caller finishes the remainder with the scalar expression.
+	//	Wrapping takes a low/high pair so that interleaved b2Vec2 x,y values can
+	//	use different bounds. Register widths are even, so the pairing is preserved.
+	namespace
+	{
+		float WrapScalar(float value, float low, float high)
+		{
+			float t = fmodf(value - low, high - low);
+			return t < 0 ? t + high : t + low;
+		}
+
+#ifdef D2_SIMD_SSE2
+		// fmodf(t, size) for four lanes, exact for lanes where |t / size| < 2^23.
+		//	The quotient is formed in double, where it cannot round across an
+		//	integer, and with a quotient that small t - trunc(q) * size is
+		//	exact in double too. Sets one bit of exactMask per exact lane; the
+		//	caller redoes the other lanes (huge quotients, zero size, NaN and
+		//	infinity) with fmodf.
+		__m128 FmodSSE2(__m128 t, __m128d sizeLow, __m128d sizeHigh, int& exactMask)
+		{
+			const __m128d maxQuotient{ _mm_set1_pd(8388608.0) };
+			const __m128d signBit{ _mm_set1_pd(-0.0) };
+			__m128d tLow{ _mm_cvtps_pd(t) };
+			__m128d tHigh{ _mm_cvtps_pd(_mm_movehl_ps(t, t)) };
+			__m128d qLow{ _mm_div_pd(tLow, sizeLow) };
+			__m128d qHigh{ _mm_div_pd(tHigh, sizeHigh) };
+			exactMask = _mm_movemask_pd(_mm_cmplt_pd(_mm_andnot_pd(signBit, qLow), maxQuotient)) |
+				(_mm_movemask_pd(_mm_cmplt_pd(_mm_andnot_pd(signBit, qHigh), maxQuotient)) << 2);
+
+			// cvttpd is in range for every exact lane
+			qLow = _mm_cvtepi32_pd(_mm_cvttpd_epi32(qLow));
+			qHigh = _mm_cvtepi32_pd(_mm_cvttpd_epi32(qHigh));
+			__m128 rLow{ _mm_cvtpd_ps(_mm_sub_pd(tLow, _mm_mul_pd(qLow, sizeLow))) };
+			__m128 rHigh{ _mm_cvtpd_ps(_mm_sub_pd(tHigh, _mm_mul_pd(qHigh, sizeHigh))) };
+			return _mm_movelh_ps(rLow, rHigh);
+		}
+		size_t WrapPairsSSE2(float* values, size_t count, const float low[2], const float high[2])
+		{
+			const __m128 lowV{ _mm_setr_ps(low[0], low[1], low[0], low[1]) };
+			const __m128 highV{ _mm_setr_ps(high[0], high[1], high[0], high[1]) };
+			const __m128d sizeV{ _mm_cvtps_pd(_mm_sub_ps(highV, lowV)) };
+			const __m128 zero{ _mm_setzero_ps() };
+			size_t i{ 0 };
+			for(; i + 4 <= count; i += 4)
+			{
+				// t = fmodf(value - low, size)
+				int exactMask;
+				__m128 t{ FmodSSE2(_mm_sub_ps(_mm_loadu_ps(values + i), lowV), sizeV, sizeV, exactMask) };
+
+				// t < 0 ? t + high : t + low
+				__m128 isNegative{ _mm_cmplt_ps(t, zero) };
+				__m128 offset{ _mm_or_ps(_mm_and_ps(isNegative, highV), _mm_andnot_ps(isNegative, lowV)) };
+				if(exactMask == 0xF)
+					_mm_storeu_ps(values + i, _mm_add_ps(t, offset));
+				else
+				{
+					alignas(16) float wrapped[4];
+					_mm_store_ps(wrapped, _mm_add_ps(t, offset));
+					for(int lane = 0; lane < 4; ++lane)
+						values[i + lane] = (exactMask >> lane) & 1 ? wrapped[lane] :
+							WrapScalar(values[i + lane], low[lane & 1], high[lane & 1]);
+				}
+			}
+			return i;
+		}
+		size_t ClampSSE2(float* values, size_t count, float min, float max)
+		{
+			const __m128 minV{ _mm_set1_ps(min) };
+			const __m128 maxV{ _mm_set1_ps(max) };
+			size_t i{ 0 };
+			for(; i + 4 <= count; i += 4)
+				_mm_storeu_ps(values + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(values + i), minV), maxV));
+			return i;
+		}
+		size_t LerpSSE2(const float* a, const float* b, float percentB, float* out, size_t count)
+		{
+			const __m128 percentBV{ _mm_set1_ps(percentB) };
+			const __m128 percentAV{ _mm_set1_ps(1.0f - percentB) };
+			size_t i{ 0 };
+			for(; i + 4 <= count; i += 4)
+				_mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(percentBV, _mm_loadu_ps(b + i)),
+												  _mm_mul_ps(percentAV, _mm_loadu_ps(a + i))));
+			return i;
+		}
+#endif
+
+#ifdef D2_SIMD_AVX
+		// AVX version of FmodSSE2, eight lanes
+		D2_TARGET_AVX __m256 FmodAVX(__m256 t, __m256d size, int& exactMask)
+		{
+			const __m256d maxQuotient{ _mm256_set1_pd(8388608.0) };
+			const __m256d signBit{ _mm256_set1_pd(-0.0) };
+			__m256d tLow{ _mm256_cvtps_pd(_mm256_castps256_ps128(t)) };
+			__m256d tHigh{ _mm256_cvtps_pd(_mm256_extractf128_ps(t, 1)) };
+			__m256d qLow{ _mm256_div_pd(tLow, size) };
+			__m256d qHigh{ _mm256_div_pd(tHigh, size) };
+			exactMask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_andnot_pd(signBit, qLow), maxQuotient, _CMP_LT_OQ)) |
+				(_mm256_movemask_pd(_mm256_cmp_pd(_mm256_andnot_pd(signBit, qHigh), maxQuotient, _CMP_LT_OQ)) << 4);
+
+			qLow = _mm256_round_pd(qLow, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+			qHigh = _mm256_round_pd(qHigh, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+			__m128 rLow{ _mm256_cvtpd_ps(_mm256_sub_pd(tLow, _mm256_mul_pd(qLow, size))) };
+			__m128 rHigh{ _mm256_cvtpd_ps(_mm256_sub_pd(tHigh, _mm256_mul_pd(qHigh, size))) };
+			return _mm256_insertf128_ps(_mm256_castps128_ps256(rLow), rHigh, 1);
+		}
+		D2_TARGET_AVX size_t WrapPairsAVX(float* values, size_t count, const float low[2], const float high[2])
+		{
+			const __m256 lowV{ _mm256_setr_ps(low[0], low[1], low[0], low[1], low[0], low[1], low[0], low[1]) };
+			const __m256 highV{ _mm256_setr_ps(high[0], high[1], high[0], high[1], high[0], high[1], high[0], high[1]) };
+			const __m256d sizeV{ _mm256_cvtps_pd(_mm256_castps256_ps128(_mm256_sub_ps(highV, lowV))) };
+			const __m256 zero{ _mm256_setzero_ps() };
+			size_t i{ 0 };
+			for(; i + 8 <= count; i += 8)
+			{
+				int exactMask;
+				__m256 t{ FmodAVX(_mm256_sub_ps(_mm256_loadu_ps(values + i), lowV), sizeV, exactMask) };
+				__m256 offset{ _mm256_blendv_ps(lowV, highV, _mm256_cmp_ps(t, zero, _CMP_LT_OQ)) };
+				if(exactMask == 0xFF)
+					_mm256_storeu_ps(values + i, _mm256_add_ps(t, offset));
+				else
+				{
+					alignas(32) float wrapped[8];
+					_mm256_store_ps(wrapped, _mm256_add_ps(t, offset));
+					for(int lane = 0; lane < 8; ++lane)
+						values[i + lane] = (exactMask >> lane) & 1 ? wrapped[lane] :
+							WrapScalar(values[i + lane], low[lane & 1], high[lane & 1]);
+				}
+			}
+			return i;
+		}
+		D2_TARGET_AVX size_t ClampAVX(float* values, size_t count, float min, float max)
+		{
+			const __m256 minV{ _mm256_set1_ps(min) };
+			const __m256 maxV{ _mm256_set1_ps(max) };
+			size_t i{ 0 };
+			for(; i + 8 <= count; i += 8)
+				_mm256_storeu_ps(values + i, _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(values + i), minV), maxV));
+			return i;
+		}
+		D2_TARGET_AVX size_t LerpAVX(const float* a, const float* b, float percentB, float* out, size_t count)
+		{
+			const __m256 percentBV{ _mm256_set1_ps(percentB) };
+			const __m256 percentAV{ _mm256_set1_ps(1.0f - percentB) };
+			size_t i{ 0 };
+			for(; i + 8 <= count; i += 8)
+				_mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(percentBV, _mm256_loadu_ps(b + i)),
+														_mm256_mul_ps(percentAV, _mm256_loadu_ps(a + i))));
+			return i;
+		}
+#endif
+
+		void WrapPairs(float* values, size_t count, const float low[2], const float high[2])
+		{
+			size_t i{ 0 };
+#if defined(D2_SIMD_AVX)
+			if(CpuHasAVX())
+				i = WrapPairsAVX(values, count, low, high);
+			else
+				i = WrapPairsSSE2(values, count, low, high);
+#elif defined(D2_SIMD_SSE2)
+			i = WrapPairsSSE2(values, count, low, high);
+#endif
+			for(; i < count; ++i)
+				values[i] = WrapScalar(values[i], low[i & 1], high[i & 1]);
+		}
+	}
+	void WrapFloats(std::span<float> values, const Range<float>& range)
+	{
+		const float low[2]{ range.GetMin(), range.GetMin() };
+		const float high[2]{ range.GetMax(), range.GetMax() };
+		WrapPairs(values.data(), values.size(), low, high);
+	}
+	void WrapFloats(std::span<float> values, float modulus)
+	{
+		const float low[2]{ 0.0f, 0.0f };
+		const float high[2]{ modulus, modulus };
+		WrapPairs(values.data(), values.size(), low, high);
+	}
+	void WrapVectors(std::span<b2Vec2> values, const Rect& rect)
+	{
+		WrapVectors(values, rect.lowerBound, rect.upperBound);
+	}
+	void WrapVectors(std::span<b2Vec2> values, const b2Vec2& low, const b2Vec2& high)
+	{
+		// Sorted the same way Range<float> sorts its bounds in the scalar version
+		const float lowPair[2]{ std::min(low.x, high.x), std::min(low.y, high.y) };
+		const float highPair[2]{ std::max(low.x, high.x), std::max(low.y, high.y) };
+		WrapPairs(reinterpret_cast<float*>(values.data()), 2 * values.size(), lowPair, highPair);
+	}
+	void WrapRadians(std::span<float> angles)
+	{
+		WrapFloats(angles, TWO_PI);
+	}
+	void WrapDegrees(std::span<float> anglesDegrees)
+	{
+		WrapFloats(anglesDegrees, 360.0f);
+	}
+	void ClampFloats(std::span<float> values, const Range<float>& range)
+	{
+		float* data{ values.data() };
+		size_t count{ values.size() };
+		size_t i{ 0 };
+#if defined(D2_SIMD_AVX)
+		if(CpuHasAVX())
+			i = ClampAVX(data, count, range.GetMin(), range.GetMax());
+		else
+			i = ClampSSE2(data, count, range.GetMin(), range.GetMax());
+#elif defined(D2_SIMD_SSE2)
+		i = ClampSSE2(data, count, range.GetMin(), range.GetMax());
+#endif
+		for(; i < count; ++i)
+			data[i] = GetClamped(data[i], range);
+	}
+	void LerpFloats(std::span<const float> a, std::span<const float> b, float percentB, std::span<float> out)
+	{
+		d2Assert(a.size() == b.size() && a.size() == out.size());
+		size_t count{ std::min({ a.size(), b.size(), out.size() }) };
+		size_t i{ 0 };
+#if defined(D2_SIMD_AVX)
+		if(CpuHasAVX())
+			i = LerpAVX(a.data(), b.data(), percentB, out.data(), count);
+		else
+			i = LerpSSE2(a.data(), b.data(), percentB, out.data(), count);
+#elif defined(D2_SIMD_SSE2)
+		i = LerpSSE2(a.data(), b.data(), percentB, out.data(), count);
+#endif
+		for(; i < count; ++i)
+			out[i] = Lerp(a[i], b[i], percentB);
+	}
+
 	// Rounding
 	int GetRoundedFloat(float value)
 	{
@@ -0,0 +1,168 @@
+/**************************************************************************************\
+** File: d2Particle.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Source code file for the ParticleEmitter class
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Particle.h"
+#include "d2NumberManip.h"
+#include "d2Window.h"
+namespace d2d
+{
+	void ParticleEmitter::Init(const ParticleEmitterDef& def, const RandomStream& randomStream)
+	{
+		m_def = def;
+		m_randomStream = randomStream;
+		m_emitting = true;
+		m_emitAccumulator = 0.0f;
+		m_count = 0;
+
+		m_positions.resize(m_def.capacity);
+		m_velocities.resize(m_def.capacity);
+		m_ages.resize(m_def.capacity);
+		m_lifetimes.resize(m_def.capacity);
+		m_colorPercents.resize(m_def.capacity);
+		m_colors.resize(m_def.capacity);
+	}
+	void ParticleEmitter::SetPosition(const b2Vec2& position)
+	{
+		m_position = position;
+	}
+	void ParticleEmitter::SetEmitting(bool emitting)
+	{
+		m_emitting = emitting;
+		if(!m_emitting)
+			m_emitAccumulator = 0.0f;
+	}
+	bool ParticleEmitter::IsEmitting() const
+	{
+		return m_emitting;
+	}
+	void ParticleEmitter::Clear()
+	{
+		m_count = 0;
+		m_emitAccumulator = 0.0f;
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			   Spawning			   |
+	//\--------------------------------/--------------------------------------
+	void ParticleEmitter::Emit(unsigned numParticles)
+	{
+		numParticles = std::min(numParticles, m_def.capacity - m_count);
+		if(numParticles == 0)
+			return;
+		const unsigned first{ m_count };
+		const unsigned end{ m_count + numParticles };
+
+		// Positions and lifetimes are filled in bulk, then offset per particle
+		m_randomStream.FillVec2InRect({ m_positions.data() + first, numParticles }, m_def.spawnRect);
+		m_randomStream.Fill(std::span<float>{ m_lifetimes.data() + first, numParticles }, m_def.lifetimeRange);
+		const Color32 birthColor{ m_def.colorRange.Lerp(m_def.colorMinAtBirth ? 0.0f : 1.0f) };
+		for(unsigned i = first; i < end; ++i)
+		{
+			m_positions[i] += m_position;
+			float speed{ m_randomStream.NextFloat(m_def.speedRange) };
+			float direction{ m_randomStream.NextFloat(m_def.directionRange) };
+			m_velocities[i] = speed * GetUnitVec2FromAngle(direction);
+			m_ages[i] = 0.0f;
+			m_colors[i] = birthColor;
+		}
+		m_count = end;
+	}
+	void ParticleEmitter::Spawn(float dt)
+	{
+		if(!m_emitting)
+			return;
+		m_emitAccumulator += dt * m_def.particlesPerSecond;
+		unsigned numToEmit{ (unsigned)m_emitAccumulator };
+		m_emitAccumulator -= (float)numToEmit;
+		Emit(numToEmit);
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			   Updating			   |
+	//\--------------------------------/--------------------------------------
+	void ParticleEmitter::Update(float dt)
+	{
+		Spawn(dt);
+		UpdateRange(dt, 0, m_count);
+		RemoveExpired();
+	}
+	// Only touches particles in [first, first + count), so disjoint ranges
+	// can be updated concurrently.
+	void ParticleEmitter::UpdateRange(float dt, unsigned first, unsigned count)
+	{
+		d2Assert(first + count <= m_count);
+		const unsigned end{ first + count };
+		b2Vec2* positions{ m_positions.data() };
+		const b2Vec2* velocities{ m_velocities.data() };
+		float* ages{ m_ages.data() };
+		const float* lifetimes{ m_lifetimes.data() };
+		float* colorPercents{ m_colorPercents.data() };
+
+		for(unsigned i = first; i < end; ++i)
+		{
+			positions[i].x += dt * velocities[i].x;
+			positions[i].y += dt * velocities[i].y;
+		}
+		for(unsigned i = first; i < end; ++i)
+		{
+			ages[i] += dt;
+			float percentOfLife{ lifetimes[i] > 0.0f ? ages[i] / lifetimes[i] : 1.0f };
+			colorPercents[i] = GetClampedPercent(percentOfLife);
+		}
+		if(!m_def.colorMinAtBirth)
+			for(unsigned i = first; i < end; ++i)
+				colorPercents[i] = 1.0f - colorPercents[i];
+
+		m_def.colorRange.LerpMany({ colorPercents + first, count }, { m_colors.data() + first, count });
+	}
+	void ParticleEmitter::RemoveExpired()
+	{
+		unsigned i{ 0 };
+		while(i < m_count)
+		{
+			if(m_ages[i] >= m_lifetimes[i])
+			{
+				// Swap-remove: move the last live particle into this slot
+				--m_count;
+				m_positions[i] = m_positions[m_count];
+				m_velocities[i] = m_velocities[m_count];
+				m_ages[i] = m_ages[m_count];
+				m_lifetimes[i] = m_lifetimes[m_count];
+				m_colors[i] = m_colors[m_count];
+			}
+			else
+				++i;
+		}
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			   Drawing			   |
+	//\--------------------------------/--------------------------------------
+	void ParticleEmitter::Draw() const
+	{
+		if(!m_count)
+			return;
+		if(m_def.texturePtr)
+			Window::DrawTexturedQuads(*m_def.texturePtr, m_positions.data(), m_colors.data(), m_count, m_def.particleSize);
+		else
+		{
+			Window::SetPointSize(m_def.particleSize.x);
+			Window::DrawPoints(m_positions.data(), m_colors.data(), m_count);
+		}
+	}
+	unsigned ParticleEmitter::GetCount() const
+	{
+		return m_count;
+	}
+	unsigned ParticleEmitter::GetCapacity() const
+	{
+		return m_def.capacity;
+	}
+}
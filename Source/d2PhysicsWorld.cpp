@@ -0,0 +1,185 @@
+/**************************************************************************************\
+** File: d2PhysicsWorld.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Source code file for the PhysicsWorld class
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2PhysicsWorld.h"
+#include "d2Utility.h"
+namespace d2d
+{
+	namespace
+	{
+		void AddProfile(b2Profile& total, const b2Profile& profile)
+		{
+			total.step += profile.step;
+			total.collide += profile.collide;
+			total.solve += profile.solve;
+			total.solveInit += profile.solveInit;
+			total.solveVelocity += profile.solveVelocity;
+			total.solvePosition += profile.solvePosition;
+			total.broadphase += profile.broadphase;
+			total.solveTOI += profile.solveTOI;
+		}
+	}
+	PhysicsWorld::PhysicsWorld(const PhysicsWorldDef& def)
+		: m_def{ def },
+		  m_world{ def.gravity }
+	{
+		d2AssertRelease(m_def.subSteps > 0);
+		m_world.SetAllowSleeping(m_def.allowSleeping);
+	}
+	PhysicsWorld::~PhysicsWorld()
+	{
+		if(m_thread.joinable())
+		{
+			{
+				std::lock_guard<std::mutex> lock{ m_mutex };
+				m_stopRequested = true;
+			}
+			m_condition.notify_all();
+			m_thread.join();
+		}
+	}
+	b2World& PhysicsWorld::GetWorld()
+	{
+		d2AssertRelease(!IsStepping());
+		return m_world;
+	}
+	void PhysicsWorld::DestroyBody(b2Body* bodyPtr)
+	{
+		d2AssertRelease(!IsStepping());
+		if(!m_transformIndexValid)
+		{
+			m_transformIndex.clear();
+			for(size_t i = 0; i < m_transforms.size(); ++i)
+				m_transformIndex.emplace(m_transforms[i].bodyPtr, i);
+			m_transformIndexValid = true;
+		}
+		auto indexIterator{ m_transformIndex.find(bodyPtr) };
+		if(indexIterator != m_transformIndex.end())
+		{
+			m_transforms[indexIterator->second].bodyPtr = nullptr;
+			m_transformIndex.erase(indexIterator);
+		}
+		m_world.DestroyBody(bodyPtr);
+	}
+	void PhysicsWorld::Step(float dt)
+	{
+		d2AssertRelease(!IsStepping());
+		RunStep(dt);
+		PublishStep();
+	}
+	void PhysicsWorld::PublishStep()
+	{
+		std::swap(m_stats, m_backStats);
+		std::swap(m_transforms, m_backTransforms);
+		m_transformIndexValid = false;
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			 Async stepping		   |
+	//\--------------------------------/--------------------------------------
+	void PhysicsWorld::StepAsync(float dt)
+	{
+		d2AssertRelease(!IsStepping());
+		if(!m_thread.joinable())
+			m_thread = std::thread{ &PhysicsWorld::RunWorker, this };
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			m_requestedDt = dt;
+			m_stepRequested = true;
+			m_stepping = true;
+		}
+		m_condition.notify_all();
+		m_waitPending = true;
+	}
+	void PhysicsWorld::WaitForStep()
+	{
+		if(!m_waitPending)
+			return;
+		{
+			std::unique_lock<std::mutex> lock{ m_mutex };
+			m_condition.wait(lock, [this] { return !m_stepping; });
+		}
+		m_waitPending = false;
+		PublishStep();
+	}
+	bool PhysicsWorld::IsStepping() const
+	{
+		return m_waitPending;
+	}
+	void PhysicsWorld::RunWorker()
+	{
+		std::unique_lock<std::mutex> lock{ m_mutex };
+		for(;;)
+		{
+			m_condition.wait(lock, [this] { return m_stepRequested || m_stopRequested; });
+			if(m_stopRequested)
+				return;
+			m_stepRequested = false;
+			const float dt{ m_requestedDt };
+			lock.unlock();
+			RunStep(dt);
+			lock.lock();
+			m_stepping = false;
+			m_condition.notify_all();
+		}
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|				Stepping		   |
+	//\--------------------------------/--------------------------------------
+	// Steps the world and fills the back buffers
+	void PhysicsWorld::RunStep(float dt)
+	{
+		const Uint64 startTicks{ SDL_GetPerformanceCounter() };
+		const float subStepDt{ dt / (float)m_def.subSteps };
+		b2Profile profile{};
+
+		// Keep forces applied for the whole step, not just the first substep
+		m_world.SetAutoClearForces(false);
+		for(unsigned i = 0; i < m_def.subSteps; ++i)
+		{
+			m_world.Step(subStepDt, m_def.velocityIterations, m_def.positionIterations);
+			AddProfile(profile, m_world.GetProfile());
+		}
+		m_world.ClearForces();
+		m_world.SetAutoClearForces(true);
+
+		m_backTransforms.clear();
+		m_backTransforms.reserve(m_world.GetBodyCount());
+		unsigned awakeBodyCount{ 0 };
+		for(const b2Body* bodyPtr = m_world.GetBodyList(); bodyPtr; bodyPtr = bodyPtr->GetNext())
+		{
+			m_backTransforms.push_back({ bodyPtr, bodyPtr->GetPosition(), bodyPtr->GetAngle() });
+			if(bodyPtr->IsAwake())
+				++awakeBodyCount;
+		}
+
+		m_backStats.profile = profile;
+		m_backStats.bodyCount = (unsigned)m_world.GetBodyCount();
+		m_backStats.awakeBodyCount = awakeBodyCount;
+		m_backStats.contactCount = (unsigned)m_world.GetContactCount();
+		m_backStats.proxyCount = (unsigned)m_world.GetProxyCount();
+		m_backStats.steps = m_stats.steps + 1;
+		m_backStats.stepMilliseconds = (float)((double)(SDL_GetPerformanceCounter() - startTicks) * 1000.0
+			/ (double)SDL_GetPerformanceFrequency());
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			   Accessors		   |
+	//\--------------------------------/--------------------------------------
+	std::span<const BodyTransform> PhysicsWorld::GetTransforms() const
+	{
+		return m_transforms;
+	}
+	const PhysicsStats& PhysicsWorld::GetStats() const
+	{
+		return m_stats;
+	}
+}
@@ -11,45 +11,224 @@
 #include "d2Random.h"
 #include "d2Range.h"
 #include "d2Rect.h"
+#include <atomic>
 namespace d2d
 {
 	namespace
 	{
-		std::mt19937 m_rng;
+		//+---------------------\-------------------------------------
+		//|	  Philox4x32-10		|
+		//\---------------------/
+		//	Counter-based bijection used to derive stream keys and states.
+		//	The domain word keeps the three uses from ever sharing an input.
+		//------------------------------------------------------------
+		enum class PhiloxDomain : Uint32
+		{
+			STREAM_KEY, CHILD_KEY, GENERATOR_STATE
+		};
+		std::array<Uint32, 4> Philox4x32(Uint64 key, Uint64 counter, PhiloxDomain domain)
+		{
+			const Uint32 M0{ 0xD2511F53u };
+			const Uint32 M1{ 0xCD9E8D57u };
+			const Uint32 W0{ 0x9E3779B9u };
+			const Uint32 W1{ 0xBB67AE85u };
+			Uint32 k0{ (Uint32)key };
+			Uint32 k1{ (Uint32)(key >> 32) };
+			std::array<Uint32, 4> c{ (Uint32)counter, (Uint32)(counter >> 32), (Uint32)domain, 0u };
+			for(int round = 0; round < 10; ++round)
+			{
+				const Uint64 product0{ (Uint64)M0 * c[0] };
+				const Uint64 product1{ (Uint64)M1 * c[2] };
+				c = { (Uint32)(product1 >> 32) ^ c[1] ^ k0, (Uint32)product1,
+					  (Uint32)(product0 >> 32) ^ c[3] ^ k1, (Uint32)product0 };
+				k0 += W0;
+				k1 += W1;
+			}
+			return c;
+		}
+		Uint64 PhiloxKey(Uint64 key, Uint64 counter, PhiloxDomain domain)
+		{
+			std::array<Uint32, 4> block{ Philox4x32(key, counter, domain) };
+			return (Uint64)block[0] | ((Uint64)block[1] << 32);
+		}
+		Uint32 RotateLeft(Uint32 x, int k)
+		{
+			return (x << k) | (x >> (32 - k));
+		}
+
+		// Each thread gets its own default stream of the default seed
+		std::atomic<Uint64> m_nextThreadStreamID{ 0 };
+		thread_local RandomStream m_defaultStream{ DEFAULT_RANDOM_SEED, m_nextThreadStreamID++ };
 	}
+
+	//+---------------------\-------------------------------------
+	//|	   RandomStream		|
+	//\---------------------/-------------------------------------
+	RandomStream::RandomStream(Uint64 seed, Uint64 streamID)
+	{
+		Seed(seed, streamID);
+	}
+	void RandomStream::Seed(Uint64 seed, Uint64 streamID)
+	{
+		SetKey(PhiloxKey(seed, streamID, PhiloxDomain::STREAM_KEY));
+	}
+	void RandomStream::SetKey(Uint64 key)
+	{
+		m_key = key;
+		m_splitCount = 0;
+		std::array<Uint32, 4> block{ Philox4x32(key, 0, PhiloxDomain::GENERATOR_STATE) };
+		for(int i = 0; i < 4; ++i)
+			m_state[i] = block[i];
+
+		// xoshiro must never have an all-zero state
+		if(!(m_state[0] | m_state[1] | m_state[2] | m_state[3]))
+			m_state[0] = 1;
+	}
+	Uint64 RandomStream::GetKey() const
+	{
+		return m_key;
+	}
+	RandomStream RandomStream::Split()
+	{
+		RandomStream child;
+		child.SetKey(PhiloxKey(m_key, m_splitCount++, PhiloxDomain::CHILD_KEY));
+		return child;
+	}
+	void RandomStream::Split(std::span<RandomStream> childrenOut)
+	{
+		for(RandomStream& child : childrenOut)
+			child = Split();
+	}
+	Uint32 RandomStream::NextUint32()
+	{
+		const Uint32 result{ RotateLeft(m_state[1] * 5, 7) * 9 };
+		const Uint32 t{ m_state[1] << 9 };
+		m_state[2] ^= m_state[0];
+		m_state[3] ^= m_state[1];
+		m_state[1] ^= m_state[2];
+		m_state[0] ^= m_state[3];
+		m_state[2] ^= t;
+		m_state[3] = RotateLeft(m_state[3], 11);
+		return result;
+	}
+	float RandomStream::NextFloatPercent()
+	{
+		// Top 24 bits fill the float mantissa exactly: [0,1)
+		return (float)(NextUint32() >> 8) * (1.0f / 16777216.0f);
+	}
+	float RandomStream::NextFloat(const Range<float>& range)
+	{
+		return range.GetMin() + NextFloatPercent() * range.GetSize();
+	}
+	int RandomStream::NextInt(const Range<int>& range)
+	{
+		// Lemire's multiply-shift with rejection, unbiased for any range size
+		const Uint32 rangeSize{ (Uint32)((Sint64)range.GetMax() - (Sint64)range.GetMin() + 1) };
+		if(rangeSize == 0)
+			return (int)NextUint32();
+		Uint64 product{ (Uint64)NextUint32() * rangeSize };
+		Uint32 low{ (Uint32)product };
+		if(low < rangeSize)
+		{
+			const Uint32 threshold{ (0u - rangeSize) % rangeSize };
+			while(low < threshold)
+			{
+				product = (Uint64)NextUint32() * rangeSize;
+				low = (Uint32)product;
+			}
+		}
+		return (int)((Sint64)range.GetMin() + (Sint64)(product >> 32));
+	}
+	bool RandomStream::NextBool()
+	{
+		return (NextUint32() >> 31) != 0;
+	}
+	b2Vec2 RandomStream::NextVec2InRect(const Rect& rect)
+	{
+		return NextVec2InRange(rect.lowerBound, rect.upperBound);
+	}
+	b2Vec2 RandomStream::NextVec2InRange(const b2Vec2& low, const b2Vec2& high)
+	{
+		float x{ NextFloat({ low.x, high.x }) };
+		float y{ NextFloat({ low.y, high.y }) };
+		return { x, y };
+	}
+	void RandomStream::Fill(std::span<float> out, const Range<float>& range)
+	{
+		const float min{ range.GetMin() };
+		const float size{ range.GetSize() };
+		for(float& value : out)
+			value = min + NextFloatPercent() * size;
+	}
+	void RandomStream::Fill(std::span<int> out, const Range<int>& range)
+	{
+		for(int& value : out)
+			value = NextInt(range);
+	}
+	void RandomStream::FillVec2InRect(std::span<b2Vec2> out, const Rect& rect)
+	{
+		const Range<float> xRange{ rect.lowerBound.x, rect.upperBound.x };
+		const Range<float> yRange{ rect.lowerBound.y, rect.upperBound.y };
+		for(b2Vec2& value : out)
+		{
+			value.x = xRange.GetMin() + NextFloatPercent() * xRange.GetSize();
+			value.y = yRange.GetMin() + NextFloatPercent() * yRange.GetSize();
+		}
+	}
+
 	//+---------------------\-------------------------------------
 	//|	  Random numbers	|
 	//\---------------------/-------------------------------------
+	RandomStream& GetDefaultRandomStream()
+	{
+		return m_defaultStream;
+	}
+	void SetDefaultRandomStream(const RandomStream& stream)
+	{
+		m_defaultStream = stream;
+	}
 	void SeedRandomNumberGenerator(unsigned newSeed)
 	{
-		m_rng.seed(newSeed);
+		m_defaultStream.Seed(newSeed);
+	}
+	void SeedRandomNumberGenerator(Uint64 newSeed, Uint64 streamID)
+	{
+		m_defaultStream.Seed(newSeed, streamID);
 	}
 	float RandomFloatPercent()
 	{
-		return RandomFloat(VALID_PERCENT_RANGE);
+		return m_defaultStream.NextFloatPercent();
 	}
 	float RandomFloat(const Range<float>& range)
 	{
-		return std::uniform_real_distribution<float>{ range.GetMin(), range.GetMax() }(m_rng);
+		return m_defaultStream.NextFloat(range);
 	}
 	int RandomInt(const Range<int>& range)
 	{
-		return std::uniform_int_distribution<int>(range.GetMin(), range.GetMax())(m_rng);
+		return m_defaultStream.NextInt(range);
 	}
 	bool RandomBool()
 	{
-		return RandomInt({ 0, 1 });
+		return m_defaultStream.NextBool();
 	}
 	b2Vec2 RandomVec2InRect(const Rect& rect)
 	{
-		return
-		{ RandomFloat( {rect.lowerBound.x, rect.upperBound.x} ),
-		  RandomFloat( {rect.lowerBound.y, rect.upperBound.y} ) };
+		return m_defaultStream.NextVec2InRect(rect);
 	}
 	b2Vec2 RandomVec2InRange(const b2Vec2& low, const b2Vec2& high)
 	{
-		return
-		{ RandomFloat( {low.x, high.x} ),
-		  RandomFloat( {low.y, high.y} ) };
+		return m_defaultStream.NextVec2InRange(low, high);
+	}
+	void RandomFloats(std::span<float> out, const Range<float>& range)
+	{
+		m_defaultStream.Fill(out, range);
+	}
+	void RandomInts(std::span<int> out, const Range<int>& range)
+	{
+		m_defaultStream.Fill(out, range);
+	}
+	void RandomVec2sInRect(std::span<b2Vec2> out, const Rect& rect)
+	{
+		m_defaultStream.FillVec2InRect(out, rect);
 	}
 }
@@ -10,89 +10,494 @@
 #include "d2pch.h"
 #include "d2ShapeFactory.h"
 #include "d2Utility.h"
+#include "d2Vfs.h"
 
 namespace d2d
 {
-	// Load shapes from file and add to bodyMap, overwriting existing entries with the same name
-	void ShapeFactory::LoadFrom(const std::string& filePath)
+	namespace
 	{
-		boost::property_tree::ptree data;
-		boost::property_tree::read_xml(filePath, data);
-		for(auto const& bodyNode : data.get_child("bodydef.bodies"))
+		//+--------------------------------\--------------------------------------
+		//|			  XmlReader			   |
+		//\--------------------------------/
+		//	Minimal streaming XML tokenizer for body files. Next moves to the
+		//	next start or end tag; a self-closing tag gives a start then an end.
+		//	Text, comments, declarations and processing instructions are
+		//	skipped. Names and attribute values point into the source text,
+		//	and the attribute list is reused, so reading allocates nothing
+		//	once it has seen the tag with the most attributes.
+		//------------------------------------------------------------------------
+		class XmlReader
 		{
-			if(bodyNode.first == "body")
+		public:
+			enum class Event { START, END, DONE };
+			XmlReader(std::string_view text, const std::string& filePath)
+				: m_text{ text }, m_filePath{ filePath }
+			{ }
+			Event Next()
+			{
+				if(m_pendingEnd)
+				{
+					m_pendingEnd = false;
+					return Event::END;
+				}
+				for(;;)
+				{
+					m_position = m_text.find('<', m_position);
+					if(m_position == std::string_view::npos)
+						return Event::DONE;
+					if(m_text.compare(m_position, 4, "<!--") == 0)
+						SkipPast("-->");
+					else if(m_text.compare(m_position, 2, "<?") == 0)
+						SkipPast("?>");
+					else if(m_text.compare(m_position, 2, "<!") == 0)
+						SkipPast(">");
+					else if(m_text.compare(m_position, 2, "</") == 0)
+					{
+						m_position += 2;
+						m_name = ReadName();
+						SkipPast(">");
+						return Event::END;
+					}
+					else
+					{
+						++m_position;
+						m_name = ReadName();
+						ReadAttributes();
+						return Event::START;
+					}
+				}
+			}
+			std::string_view GetName() const
+			{
+				return m_name;
+			}
+			std::string_view GetAttribute(std::string_view attributeName) const
+			{
+				for(const auto& [name, value] : m_attributes)
+					if(name == attributeName)
+						return value;
+				throw Error("missing attribute "s + std::string{ attributeName } + " in <" + std::string{ m_name } + '>');
+			}
+			float GetFloatAttribute(std::string_view attributeName) const
+			{
+				std::string_view text{ GetAttribute(attributeName) };
+				float value;
+				auto [end, errorCode]{ std::from_chars(text.data(), text.data() + text.size(), value) };
+				if(errorCode != std::errc{} || end != text.data() + text.size())
+					throw Error("bad number \""s + std::string{ text } + "\" for " + std::string{ attributeName });
+				return value;
+			}
+			// Decodes the predefined entities, which can appear in names
+			std::string GetStringAttribute(std::string_view attributeName) const
+			{
+				std::string_view text{ GetAttribute(attributeName) };
+				std::string value;
+				value.reserve(text.size());
+				for(size_t i = 0; i < text.size(); ++i)
+				{
+					if(text[i] != '&')
+					{
+						value += text[i];
+						continue;
+					}
+					const size_t end{ text.find(';', i) };
+					if(end == std::string_view::npos)
+						throw Error("unterminated entity in "s + std::string{ attributeName });
+					const std::string_view entity{ text.substr(i + 1, end - i - 1) };
+					if(entity == "lt") value += '<';
+					else if(entity == "gt") value += '>';
+					else if(entity == "amp") value += '&';
+					else if(entity == "quot") value += '"';
+					else if(entity == "apos") value += '\'';
+					else
+						throw Error("unknown entity &"s + std::string{ entity } + ';');
+					i = end;
+				}
+				return value;
+			}
+			InitException Error(const std::string& message) const
 			{
-				// name
-				std::string bodyName{ bodyNode.second.get<std::string>("<xmlattr>.name") };
-				SDL_assert_release(bodyName.length() > 0);
+				return InitException{ "Failed to load body file " + m_filePath + ": " + message };
+			}
 
-				// overwrite any existing body
-				m_bodyMap[bodyName].fixtureGroups.clear();
-				m_bodyMap[bodyName].sourceImageSize.SetZero();
+		private:
+			bool IsSpace(char c) const
+			{
+				return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+			}
+			void SkipSpace()
+			{
+				while(m_position < m_text.size() && IsSpace(m_text[m_position]))
+					++m_position;
+			}
+			void SkipPast(std::string_view terminator)
+			{
+				const size_t end{ m_text.find(terminator, m_position) };
+				if(end == std::string_view::npos)
+					throw Error("unterminated tag");
+				m_position = end + terminator.size();
+			}
+			std::string_view ReadName()
+			{
+				const size_t start{ m_position };
+				while(m_position < m_text.size() && !IsSpace(m_text[m_position])
+					&& m_text[m_position] != '>' && m_text[m_position] != '/' && m_text[m_position] != '=')
+					++m_position;
+				if(m_position == start)
+					throw Error("expected a name");
+				return m_text.substr(start, m_position - start);
+			}
+			void ReadAttributes()
+			{
+				m_attributes.clear();
+				for(;;)
+				{
+					SkipSpace();
+					if(m_position >= m_text.size())
+						throw Error("unterminated tag");
+					if(m_text[m_position] == '>')
+					{
+						++m_position;
+						return;
+					}
+					if(m_text.compare(m_position, 2, "/>") == 0)
+					{
+						m_position += 2;
+						m_pendingEnd = true;
+						return;
+					}
+					const std::string_view name{ ReadName() };
+					SkipSpace();
+					if(m_position >= m_text.size() || m_text[m_position] != '=')
+						throw Error("expected = after "s + std::string{ name });
+					++m_position;
+					SkipSpace();
+					if(m_position >= m_text.size() || (m_text[m_position] != '"' && m_text[m_position] != '\''))
+						throw Error("expected a quoted value for "s + std::string{ name });
+					const char quote{ m_text[m_position++] };
+					const size_t end{ m_text.find(quote, m_position) };
+					if(end == std::string_view::npos)
+						throw Error("unterminated value for "s + std::string{ name });
+					m_attributes.emplace_back(name, m_text.substr(m_position, end - m_position));
+					m_position = end + 1;
+				}
+			}
+			std::string_view m_text;
+			const std::string& m_filePath;
+			size_t m_position{ 0 };
+			std::string_view m_name;
+			std::vector<std::pair<std::string_view, std::string_view>> m_attributes;
+			bool m_pendingEnd{ false };
+		};
 
-				// size relative to entity
-				float width{ bodyNode.second.get<float>("<xmlattr>.width") };
-				float height{ bodyNode.second.get<float>("<xmlattr>.height") };
-				SDL_assert_release(width > 0.0f);
-				SDL_assert_release(height > 0.0f);
-				m_bodyMap[bodyName].sourceImageSize.Set(width, height);
+		//+--------------------------------\--------------------------------------
+		//|		  Binary body files		   |
+		//\--------------------------------/--------------------------------------
+		enum class BodyFileGroupType : Uint8
+		{
+			CIRCLE = 0,
+			POLYGON = 1
+		};
+		void AppendUint32(std::vector<Uint8>& out, Uint32 value)
+		{
+			value = SDL_SwapLE32(value);
+			const Uint8* bytes{ (const Uint8*)&value };
+			out.insert(out.end(), bytes, bytes + sizeof(value));
+		}
+		void AppendFloat(std::vector<Uint8>& out, float value)
+		{
+			AppendUint32(out, std::bit_cast<Uint32>(value));
+		}
+		class BinaryReader
+		{
+		public:
+			BinaryReader(std::span<const Uint8> data, const std::string& filePath)
+				: m_data{ data }, m_filePath{ filePath }
+			{ }
+			const Uint8* ReadBytes(size_t numBytes)
+			{
+				if(numBytes > m_data.size() - m_position)
+					throw InitException{ "Failed to load body file " + m_filePath + ": truncated" };
+				const Uint8* bytes{ m_data.data() + m_position };
+				m_position += numBytes;
+				return bytes;
+			}
+			Uint8 ReadUint8()
+			{
+				return *ReadBytes(1);
+			}
+			Uint32 ReadUint32()
+			{
+				Uint32 value;
+				std::memcpy(&value, ReadBytes(sizeof(value)), sizeof(value));
+				return SDL_SwapLE32(value);
+			}
+			float ReadFloat()
+			{
+				return std::bit_cast<float>(ReadUint32());
+			}
+			// Every element takes at least minElementBytes, so a larger count is corrupt
+			Uint32 ReadCount(size_t minElementBytes)
+			{
+				const Uint32 count{ ReadUint32() };
+				if(count > (m_data.size() - m_position) / minElementBytes)
+					throw InitException{ "Failed to load body file " + m_filePath + ": count out of range" };
+				return count;
+			}
+			bool IsAtEnd() const
+			{
+				return m_position == m_data.size();
+			}
+		private:
+			std::span<const Uint8> m_data;
+			const std::string& m_filePath;
+			size_t m_position{ 0 };
+		};
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|				Loading			   |
+	//\--------------------------------/--------------------------------------
+	// Load shapes from file and add them to the models, overwriting existing models with the same name
+	void ShapeFactory::LoadFrom(const std::string& filePath)
+	{
+		// Parse straight from the file's view, mapped or in an archive
+		const VfsFile file{ OpenFile(filePath) };
+		const std::span<const Uint8> bytes{ file.GetBytes() };
 
-				for(auto const& fixtureGroupNode : bodyNode.second.get_child("fixtureGroups"))
+		m_numParsedModels = 0;
+		if(bytes.size() >= sizeof(BODY_FILE_MAGIC)
+			&& std::memcmp(bytes.data(), BODY_FILE_MAGIC, sizeof(BODY_FILE_MAGIC)) == 0)
+			LoadBinary(bytes, filePath);
+		else
+			LoadXml(file.GetText(), filePath);
+	}
+	// Returns the model's body, emptied, dropping any cached shapes but keeping its handle
+	Body& ShapeFactory::BeginModel(const std::string& modelName)
+	{
+		SDL_assert_release(modelName.length() > 0);
+		ModelHandle model;
+		auto handleIterator{ m_modelHandles.find(modelName) };
+		if(handleIterator != m_modelHandles.end())
+		{
+			model = handleIterator->second;
+			m_shapeCacheStats.entries -= m_shapeCache[model].size();
+			m_shapeCache[model].clear();
+		}
+		else
+		{
+			model = (ModelHandle)m_bodies.size();
+			m_bodies.emplace_back();
+			m_modelNames.push_back(modelName);
+			m_shapeCache.emplace_back();
+			m_modelHandles.emplace(modelName, model);
+		}
+		Body& body{ m_bodies[model] };
+		body.fixtureGroups.clear();
+		body.polygons.clear();
+		body.sourceImageSize.SetZero();
+		return body;
+	}
+	// Files are parsed into m_parsedModels and only then swapped into the
+	//	models, so a failed load changes nothing. Swapping hands the replaced
+	//	bodies' vectors back for the next load to reuse.
+	Body& ShapeFactory::AddParsedModel(std::string_view modelName)
+	{
+		if(m_numParsedModels == m_parsedModels.size())
+			m_parsedModels.emplace_back();
+		auto& [name, body] { m_parsedModels[m_numParsedModels++] };
+		name.assign(modelName);
+		body.fixtureGroups.clear();
+		body.polygons.clear();
+		body.sourceImageSize.SetZero();
+		return body;
+	}
+	void ShapeFactory::CommitParsedModels()
+	{
+		for(size_t i = 0; i < m_numParsedModels; ++i)
+			std::swap(BeginModel(m_parsedModels[i].first), m_parsedModels[i].second);
+		m_numParsedModels = 0;
+	}
+	void ShapeFactory::LoadXml(std::string_view text, const std::string& filePath)
+	{
+		XmlReader reader{ text, filePath };
+		Body* bodyPtr{ nullptr };
+		FixtureGroup fixtureGroup;
+		bool inFixtureGroup{ false };
+		PolygonShape poly;
+		bool inPolygon{ false };
+		for(XmlReader::Event event{ reader.Next() }; event != XmlReader::Event::DONE; event = reader.Next())
+		{
+			const std::string_view name{ reader.GetName() };
+			if(event == XmlReader::Event::START)
+			{
+				if(name == "body")
+				{
+					// size relative to entity
+					const std::string modelName{ reader.GetStringAttribute("name") };
+					SDL_assert_release(modelName.length() > 0);
+					bodyPtr = &AddParsedModel(modelName);
+					float width{ reader.GetFloatAttribute("width") };
+					float height{ reader.GetFloatAttribute("height") };
+					SDL_assert_release(width > 0.0f);
+					SDL_assert_release(height > 0.0f);
+					bodyPtr->sourceImageSize.Set(width, height);
+				}
+				else if(name == "fixtureGroup" && bodyPtr)
+				{
+					std::string_view shapeType{ reader.GetAttribute("type") };
+					SDL_assert_release(shapeType == "CIRCLE" || shapeType == "POLYGON");
+					fixtureGroup.isCircle = shapeType == "CIRCLE";
+					fixtureGroup.firstPolygon = fixtureGroup.isCircle ? 0 : (unsigned)bodyPtr->polygons.size();
+					fixtureGroup.numPolygons = 0;
+					inFixtureGroup = true;
+				}
+				else if(name == "circle" && inFixtureGroup && fixtureGroup.isCircle)
+				{
+					const b2Vec2 size{ bodyPtr->sourceImageSize };
+					float radius{ reader.GetFloatAttribute("r") };
+					SDL_assert_release(radius >= 0.0f);
+					fixtureGroup.circle.center.x = reader.GetFloatAttribute("x") / size.x;
+					fixtureGroup.circle.center.y = reader.GetFloatAttribute("y") / size.y;
+					fixtureGroup.circle.radiusRelativeToWidth = radius / size.x;
+				}
+				else if(name == "polygon" && inFixtureGroup && !fixtureGroup.isCircle)
+				{
+					poly.numVertices = 0;
+					inPolygon = true;
+				}
+				else if(name == "point" && inPolygon)
+				{
+					const b2Vec2 size{ bodyPtr->sourceImageSize };
+					SDL_assert_release(poly.numVertices < maxPolygonVertices);
+					poly.vertices[poly.numVertices].Set(reader.GetFloatAttribute("x") / size.x,
+						reader.GetFloatAttribute("y") / size.y);
+					++poly.numVertices;
+				}
+			}
+			else
+			{
+				if(name == "polygon" && inPolygon)
+				{
+					bodyPtr->polygons.push_back(poly);
+					inPolygon = false;
+				}
+				else if(name == "fixtureGroup" && inFixtureGroup)
 				{
-					if(fixtureGroupNode.first == "fixtureGroup")
+					if(!fixtureGroup.isCircle)
+						fixtureGroup.numPolygons = (unsigned)bodyPtr->polygons.size() - fixtureGroup.firstPolygon;
+					bodyPtr->fixtureGroups.push_back(fixtureGroup);
+					inFixtureGroup = false;
+				}
+				else if(name == "body")
+					bodyPtr = nullptr;
+			}
+		}
+		CommitParsedModels();
+	}
+	void ShapeFactory::LoadBinary(std::span<const Uint8> data, const std::string& filePath)
+	{
+		// Smallest encodings: a body with a 1 byte name and no groups,
+		//	a polygon group with no polygons, and a polygon with no vertices
+		const size_t MIN_BODY_BYTES{ 4 + 1 + 2 * 4 + 4 };
+		const size_t MIN_GROUP_BYTES{ 1 + 4 };
+		const size_t MIN_POLYGON_BYTES{ 1 };
+
+		BinaryReader reader{ data, filePath };
+		reader.ReadBytes(sizeof(BODY_FILE_MAGIC));
+		const Uint32 version{ reader.ReadUint32() };
+		if(version != BODY_FILE_VERSION)
+			throw InitException{ "Failed to load body file " + filePath + ": unsupported version " + std::to_string(version) };
+		const Uint32 numBodies{ reader.ReadCount(MIN_BODY_BYTES) };
+		for(Uint32 b = 0; b < numBodies; ++b)
+		{
+			const Uint32 nameBytes{ reader.ReadUint32() };
+			const char* name{ (const char*)reader.ReadBytes(nameBytes) };
+			if(nameBytes == 0)
+				throw InitException{ "Failed to load body file " + filePath + ": empty body name" };
+			Body& body{ AddParsedModel({ name, nameBytes }) };
+			body.sourceImageSize.x = reader.ReadFloat();
+			body.sourceImageSize.y = reader.ReadFloat();
+			const Uint32 numGroups{ reader.ReadCount(MIN_GROUP_BYTES) };
+			body.fixtureGroups.reserve(numGroups);
+			for(Uint32 g = 0; g < numGroups; ++g)
+			{
+				FixtureGroup& fixtureGroup{ body.fixtureGroups.emplace_back() };
+				const Uint8 groupType{ reader.ReadUint8() };
+				if(groupType != (Uint8)BodyFileGroupType::CIRCLE && groupType != (Uint8)BodyFileGroupType::POLYGON)
+					throw InitException{ "Failed to load body file " + filePath + ": unknown fixture group type " + std::to_string(groupType) };
+				fixtureGroup.isCircle = groupType == (Uint8)BodyFileGroupType::CIRCLE;
+				fixtureGroup.firstPolygon = (unsigned)body.polygons.size();
+				fixtureGroup.numPolygons = 0;
+				if(fixtureGroup.isCircle)
+				{
+					fixtureGroup.firstPolygon = 0;
+					fixtureGroup.circle.center.x = reader.ReadFloat();
+					fixtureGroup.circle.center.y = reader.ReadFloat();
+					fixtureGroup.circle.radiusRelativeToWidth = reader.ReadFloat();
+					continue;
+				}
+				fixtureGroup.numPolygons = reader.ReadCount(MIN_POLYGON_BYTES);
+				for(Uint32 p = 0; p < fixtureGroup.numPolygons; ++p)
+				{
+					PolygonShape& poly{ body.polygons.emplace_back() };
+					poly.numVertices = reader.ReadUint8();
+					if(poly.numVertices > maxPolygonVertices)
+						throw InitException{ "Failed to load body file " + filePath + ": polygon vertex limit exceeded" };
+					for(unsigned v = 0; v < poly.numVertices; ++v)
+					{
+						poly.vertices[v].x = reader.ReadFloat();
+						poly.vertices[v].y = reader.ReadFloat();
+					}
+				}
+			}
+		}
+		if(!reader.IsAtEnd())
+			throw InitException{ "Failed to load body file " + filePath + ": unexpected data after the last body" };
+		CommitParsedModels();
+	}
+	void ShapeFactory::SaveBinary(const std::string& filePath) const
+	{
+		std::vector<Uint8> data;
+		data.insert(data.end(), BODY_FILE_MAGIC, BODY_FILE_MAGIC + sizeof(BODY_FILE_MAGIC));
+		AppendUint32(data, BODY_FILE_VERSION);
+		AppendUint32(data, (Uint32)m_bodies.size());
+		for(ModelHandle model = 0; model < m_bodies.size(); ++model)
+		{
+			const Body& body{ m_bodies[model] };
+			const std::string& name{ m_modelNames[model] };
+			AppendUint32(data, (Uint32)name.size());
+			data.insert(data.end(), name.begin(), name.end());
+			AppendFloat(data, body.sourceImageSize.x);
+			AppendFloat(data, body.sourceImageSize.y);
+			AppendUint32(data, (Uint32)body.fixtureGroups.size());
+			for(const FixtureGroup& fixtureGroup : body.fixtureGroups)
+			{
+				if(fixtureGroup.isCircle)
+				{
+					data.push_back((Uint8)BodyFileGroupType::CIRCLE);
+					AppendFloat(data, fixtureGroup.circle.center.x);
+					AppendFloat(data, fixtureGroup.circle.center.y);
+					AppendFloat(data, fixtureGroup.circle.radiusRelativeToWidth);
+					continue;
+				}
+				data.push_back((Uint8)BodyFileGroupType::POLYGON);
+				AppendUint32(data, fixtureGroup.numPolygons);
+				for(unsigned p = 0; p < fixtureGroup.numPolygons; ++p)
+				{
+					const PolygonShape& poly{ body.polygons[fixtureGroup.firstPolygon + p] };
+					data.push_back((Uint8)poly.numVertices);
+					for(unsigned v = 0; v < poly.numVertices; ++v)
 					{
-						// fixture properties
-						FixtureGroup fixtureGroup;
-						std::string shapeType{ fixtureGroupNode.second.get<std::string>("<xmlattr>.type") };
-						SDL_assert_release(shapeType == "CIRCLE" || shapeType == "POLYGON");
-						if(shapeType == "CIRCLE")
-						{
-							// circle
-							fixtureGroup.isCircle = true;
-							auto const& circleNode{ fixtureGroupNode.second.get_child("circle") };
-
-							float radius{ circleNode.get<float>("<xmlattr>.r") };
-							SDL_assert_release(radius >= 0.0f);
-
-							float x{ circleNode.get<float>("<xmlattr>.x") };
-							float y{ circleNode.get<float>("<xmlattr>.y") };
-
-							fixtureGroup.circle.center.x = x / width;
-							fixtureGroup.circle.center.y = y / height;
-							fixtureGroup.circle.radiusRelativeToWidth = radius / width;
-						}
-						else
-						{
-							// polygons
-							fixtureGroup.isCircle = false;
-							for(auto const& polygonNode : fixtureGroupNode.second.get_child("polygons"))
-							{
-								if(polygonNode.first == "polygon")
-								{
-									PolygonShape poly;
-									poly.numVertices = 0;
-
-									// for each point
-									for(auto const& pointNode : polygonNode.second.get_child(""))
-									{
-										if(pointNode.first == "point")
-										{
-											float x{ pointNode.second.get<float>("<xmlattr>.x") };
-											float y{ pointNode.second.get<float>("<xmlattr>.y") };
-											poly.vertices[poly.numVertices].Set(x / width, y / height);
-											++poly.numVertices;
-											SDL_assert_release(poly.numVertices <= maxPolygonVertices);
-										}
-									}
-									fixtureGroup.polygons.push_back(poly);
-								}
-							}
-						}
-						m_bodyMap[bodyName].fixtureGroups.push_back(fixtureGroup);
+						AppendFloat(data, poly.vertices[v].x);
+						AppendFloat(data, poly.vertices[v].y);
 					}
 				}
 			}
 		}
+		std::ofstream outStream{ filePath, std::ios::binary };
+		if(!outStream.write((const char*)data.data(), (std::streamsize)data.size()))
+			throw InitException{ "Failed to write body file: " + filePath };
 	}
 
 	b2Fixture* ShapeFactory::AddCircleShape(b2Body& bodyRef, float size,
@@ -142,48 +547,208 @@ namespace d2d
 		const std::string& modelName, const Material& material, const Filter& filter,
 		bool isSensor, const b2Vec2& position, float angle)
 	{
-		auto bodyIterator = m_bodyMap.find(modelName);
-		if (bodyIterator == m_bodyMap.end())
+		return AddShapes(b2BodyRef, size, GetModelHandle(modelName), material, filter, isSensor, position, angle);
+	}
+	std::vector<b2Fixture*> ShapeFactory::AddShapes(b2Body& b2BodyRef, const b2Vec2& size,
+		ModelHandle model, const Material& material, const Filter& filter,
+		bool isSensor, const b2Vec2& position, float angle)
+	{
+		const ShapeSet& shapeSet{ GetShapeSet(model, { size, position, angle }) };
+		b2FixtureDef fixtureDef;
+		fixtureDef.density = material.density;
+		fixtureDef.friction = material.friction;
+		fixtureDef.restitution = material.restitution;
+		fixtureDef.filter = filter.filter;
+		fixtureDef.isSensor = isSensor;
+		std::vector<b2Fixture*> fixturePtrList;
+		fixturePtrList.reserve(shapeSet.shapes.size());
+		for(const b2Shape* shapePtr : shapeSet.shapes)
+		{
+			// CreateFixture clones the shape, so the cached one stays untouched
+			fixtureDef.shape = shapePtr;
+			fixturePtrList.push_back(b2BodyRef.CreateFixture(&fixtureDef));
+		}
+		return fixturePtrList;
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			Batch spawning		   |
+	//\--------------------------------/--------------------------------------
+	size_t ShapeFactory::GetFixtureCount(ModelHandle model) const
+	{
+		const Body& body{ GetModel(model) };
+		return body.polygons.size() + (size_t)std::count_if(body.fixtureGroups.begin(), body.fixtureGroups.end(),
+			[](const FixtureGroup& fixtureGroup) { return fixtureGroup.isCircle; });
+	}
+	void ShapeFactory::SpawnBodies(b2World& world, const b2BodyDef& bodyDef, ModelHandle model, const b2Vec2& size,
+		const Material& material, const Filter& filter, std::span<const BodySpawn> spawns,
+		std::span<b2Body*> bodiesOut, std::span<b2Fixture*> fixturesOut, bool isSensor)
+	{
+		const ShapeSet& shapeSet{ GetShapeSet(model, { size, b2Vec2_zero, 0.0f }) };
+		const size_t numFixtures{ shapeSet.shapes.size() };
+		d2AssertRelease(bodiesOut.empty() || bodiesOut.size() >= spawns.size());
+		d2AssertRelease(fixturesOut.empty() || fixturesOut.size() >= spawns.size() * numFixtures);
+
+		// Fixtures are created massless, so the body works out its mass once
+		//	at the end instead of again after every fixture
+		const bool setDensityLater{ material.density > 0.0f };
+		b2FixtureDef fixtureDef;
+		fixtureDef.density = setDensityLater ? 0.0f : material.density;
+		fixtureDef.friction = material.friction;
+		fixtureDef.restitution = material.restitution;
+		fixtureDef.filter = filter.filter;
+		fixtureDef.isSensor = isSensor;
+
+		b2BodyDef instanceDef{ bodyDef };
+		for(size_t i = 0; i < spawns.size(); ++i)
+		{
+			const BodySpawn& spawn{ spawns[i] };
+			instanceDef.position = spawn.position;
+			instanceDef.angle = spawn.angle;
+			instanceDef.linearVelocity = spawn.linearVelocity;
+			instanceDef.angularVelocity = spawn.angularVelocity;
+			b2Body* bodyPtr{ world.CreateBody(&instanceDef) };
+			for(size_t j = 0; j < numFixtures; ++j)
+			{
+				fixtureDef.shape = shapeSet.shapes[j];
+				b2Fixture* fixturePtr{ bodyPtr->CreateFixture(&fixtureDef) };
+				if(setDensityLater)
+					fixturePtr->SetDensity(material.density);
+				if(!fixturesOut.empty())
+					fixturesOut[i * numFixtures + j] = fixturePtr;
+			}
+			if(setDensityLater)
+				bodyPtr->ResetMassData();
+			if(!bodiesOut.empty())
+				bodiesOut[i] = bodyPtr;
+		}
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|				Models			   |
+	//\--------------------------------/--------------------------------------
+	ModelHandle ShapeFactory::GetModelHandle(const std::string& modelName) const
+	{
+		auto handleIterator{ m_modelHandles.find(modelName) };
+		if(handleIterator == m_modelHandles.end())
 			throw InitException{ "Failed to get body definition: " + modelName };
+		return handleIterator->second;
+	}
+	bool ShapeFactory::HasModel(const std::string& modelName) const
+	{
+		return m_modelHandles.contains(modelName);
+	}
+	const Body& ShapeFactory::GetModel(ModelHandle model) const
+	{
+		d2AssertRelease(model < m_bodies.size());
+		return m_bodies[model];
+	}
+	size_t ShapeFactory::GetModelCount() const
+	{
+		return m_bodies.size();
+	}
 
-		std::vector<b2Fixture*> fixturePtrList;
-		b2Transform localTransform{ position, b2Rot{ angle } };
-		for (auto& fixtureGroup : bodyIterator->second.fixtureGroups)
-		{
-			b2FixtureDef fixtureDef;
-			fixtureDef.density = material.density;
-			fixtureDef.friction = material.friction;
-			fixtureDef.restitution = material.restitution;
-			fixtureDef.filter = filter.filter;
-			fixtureDef.isSensor = isSensor;
-			if (fixtureGroup.isCircle)
-			{
-				b2CircleShape circleShape;
-				circleShape.m_p = fixtureGroup.circle.center * size;
-				circleShape.m_radius = fixtureGroup.circle.radiusRelativeToWidth * size.x;
-				fixtureDef.shape = &circleShape;
-				fixturePtrList.push_back(b2BodyRef.CreateFixture(&fixtureDef));
+	//+--------------------------------\--------------------------------------
+	//|			 Shape cache		   |
+	//\--------------------------------/--------------------------------------
+	bool ShapeFactory::ShapeCacheKey::operator<(const ShapeCacheKey& other) const
+	{
+		return std::tie(size.x, size.y, position.x, position.y, angle)
+			< std::tie(other.size.x, other.size.y, other.position.x, other.position.y, other.angle);
+	}
+	// The returned set is valid until the next call
+	const ShapeFactory::ShapeSet& ShapeFactory::GetShapeSet(ModelHandle model, const ShapeCacheKey& key)
+	{
+		// A NaN would break the map's ordering
+		d2AssertRelease(std::isfinite(key.size.x) && std::isfinite(key.size.y)
+			&& std::isfinite(key.position.x) && std::isfinite(key.position.y) && std::isfinite(key.angle));
+		const Body& body{ GetModel(model) };
+		std::map<ShapeCacheKey, ShapeSet>& modelCache{ m_shapeCache[model] };
+		auto shapeSetIterator{ modelCache.find(key) };
+		if(shapeSetIterator != modelCache.end())
+		{
+			++m_shapeCacheStats.hits;
+			return shapeSetIterator->second;
+		}
+		++m_shapeCacheStats.misses;
+		if(m_shapeCacheStats.entries >= m_shapeCacheCapacity)
+		{
+			for(auto& cache : m_shapeCache)
+				cache.clear();
+			m_shapeCacheStats.entries = 0;
+			++m_shapeCacheStats.flushes;
+		}
+		shapeSetIterator = modelCache.try_emplace(key).first;
+		try
+		{
+			BuildShapes(body, key, shapeSetIterator->second);
+		}
+		catch(...)
+		{
+			modelCache.erase(shapeSetIterator);
+			throw;
+		}
+		++m_shapeCacheStats.entries;
+		return shapeSetIterator->second;
+	}
+	void ShapeFactory::BuildShapes(const Body& body, const ShapeCacheKey& key, ShapeSet& shapeSetOut) const
+	{
+		shapeSetOut.circles.clear();
+		shapeSetOut.polygons.clear();
+		shapeSetOut.shapes.clear();
+
+		// Reserve first so the pointers in shapes stay valid
+		const size_t numCircles{ (size_t)std::count_if(body.fixtureGroups.begin(), body.fixtureGroups.end(),
+			[](const FixtureGroup& fixtureGroup) { return fixtureGroup.isCircle; }) };
+		shapeSetOut.circles.reserve(numCircles);
+		shapeSetOut.polygons.reserve(body.polygons.size());
+		shapeSetOut.shapes.reserve(numCircles + body.polygons.size());
+
+		b2Transform localTransform{ key.position, b2Rot{ key.angle } };
+		for(const FixtureGroup& fixtureGroup : body.fixtureGroups)
+		{
+			if(fixtureGroup.isCircle)
+			{
+				b2CircleShape& circleShape{ shapeSetOut.circles.emplace_back() };
+				circleShape.m_p = fixtureGroup.circle.center * key.size;
+				circleShape.m_radius = fixtureGroup.circle.radiusRelativeToWidth * key.size.x;
+				shapeSetOut.shapes.push_back(&circleShape);
 			}
 			else
 			{
-				for (auto& polygon : fixtureGroup.polygons)
+				const PolygonShape* polygons{ body.polygons.data() + fixtureGroup.firstPolygon };
+				for(const PolygonShape& polygon : std::span{ polygons, fixtureGroup.numPolygons })
 				{
 					b2Vec2 vertices[maxPolygonVertices];
 					unsigned numVertices{ polygon.numVertices };
 
-					if (numVertices > maxPolygonVertices)
+					if(numVertices > maxPolygonVertices)
 						throw InitException{ "Polygon vertex limit exceeded" };
 
-					for(unsigned i = 0; i < polygon.numVertices; ++i)
-						vertices[i] = b2Mul(localTransform, polygon.vertices[i] * size);
+					for(unsigned i = 0; i < numVertices; ++i)
+						vertices[i] = b2Mul(localTransform, polygon.vertices[i] * key.size);
 
-					b2PolygonShape polygonShape;
-					polygonShape.Set(vertices, polygon.numVertices);
-					fixtureDef.shape = &polygonShape;
-					fixturePtrList.push_back(b2BodyRef.CreateFixture(&fixtureDef));
+					b2PolygonShape& polygonShape{ shapeSetOut.polygons.emplace_back() };
+					polygonShape.Set(vertices, numVertices);
+					shapeSetOut.shapes.push_back(&polygonShape);
 				}
 			}
 		}
-		return fixturePtrList;
+	}
+
+	void ShapeFactory::SetShapeCacheCapacity(size_t capacity)
+	{
+		d2AssertRelease(capacity > 0);
+		m_shapeCacheCapacity = capacity;
+	}
+	void ShapeFactory::ClearShapeCache()
+	{
+		for(auto& modelCache : m_shapeCache)
+			modelCache.clear();
+		m_shapeCacheStats = ShapeCacheStats{};
+	}
+	const ShapeCacheStats& ShapeFactory::GetShapeCacheStats() const
+	{
+		return m_shapeCacheStats;
 	}
 }
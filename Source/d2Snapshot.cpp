@@ -0,0 +1,292 @@
+/**************************************************************************************\
+** File: d2Snapshot.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Source code file for delta-compressed world snapshot replication
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Snapshot.h"
+#include "d2Serialize.h"
+#include "d2Utility.h"
+namespace d2d
+{
+	namespace
+	{
+		const unsigned SEQUENCE_BITS{ 32 };
+		const unsigned SLOT_COUNT_BITS{ 20 };
+		const unsigned SMALL_DELTA_BITS{ 8 };
+		const Sint64 SMALL_DELTA_LIMIT{ 1 << (SMALL_DELTA_BITS - 1) };
+
+		std::array<unsigned, NUM_SNAPSHOT_FIELDS> GetFieldBits(const SnapshotDef& def)
+		{
+			return { def.positionBits, def.positionBits, def.angleBits,
+				def.velocityBits, def.velocityBits, def.angularVelocityBits };
+		}
+		QuantizedEntityState Quantize(const EntityState& state, const SnapshotDef& def)
+		{
+			const Range<float> xRange{ def.worldBounds.lowerBound.x, def.worldBounds.upperBound.x };
+			const Range<float> yRange{ def.worldBounds.lowerBound.y, def.worldBounds.upperBound.y };
+			QuantizedEntityState quantized;
+			quantized.present = true;
+			quantized.fields = {
+				QuantizeFloat(state.position.x, xRange, def.positionBits),
+				QuantizeFloat(state.position.y, yRange, def.positionBits),
+				QuantizeAngle(state.angle, def.angleBits),
+				QuantizeFloat(state.velocity.x, def.velocityRange, def.velocityBits),
+				QuantizeFloat(state.velocity.y, def.velocityRange, def.velocityBits),
+				QuantizeFloat(state.angularVelocity, def.angularVelocityRange, def.angularVelocityBits) };
+			return quantized;
+		}
+		EntityState Dequantize(const QuantizedEntityState& quantized, const SnapshotDef& def)
+		{
+			const Range<float> xRange{ def.worldBounds.lowerBound.x, def.worldBounds.upperBound.x };
+			const Range<float> yRange{ def.worldBounds.lowerBound.y, def.worldBounds.upperBound.y };
+			const auto& fields{ quantized.fields };
+			EntityState state;
+			state.position.x = DequantizeFloat(fields[(unsigned)SnapshotField::POSITION_X], xRange, def.positionBits);
+			state.position.y = DequantizeFloat(fields[(unsigned)SnapshotField::POSITION_Y], yRange, def.positionBits);
+			state.angle = DequantizeAngle(fields[(unsigned)SnapshotField::ANGLE], def.angleBits);
+			state.velocity.x = DequantizeFloat(fields[(unsigned)SnapshotField::VELOCITY_X], def.velocityRange, def.velocityBits);
+			state.velocity.y = DequantizeFloat(fields[(unsigned)SnapshotField::VELOCITY_Y], def.velocityRange, def.velocityBits);
+			state.angularVelocity = DequantizeFloat(fields[(unsigned)SnapshotField::ANGULAR_VELOCITY],
+				def.angularVelocityRange, def.angularVelocityBits);
+			return state;
+		}
+
+		// A field is a 1-bit flag, then either a small signed delta or the full value
+		void WriteField(BitWriter& writer, Uint32 value, Uint32 baseline, unsigned numBits)
+		{
+			const Sint64 delta{ (Sint64)value - (Sint64)baseline };
+			const bool small{ delta >= -SMALL_DELTA_LIMIT && delta < SMALL_DELTA_LIMIT };
+			writer.WriteBool(small);
+			if(small)
+				writer.WriteBits((Uint32)(delta + SMALL_DELTA_LIMIT), SMALL_DELTA_BITS);
+			else
+				writer.WriteBits(value, numBits);
+		}
+		Uint32 ReadField(BitReader& reader, Uint32 baseline, unsigned numBits)
+		{
+			if(reader.ReadBool())
+				return (Uint32)((Sint64)baseline + (Sint64)reader.ReadBits(SMALL_DELTA_BITS) - SMALL_DELTA_LIMIT);
+			return reader.ReadBits(numBits);
+		}
+		const QuantizedEntityState& GetSlot(const Snapshot* snapshotPtr, unsigned slot)
+		{
+			static const QuantizedEntityState absent;
+			if(!snapshotPtr || slot >= snapshotPtr->slots.size())
+				return absent;
+			return snapshotPtr->slots[slot];
+		}
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			SnapshotServer		   |
+	//\--------------------------------/--------------------------------------
+	SnapshotServer::SnapshotServer(const SnapshotDef& def)
+		: m_def{ def }
+	{
+		d2Assert(m_def.historySize > 0);
+		m_history.resize(m_def.historySize);
+	}
+	void SnapshotServer::SetEntity(unsigned slot, const EntityState& state)
+	{
+		if(slot >= m_entityStates.size())
+		{
+			m_entityStates.resize(slot + 1);
+			m_entityPresent.resize(slot + 1, false);
+		}
+		m_entityStates[slot] = state;
+		m_entityPresent[slot] = true;
+	}
+	void SnapshotServer::RemoveEntity(unsigned slot)
+	{
+		if(slot < m_entityPresent.size())
+			m_entityPresent[slot] = false;
+	}
+	void SnapshotServer::ClearEntities()
+	{
+		m_entityStates.clear();
+		m_entityPresent.clear();
+	}
+	Uint32 SnapshotServer::Capture()
+	{
+		d2Assert(m_entityStates.size() < (1u << SLOT_COUNT_BITS));
+		++m_latestSequence;
+		Snapshot& snapshot{ m_history[m_latestSequence % m_history.size()] };
+		snapshot.sequence = m_latestSequence;
+		snapshot.slots.resize(m_entityStates.size());
+		for(unsigned i = 0; i < m_entityStates.size(); ++i)
+			snapshot.slots[i] = m_entityPresent[i] ? Quantize(m_entityStates[i], m_def) : QuantizedEntityState{};
+		return m_latestSequence;
+	}
+	void SnapshotServer::AddClient(ConnectionID id)
+	{
+		if(id >= m_clientActive.size())
+		{
+			m_clientActive.resize(id + 1, false);
+			m_ackedSequences.resize(id + 1, 0);
+			m_sentSequences.resize((id + 1) * m_history.size(), 0);
+		}
+		m_clientActive[id] = true;
+		m_ackedSequences[id] = 0;
+		std::fill_n(m_sentSequences.begin() + id * m_history.size(), m_history.size(), 0);
+	}
+	void SnapshotServer::RemoveClient(ConnectionID id)
+	{
+		if(id < m_clientActive.size())
+			m_clientActive[id] = false;
+	}
+	const Snapshot* SnapshotServer::FindSnapshot(Uint32 sequence) const
+	{
+		if(sequence == 0 || m_latestSequence - sequence >= m_history.size())
+			return nullptr;
+		const Snapshot& snapshot{ m_history[sequence % m_history.size()] };
+		return snapshot.sequence == sequence ? &snapshot : nullptr;
+	}
+	void SnapshotServer::WriteSnapshot(ConnectionID id, NetworkMessage& message)
+	{
+		d2Assert(id < m_clientActive.size() && m_clientActive[id]);
+		const Snapshot* currentPtr{ FindSnapshot(m_latestSequence) };
+		d2AssertRelease(currentPtr && "Capture must be called before WriteSnapshot");
+		const Snapshot* baselinePtr{ FindSnapshot(m_ackedSequences[id]) };
+		const std::array<unsigned, NUM_SNAPSHOT_FIELDS> fieldBits{ GetFieldBits(m_def) };
+		m_sentSequences[id * m_history.size() + currentPtr->sequence % m_history.size()] = currentPtr->sequence;
+
+		message.Clear();
+		BitWriter writer{ message.GetBuffer() };
+		writer.WriteBits(currentPtr->sequence, SEQUENCE_BITS);
+		writer.WriteBits(baselinePtr ? baselinePtr->sequence : 0, SEQUENCE_BITS);
+		writer.WriteBits((Uint32)currentPtr->slots.size(), SLOT_COUNT_BITS);
+		for(unsigned slot = 0; slot < currentPtr->slots.size(); ++slot)
+		{
+			const QuantizedEntityState& current{ currentPtr->slots[slot] };
+			const QuantizedEntityState& baseline{ GetSlot(baselinePtr, slot) };
+			Uint32 changedMask{ 0 };
+			if(current.present)
+				for(unsigned field = 0; field < NUM_SNAPSHOT_FIELDS; ++field)
+					if(!baseline.present || current.fields[field] != baseline.fields[field])
+						changedMask |= 1u << field;
+			const bool changed{ current.present != baseline.present || changedMask };
+			writer.WriteBool(changed);
+			if(!changed)
+				continue;
+			writer.WriteBool(current.present);
+			if(!current.present)
+				continue;
+			writer.WriteBits(changedMask, NUM_SNAPSHOT_FIELDS);
+			for(unsigned field = 0; field < NUM_SNAPSHOT_FIELDS; ++field)
+				if(changedMask & (1u << field))
+					WriteField(writer, current.fields[field], baseline.fields[field], fieldBits[field]);
+		}
+		writer.Finish();
+	}
+	bool SnapshotServer::ReadAck(ConnectionID id, const NetworkMessage& message)
+	{
+		// An ack is exactly one sequence number; anything else is not an ack
+		if(id >= m_clientActive.size() || !m_clientActive[id] || message.GetSize() != SEQUENCE_BITS / 8)
+			return false;
+		BitReader reader{ message.GetPayload() };
+		Uint32 sequence{ reader.ReadBits(SEQUENCE_BITS) };
+
+		// Acks can only move forward, and only to snapshots that were sent
+		//	to this client and are still in the history to delta against
+		if(sequence > m_ackedSequences[id] && FindSnapshot(sequence)
+			&& m_sentSequences[id * m_history.size() + sequence % m_history.size()] == sequence)
+			m_ackedSequences[id] = sequence;
+		return true;
+	}
+	Uint32 SnapshotServer::GetAckedSequence(ConnectionID id) const
+	{
+		return id < m_ackedSequences.size() ? m_ackedSequences[id] : 0;
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			SnapshotClient		   |
+	//\--------------------------------/--------------------------------------
+	SnapshotClient::SnapshotClient(const SnapshotDef& def)
+		: m_def{ def }
+	{
+		d2Assert(m_def.historySize > 0);
+		m_history.resize(m_def.historySize);
+	}
+	bool SnapshotClient::ReadSnapshot(const NetworkMessage& message)
+	{
+		BitReader reader{ message.GetPayload() };
+		const Uint32 sequence{ reader.ReadBits(SEQUENCE_BITS) };
+		const Uint32 baselineSequence{ reader.ReadBits(SEQUENCE_BITS) };
+		const unsigned numSlots{ reader.ReadBits(SLOT_COUNT_BITS) };
+		if(sequence <= m_latestSequence)
+			return false;
+
+		const Snapshot* baselinePtr{ nullptr };
+		if(baselineSequence != 0)
+		{
+			const Snapshot& baseline{ m_history[baselineSequence % m_history.size()] };
+			if(baseline.sequence != baselineSequence || sequence - baselineSequence >= m_history.size())
+				throw SerializationException{ "Snapshot baseline not available: "s + std::to_string(baselineSequence) };
+			baselinePtr = &baseline;
+		}
+		const std::array<unsigned, NUM_SNAPSHOT_FIELDS> fieldBits{ GetFieldBits(m_def) };
+
+		// Decode into scratch space so a malformed message leaves the history intact
+		Snapshot& decoded{ m_decoded };
+		decoded.sequence = sequence;
+		decoded.slots.resize(numSlots);
+		for(unsigned slot = 0; slot < numSlots; ++slot)
+		{
+			const QuantizedEntityState& baseline{ GetSlot(baselinePtr, slot) };
+			QuantizedEntityState& current{ decoded.slots[slot] };
+			if(!reader.ReadBool())
+			{
+				current = baseline;
+				continue;
+			}
+			// Absent slots must match the server's zeroed fields for later deltas
+			current = QuantizedEntityState{};
+			current.present = reader.ReadBool();
+			if(!current.present)
+				continue;
+			const Uint32 changedMask{ reader.ReadBits(NUM_SNAPSHOT_FIELDS) };
+			for(unsigned field = 0; field < NUM_SNAPSHOT_FIELDS; ++field)
+			{
+				if(changedMask & (1u << field))
+					current.fields[field] = ReadField(reader, baseline.fields[field], fieldBits[field]);
+				else
+					current.fields[field] = baseline.fields[field];
+			}
+		}
+		std::swap(m_history[sequence % m_history.size()], decoded);
+		m_latestSequence = sequence;
+		return true;
+	}
+	void SnapshotClient::WriteAck(NetworkMessage& message) const
+	{
+		message.Clear();
+		BitWriter writer{ message.GetBuffer() };
+		writer.WriteBits(m_latestSequence, SEQUENCE_BITS);
+		writer.Finish();
+	}
+	Uint32 SnapshotClient::GetLatestSequence() const
+	{
+		return m_latestSequence;
+	}
+	unsigned SnapshotClient::GetSlotCount() const
+	{
+		if(m_latestSequence == 0)
+			return 0;
+		return (unsigned)m_history[m_latestSequence % m_history.size()].slots.size();
+	}
+	bool SnapshotClient::GetEntity(unsigned slot, EntityState& stateOut) const
+	{
+		if(m_latestSequence == 0)
+			return false;
+		const QuantizedEntityState& quantized{ GetSlot(&m_history[m_latestSequence % m_history.size()], slot) };
+		if(!quantized.present)
+			return false;
+		stateOut = Dequantize(quantized, m_def);
+		return true;
+	}
+}
@@ -9,6 +9,7 @@
 \**************************************************************************************/
 #include "d2pch.h"
 #include "d2Text.h"
+#include "d2Vfs.h"
 namespace d2d
 {
     namespace
@@ -29,7 +30,10 @@ namespace d2d
                 if (filePaths.size() < 1)
                     throw InitException{"FontResource requires one filePath"s};
 
-                m_dtxFontPtr = dtx_open_font(filePaths[0].c_str(), DTX_FONT_SIZE);
+                // FreeType reads the font from memory for as long as it is open, so m_fontFile is kept
+                m_fontFile = OpenFile(filePaths[0]);
+                m_dtxFontPtr = dtx_open_font_mem(const_cast<Uint8*>(m_fontFile.GetBytes().data()),
+                    (int)m_fontFile.GetBytes().size(), DTX_FONT_SIZE);
                 if (!m_dtxFontPtr)
                     throw InitException{"Failed to open font: "s + filePaths[0]};
             }
@@ -44,6 +48,7 @@ namespace d2d
             }
 
         private:
+            VfsFile m_fontFile;
             struct dtx_font *m_dtxFontPtr{nullptr};
         };
     }
@@ -11,6 +11,7 @@
 #include "d2Texture.h"
 #include "d2Window.h"
 #include "d2Utility.h"
+#include "d2Vfs.h"
 namespace d2d
 {
     namespace
@@ -116,8 +117,11 @@ namespace d2d
                 if (filePaths.size() < 1)
                     throw InitException{ "SpriteResource requires one filePath"s };
 
-                // Load texture from file
-                SDL_Surface* surfacePtr{ IMG_Load(filePaths[0].c_str()) };
+                // Load texture from file, passing the extension as IMG_Load would
+                const VfsFile imageFile{ OpenFile(filePaths[0]) };
+                const std::string extension{ std::filesystem::path{ filePaths[0] }.extension().string() };
+                SDL_Surface* surfacePtr{ IMG_LoadTyped_RW(imageFile.GetRWops(), 1,
+                    extension.empty() ? nullptr : extension.c_str() + 1) };
                 if(!surfacePtr)
                     throw InitException{ "SDL_image failed to load file "s + filePaths[0] };
 
@@ -160,7 +164,11 @@ namespace d2d
 
                 // Load atlas data
                 boost::property_tree::ptree data;
-                boost::property_tree::read_xml(m_xmlPath, data);
+                {
+                    const VfsFile xmlFile{ OpenFile(m_xmlPath) };
+                    MemoryInputStream xmlStream{ xmlFile.GetText() };
+                    boost::property_tree::read_xml(xmlStream, data);
+                }
 
                 int atlasWidth{data.get<int>("TextureAtlas.<xmlattr>.width")};
                 int atlasHeight{data.get<int>("TextureAtlas.<xmlattr>.height")};
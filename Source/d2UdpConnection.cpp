@@ -0,0 +1,431 @@
+/**************************************************************************************\
+** File: d2UdpConnection.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Source code file for the UdpConnection reliability layer and SimulatedLink
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2UdpConnection.h"
+#include "d2Utility.h"
+namespace d2d
+{
+	namespace
+	{
+		const size_t PACKET_HEADER_BYTES{ 9 };
+		const size_t MESSAGE_HEADER_BYTES{ 3 };
+		const size_t RELIABLE_ID_BYTES{ 2 };
+		const unsigned SENT_PACKET_HISTORY{ 1024 };
+		static_assert(std::has_single_bit(SENT_PACKET_HISTORY), "Packet sequences must keep their slot across wraparound");
+		const Uint8 PACKET_HAS_ACK{ 0x01 };
+		const float ROUND_TRIP_SMOOTHING{ 0.1f };
+
+		// All multi-byte values are little-endian
+		void Write16(std::vector<Uint8>& out, Uint16 value)
+		{
+			out.push_back((Uint8)value);
+			out.push_back((Uint8)(value >> 8));
+		}
+		void Write32(std::vector<Uint8>& out, Uint32 value)
+		{
+			Write16(out, (Uint16)value);
+			Write16(out, (Uint16)(value >> 16));
+		}
+		Uint16 Read16(const Uint8* data)
+		{
+			return (Uint16)(data[0] | (data[1] << 8));
+		}
+		Uint32 Read32(const Uint8* data)
+		{
+			return (Uint32)Read16(data) | ((Uint32)Read16(data + 2) << 16);
+		}
+
+		// True if a is newer than b, allowing for wraparound
+		bool IsSequenceNewer(Uint16 a, Uint16 b)
+		{
+			return a != b && (Uint16)(a - b) < 0x8000;
+		}
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			UdpConnection		   |
+	//\--------------------------------/--------------------------------------
+	UdpConnection::UdpConnection(DatagramTransport& transport, const IpAddress& peer, const UdpConnectionDef& def)
+		: m_transport{ transport },
+		  m_peer{ peer },
+		  m_def{ def }
+	{
+		d2AssertRelease(m_def.reliableWindowSize > 0 && m_def.reliableWindowSize <= 0x8000);
+		d2Assert(m_def.mtuBytes > PACKET_HEADER_BYTES + MESSAGE_HEADER_BYTES + RELIABLE_ID_BYTES);
+		m_def.reliableWindowSize = std::bit_ceil(m_def.reliableWindowSize);
+		m_reliableWindowMask = (Uint16)(m_def.reliableWindowSize - 1);
+		m_sentPackets.resize(SENT_PACKET_HISTORY);
+		m_sendWindow.resize(m_def.reliableWindowSize);
+		m_receiveWindow.resize(m_def.reliableWindowSize);
+	}
+	void UdpConnection::Queue(const NetworkMessage& message, UdpChannel channel)
+	{
+		Queue(message.GetPayload(), channel);
+	}
+	void UdpConnection::Queue(std::span<const Uint8> payload, UdpChannel channel)
+	{
+		const size_t maxPayloadBytes{ m_def.mtuBytes - PACKET_HEADER_BYTES - MESSAGE_HEADER_BYTES - RELIABLE_ID_BYTES };
+		if(payload.size() > maxPayloadBytes)
+			throw NetworkException{ "UDP message does not fit in one packet: "s + std::to_string(payload.size()) };
+
+		if(channel == UdpChannel::RELIABLE_ORDERED)
+		{
+			if(IsReliableWindowFull())
+				throw NetworkException{ "Reliable send window is full"s };
+			ReliableMessage& message{ m_sendWindow[m_nextReliableID & m_reliableWindowMask] };
+			message.inUse = true;
+			message.everSent = false;
+			message.id = m_nextReliableID++;
+			message.payload.assign(payload.begin(), payload.end());
+		}
+		else
+		{
+			// Queue entries keep their capacity between flushes
+			if(m_numUnreliableQueued == m_unreliableQueue.size())
+				m_unreliableQueue.emplace_back();
+			m_unreliableQueue[m_numUnreliableQueued++].assign(payload.begin(), payload.end());
+		}
+	}
+	void UdpConnection::Update(Uint32 nowMilliseconds)
+	{
+		IpAddress source;
+		while(m_transport.Receive(m_datagram, source))
+			if(source == m_peer)
+				ProcessPacket(m_datagram, nowMilliseconds);
+		Flush(nowMilliseconds);
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			   Sending			   |
+	//\--------------------------------/--------------------------------------
+	void UdpConnection::Flush(Uint32 nowMilliseconds)
+	{
+		StartPacket();
+		auto appendMessage = [&](UdpChannel channel, const ReliableMessage* reliablePtr, const std::vector<Uint8>& payload)
+		{
+			size_t messageBytes{ MESSAGE_HEADER_BYTES + payload.size() + (reliablePtr ? RELIABLE_ID_BYTES : 0) };
+			if(m_packet.size() + messageBytes > m_def.mtuBytes)
+			{
+				SendPacket(nowMilliseconds);
+				StartPacket();
+			}
+			m_packet.push_back((Uint8)channel);
+			Write16(m_packet, (Uint16)payload.size());
+			if(reliablePtr)
+			{
+				Write16(m_packet, reliablePtr->id);
+				m_packetReliableIDs.push_back(reliablePtr->id);
+			}
+			m_packet.insert(m_packet.end(), payload.begin(), payload.end());
+			++m_stats.messagesSent;
+		};
+
+		// Reliable messages that were never sent or are due for a resend, oldest first
+		for(Uint16 id = m_oldestUnackedID; id != m_nextReliableID; ++id)
+		{
+			ReliableMessage& message{ m_sendWindow[id & m_reliableWindowMask] };
+			if(!message.inUse)
+				continue;
+			if(message.everSent)
+			{
+				if(nowMilliseconds - message.lastSendTime < m_def.resendMilliseconds)
+					continue;
+				++m_stats.reliableResends;
+			}
+			appendMessage(UdpChannel::RELIABLE_ORDERED, &message, message.payload);
+			message.everSent = true;
+			message.lastSendTime = nowMilliseconds;
+		}
+		for(size_t i = 0; i < m_numUnreliableQueued; ++i)
+			appendMessage(UdpChannel::UNRELIABLE, nullptr, m_unreliableQueue[i]);
+		m_numUnreliableQueued = 0;
+
+		if(m_packet.size() > PACKET_HEADER_BYTES || m_ackPending)
+			SendPacket(nowMilliseconds);
+	}
+	void UdpConnection::StartPacket()
+	{
+		m_packet.clear();
+		m_packetReliableIDs.clear();
+		Write16(m_packet, m_nextSequence);
+		Write16(m_packet, m_remoteSequence);
+		Write32(m_packet, m_remoteAckBits);
+		m_packet.push_back(m_receivedAny ? PACKET_HAS_ACK : 0);
+	}
+	void UdpConnection::SendPacket(Uint32 nowMilliseconds)
+	{
+		SentPacket& sentPacket{ m_sentPackets[m_nextSequence % m_sentPackets.size()] };
+		if(sentPacket.inUse && !sentPacket.acked)
+			++m_stats.packetsLost;
+		sentPacket.inUse = m_packet.size() > PACKET_HEADER_BYTES;
+		sentPacket.acked = false;
+		sentPacket.sequence = m_nextSequence;
+		sentPacket.sendTime = nowMilliseconds;
+		sentPacket.reliableIDs.swap(m_packetReliableIDs);
+		m_packetReliableIDs.clear();
+
+		m_transport.Send(m_peer, m_packet);
+		++m_nextSequence;
+		++m_stats.packetsSent;
+		m_ackPending = false;
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			  Receiving			   |
+	//\--------------------------------/--------------------------------------
+	void UdpConnection::ProcessPacket(std::span<const Uint8> packet, Uint32 nowMilliseconds)
+	{
+		if(packet.size() < PACKET_HEADER_BYTES)
+		{
+			++m_stats.packetsDropped;
+			return;
+		}
+		const Uint8* data{ packet.data() };
+		const Uint16 sequence{ Read16(data) };
+		const Uint16 ack{ Read16(data + 2) };
+		const Uint32 ackBits{ Read32(data + 4) };
+		const Uint8 flags{ data[8] };
+
+		// Record the sequence for our acks, rejecting duplicates and stale packets
+		if(!m_receivedAny)
+		{
+			m_receivedAny = true;
+			m_remoteSequence = sequence;
+			m_remoteAckBits = 0;
+		}
+		else if(IsSequenceNewer(sequence, m_remoteSequence))
+		{
+			const unsigned shift{ (Uint16)(sequence - m_remoteSequence) };
+			m_remoteAckBits = shift >= 32 ? 0 : m_remoteAckBits << shift;
+			if(shift <= 32)
+				m_remoteAckBits |= 1u << (shift - 1);
+			m_remoteSequence = sequence;
+		}
+		else
+		{
+			const unsigned age{ (Uint16)(m_remoteSequence - sequence) };
+			const Uint32 bit{ age >= 1 && age <= 32 ? 1u << (age - 1) : 0 };
+			if(!bit || (m_remoteAckBits & bit))
+			{
+				++m_stats.packetsDropped;
+				return;
+			}
+			m_remoteAckBits |= bit;
+		}
+		++m_stats.packetsReceived;
+
+		// Ack-only packets are not acked back, or two idle peers would trade them forever
+		if(packet.size() > PACKET_HEADER_BYTES)
+			m_ackPending = true;
+
+		if(flags & PACKET_HAS_ACK)
+		{
+			ProcessAck(ack, nowMilliseconds);
+			for(unsigned n = 0; n < 32; ++n)
+				if(ackBits & (1u << n))
+					ProcessAck((Uint16)(ack - 1 - n), nowMilliseconds);
+		}
+		if(!ProcessMessages(data + PACKET_HEADER_BYTES, packet.size() - PACKET_HEADER_BYTES))
+			++m_stats.packetsDropped;
+	}
+	void UdpConnection::ProcessAck(Uint16 sequence, Uint32 nowMilliseconds)
+	{
+		SentPacket& sentPacket{ m_sentPackets[sequence % m_sentPackets.size()] };
+		if(!sentPacket.inUse || sentPacket.acked || sentPacket.sequence != sequence)
+			return;
+		sentPacket.acked = true;
+		++m_stats.packetsAcked;
+
+		const float sample{ (float)(nowMilliseconds - sentPacket.sendTime) };
+		if(m_stats.packetsAcked == 1)
+			m_stats.roundTripMilliseconds = sample;
+		else
+			m_stats.roundTripMilliseconds += ROUND_TRIP_SMOOTHING * (sample - m_stats.roundTripMilliseconds);
+
+		for(Uint16 id : sentPacket.reliableIDs)
+		{
+			ReliableMessage& message{ m_sendWindow[id & m_reliableWindowMask] };
+			if(message.inUse && message.id == id)
+			{
+				message.inUse = false;
+				message.payload.clear();
+			}
+		}
+		while(m_oldestUnackedID != m_nextReliableID && !m_sendWindow[m_oldestUnackedID & m_reliableWindowMask].inUse)
+			++m_oldestUnackedID;
+	}
+	// Returns false if the packet is malformed. Messages before the fault are kept.
+	bool UdpConnection::ProcessMessages(const Uint8* data, size_t numBytes)
+	{
+		size_t position{ 0 };
+		while(position < numBytes)
+		{
+			if(numBytes - position < MESSAGE_HEADER_BYTES)
+				return false;
+			const UdpChannel channel{ (UdpChannel)data[position] };
+			const size_t payloadBytes{ Read16(data + position + 1) };
+			position += MESSAGE_HEADER_BYTES;
+			if(channel == UdpChannel::RELIABLE_ORDERED)
+			{
+				if(numBytes - position < RELIABLE_ID_BYTES + payloadBytes)
+					return false;
+				const Uint16 id{ Read16(data + position) };
+				position += RELIABLE_ID_BYTES;
+				DeliverReliable(id, data + position, payloadBytes);
+			}
+			else if(channel == UdpChannel::UNRELIABLE)
+			{
+				if(numBytes - position < payloadBytes)
+					return false;
+				m_received.emplace(data + position, data + position + payloadBytes);
+				++m_stats.messagesReceived;
+			}
+			else
+				return false;
+			position += payloadBytes;
+		}
+		return true;
+	}
+	void UdpConnection::DeliverReliable(Uint16 id, const Uint8* data, size_t numBytes)
+	{
+		// IDs behind m_nextExpectedID are resends of delivered messages and
+		//	wrap around to a large distance, so they fail this check too
+		if((Uint16)(id - m_nextExpectedID) >= m_receiveWindow.size())
+			return;
+		ReliableMessage& message{ m_receiveWindow[id & m_reliableWindowMask] };
+		if(!message.inUse)
+		{
+			message.inUse = true;
+			message.id = id;
+			message.payload.assign(data, data + numBytes);
+		}
+		for(;;)
+		{
+			ReliableMessage& next{ m_receiveWindow[m_nextExpectedID & m_reliableWindowMask] };
+			if(!next.inUse)
+				break;
+			m_received.push(std::move(next.payload));
+			next.payload.clear();
+			next.inUse = false;
+			++m_nextExpectedID;
+			++m_stats.messagesReceived;
+		}
+	}
+	bool UdpConnection::Receive(NetworkMessage& messageOut)
+	{
+		if(m_received.empty())
+			return false;
+		const std::vector<Uint8>& payload{ m_received.front() };
+		messageOut.Set(payload.data(), payload.size());
+		m_received.pop();
+		return true;
+	}
+	const IpAddress& UdpConnection::GetPeer() const
+	{
+		return m_peer;
+	}
+	const UdpConnectionStats& UdpConnection::GetStats() const
+	{
+		return m_stats;
+	}
+	unsigned UdpConnection::GetUnackedReliableCount() const
+	{
+		unsigned count{ 0 };
+		for(Uint16 id = m_oldestUnackedID; id != m_nextReliableID; ++id)
+			if(m_sendWindow[id & m_reliableWindowMask].inUse)
+				++count;
+		return count;
+	}
+	bool UdpConnection::IsReliableWindowFull() const
+	{
+		return (Uint16)(m_nextReliableID - m_oldestUnackedID) >= m_sendWindow.size();
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			SimulatedLink		   |
+	//\--------------------------------/--------------------------------------
+	SimulatedLink::SimulatedLink(const SimulatedLinkDef& def, const RandomStream& randomStream)
+		: m_def{ def },
+		  m_randomStream{ randomStream },
+		  m_endpoints{ Endpoint{ *this, 0 }, Endpoint{ *this, 1 } }
+	{ }
+	DatagramTransport& SimulatedLink::GetEndpoint(unsigned index)
+	{
+		d2Assert(index < 2);
+		return m_endpoints[index];
+	}
+	IpAddress SimulatedLink::GetAddress(unsigned index) const
+	{
+		d2Assert(index < 2);
+		IPaddress sdlIPaddress;
+		sdlIPaddress.host = SDL_SwapBE32(0x7F000001);
+		sdlIPaddress.port = SDL_SwapBE16((Uint16)(index + 1));
+		IpAddress address;
+		address.Set(sdlIPaddress);
+		return address;
+	}
+	void SimulatedLink::SetDef(const SimulatedLinkDef& def)
+	{
+		m_def = def;
+	}
+	void SimulatedLink::SetTime(Uint32 milliseconds)
+	{
+		m_time = milliseconds;
+	}
+	Uint64 SimulatedLink::GetDroppedCount() const
+	{
+		return m_droppedCount;
+	}
+	void SimulatedLink::Send(unsigned fromIndex, std::span<const Uint8> data)
+	{
+		if(m_randomStream.NextFloatPercent() * 100.0f < m_def.lossPercent)
+		{
+			++m_droppedCount;
+			return;
+		}
+		Uint32 delay{ m_def.latencyMilliseconds };
+		if(m_def.jitterMilliseconds)
+			delay += (Uint32)m_randomStream.NextInt({ 0, (int)m_def.jitterMilliseconds });
+		m_inFlight[1 - fromIndex].push_back({ m_time + delay, m_nextOrder++, { data.begin(), data.end() } });
+	}
+	bool SimulatedLink::Receive(unsigned toIndex, std::vector<Uint8>& dataOut)
+	{
+		// Deliver the earliest datagram that has arrived, in send order among ties
+		std::vector<Datagram>& inFlight{ m_inFlight[toIndex] };
+		auto earliestIt{ inFlight.end() };
+		for(auto it = inFlight.begin(); it != inFlight.end(); ++it)
+			if(it->deliveryTime <= m_time && (earliestIt == inFlight.end() ||
+				std::tie(it->deliveryTime, it->order) < std::tie(earliestIt->deliveryTime, earliestIt->order)))
+				earliestIt = it;
+		if(earliestIt == inFlight.end())
+			return false;
+		dataOut.swap(earliestIt->data);
+		if(earliestIt != inFlight.end() - 1)
+			*earliestIt = std::move(inFlight.back());
+		inFlight.pop_back();
+		return true;
+	}
+	SimulatedLink::Endpoint::Endpoint(SimulatedLink& link, unsigned index)
+		: m_link{ link },
+		  m_index{ index }
+	{ }
+	bool SimulatedLink::Endpoint::Send(const IpAddress& destination, std::span<const Uint8> data)
+	{
+		m_link.Send(m_index, data);
+		return true;
+	}
+	bool SimulatedLink::Endpoint::Receive(std::vector<Uint8>& dataOut, IpAddress& sourceOut)
+	{
+		if(!m_link.Receive(m_index, dataOut))
+			return false;
+		sourceOut = m_link.GetAddress(1 - m_index);
+		return true;
+	}
+}
@@ -9,6 +9,7 @@
 \**************************************************************************************/
 #include "d2pch.h"
 #include "d2Utility.h"
+#include "d2Vfs.h"
 #include "d2StringManip.h"
 #include "d2Rect.h"
 
@@ -122,11 +123,7 @@ namespace d2d
 	}
 	std::string FileToString(const std::string& filePath)
 	{
-		std::ifstream inStream{ filePath };
-		if(!inStream)
-			return "";
-		std::stringstream sstr;
-		sstr << inStream.rdbuf();
-		return sstr.str();
+		const VfsFile file{ OpenFile(filePath) };
+		return std::string{ file.GetText() };
 	}
 }
@@ -0,0 +1,297 @@
+/**************************************************************************************\
+** File: d2Vfs.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Source code file for packed asset archives and the virtual file system
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Vfs.h"
+#include "d2Compression.h"
+#include "d2Utility.h"
+namespace d2d
+{
+	namespace
+	{
+		const Uint8 ARCHIVE_MAGIC[4]{ 'D', '2', 'P', 'K' };
+		const Uint32 ARCHIVE_VERSION{ 1 };
+
+		std::vector<std::shared_ptr<const Archive>> archives;
+		bool looseFilesOverride{ false };
+
+		// Archive paths use '/' and have no leading "./"
+		std::string NormalizePath(std::string path)
+		{
+			std::replace(path.begin(), path.end(), '\\', '/');
+			size_t start{ 0 };
+			while(path.compare(start, 2, "./") == 0)
+				start += 2;
+			return path.substr(start);
+		}
+
+		void AppendUint32(std::vector<Uint8>& out, Uint32 value)
+		{
+			value = SDL_SwapLE32(value);
+			const Uint8* bytes{ (const Uint8*)&value };
+			out.insert(out.end(), bytes, bytes + sizeof(value));
+		}
+		void AppendUint64(std::vector<Uint8>& out, Uint64 value)
+		{
+			value = SDL_SwapLE64(value);
+			const Uint8* bytes{ (const Uint8*)&value };
+			out.insert(out.end(), bytes, bytes + sizeof(value));
+		}
+		class BinaryReader
+		{
+		public:
+			BinaryReader(std::span<const Uint8> data, const std::string& archivePath)
+				: m_data{ data }, m_archivePath{ archivePath }
+			{ }
+			const Uint8* ReadBytes(size_t numBytes)
+			{
+				if(numBytes > m_data.size() - m_position)
+					throw FileException{ "Failed to open archive " + m_archivePath + ": truncated" };
+				const Uint8* bytes{ m_data.data() + m_position };
+				m_position += numBytes;
+				return bytes;
+			}
+			Uint8 ReadUint8()
+			{
+				return *ReadBytes(1);
+			}
+			Uint32 ReadUint32()
+			{
+				Uint32 value;
+				std::memcpy(&value, ReadBytes(sizeof(value)), sizeof(value));
+				return SDL_SwapLE32(value);
+			}
+			Uint64 ReadUint64()
+			{
+				Uint64 value;
+				std::memcpy(&value, ReadBytes(sizeof(value)), sizeof(value));
+				return SDL_SwapLE64(value);
+			}
+			// Bounds a count by how many elements of at least minElementBytes
+			//	could follow, so a corrupt count can't drive a huge allocation
+			Uint32 ReadCount(size_t minElementBytes)
+			{
+				const Uint32 count{ ReadUint32() };
+				if(count > (m_data.size() - m_position) / minElementBytes)
+					throw FileException{ "Failed to open archive " + m_archivePath + ": bad entry count" };
+				return count;
+			}
+		private:
+			std::span<const Uint8> m_data;
+			const std::string& m_archivePath;
+			size_t m_position{ 0 };
+		};
+
+		// Offset, stored size, size, flags and path length; the path follows
+		const size_t MIN_ENTRY_BYTES{ sizeof(Uint64) + 3 * sizeof(Uint32) + sizeof(Uint8) };
+
+		size_t GetTocBytes(const std::vector<ArchiveEntry>& entries)
+		{
+			size_t numBytes{ sizeof(ARCHIVE_MAGIC) + 2 * sizeof(Uint32) };
+			for(const ArchiveEntry& entry : entries)
+				numBytes += MIN_ENTRY_BYTES + entry.path.size();
+			return numBytes;
+		}
+		size_t GetAligned(size_t offset)
+		{
+			return (offset + ARCHIVE_ALIGNMENT - 1) / ARCHIVE_ALIGNMENT * ARCHIVE_ALIGNMENT;
+		}
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			   Archive			   |
+	//\--------------------------------/--------------------------------------
+	// Archives are read in parts, so pages are left to load on first touch
+	Archive::Archive(const std::string& archivePath)
+		: m_archivePath{ archivePath },
+		m_file{ archivePath, false }
+	{
+		const std::span<const Uint8> bytes{ m_file.GetBytes() };
+		BinaryReader reader{ bytes, archivePath };
+		if(std::memcmp(reader.ReadBytes(sizeof(ARCHIVE_MAGIC)), ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0)
+			throw FileException{ "Failed to open archive " + archivePath + ": not an archive" };
+		const Uint32 version{ reader.ReadUint32() };
+		if(version != ARCHIVE_VERSION)
+			throw FileException{ "Failed to open archive " + archivePath + ": unsupported version " + std::to_string(version) };
+
+		m_entries.resize(reader.ReadCount(MIN_ENTRY_BYTES));
+		for(ArchiveEntry& entry : m_entries)
+		{
+			entry.offset = reader.ReadUint64();
+			entry.storedSize = reader.ReadUint32();
+			entry.size = reader.ReadUint32();
+			entry.flags = reader.ReadUint8();
+			const Uint32 pathBytes{ reader.ReadUint32() };
+			entry.path.assign((const char*)reader.ReadBytes(pathBytes), pathBytes);
+
+			const bool sizesMatch{ entry.IsCompressed()
+				? entry.size <= MAX_DECOMPRESSED_BYTES : entry.storedSize == entry.size };
+			if(!sizesMatch || entry.offset > bytes.size() || entry.storedSize > bytes.size() - entry.offset)
+				throw FileException{ "Failed to open archive " + archivePath + ": bad entry " + entry.path };
+		}
+		if(!std::is_sorted(m_entries.begin(), m_entries.end(),
+			[](const ArchiveEntry& a, const ArchiveEntry& b) { return a.path < b.path; }))
+			throw FileException{ "Failed to open archive " + archivePath + ": entries out of order" };
+	}
+	const ArchiveEntry* Archive::Find(std::string_view path) const
+	{
+		auto entryIt{ std::lower_bound(m_entries.begin(), m_entries.end(), path,
+			[](const ArchiveEntry& entry, std::string_view path) { return entry.path < path; }) };
+		if(entryIt == m_entries.end() || entryIt->path != path)
+			return nullptr;
+		return &*entryIt;
+	}
+	std::span<const Uint8> Archive::GetStoredBytes(const ArchiveEntry& entry) const
+	{
+		return m_file.GetBytes().subspan((size_t)entry.offset, entry.storedSize);
+	}
+
+	std::vector<ArchiveSource> GetArchiveSources(const std::string& directory)
+	{
+		std::vector<ArchiveSource> sources;
+		for(const auto& directoryEntry : std::filesystem::recursive_directory_iterator{ directory })
+			if(directoryEntry.is_regular_file())
+			{
+				const std::string filePath{ directoryEntry.path().generic_string() };
+				sources.push_back({ NormalizePath(filePath), filePath });
+			}
+		return sources;
+	}
+	void WriteArchive(const std::string& archivePath, std::span<const ArchiveSource> sources)
+	{
+		// Read and compress everything first, since the table of contents comes first
+		std::vector<ArchiveEntry> entries;
+		std::vector<std::vector<Uint8>> storedData;
+		std::vector<Uint8> fileData;
+		std::vector<size_t> order(sources.size());
+		for(size_t i = 0; i < sources.size(); ++i)
+			order[i] = i;
+		std::vector<std::string> paths;
+		for(const ArchiveSource& source : sources)
+			paths.push_back(NormalizePath(source.path));
+		std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return paths[a] < paths[b]; });
+		for(size_t i = 1; i < order.size(); ++i)
+			if(paths[order[i - 1]] == paths[order[i]])
+				throw FileException{ "Failed to write archive " + archivePath + ": " + paths[order[i]] + " is in it twice" };
+
+		for(size_t index : order)
+		{
+			ReadFile(sources[index].filePath, fileData);
+			if(fileData.size() > std::numeric_limits<Uint32>::max())
+				throw FileException{ "Failed to write archive " + archivePath + ": " + sources[index].filePath + " is too large" };
+			ArchiveEntry& entry{ entries.emplace_back() };
+			entry.path = paths[index];
+			entry.size = (Uint32)fileData.size();
+			entry.flags = 0;
+			std::vector<Uint8>& stored{ storedData.emplace_back() };
+			if(fileData.size() <= MAX_DECOMPRESSED_BYTES)
+			{
+				CompressLZ(fileData, stored);
+				if(stored.size() <= fileData.size() - fileData.size() / 8)
+					entry.flags |= ARCHIVE_ENTRY_COMPRESSED;
+				else
+					stored.clear();
+			}
+			if(!entry.IsCompressed())
+				stored.swap(fileData);
+			entry.storedSize = (Uint32)stored.size();
+		}
+
+		std::vector<Uint8> archive;
+		size_t offset{ GetAligned(GetTocBytes(entries)) };
+		for(ArchiveEntry& entry : entries)
+		{
+			entry.offset = offset;
+			offset = GetAligned(offset + entry.storedSize);
+		}
+		archive.reserve(offset);
+		archive.insert(archive.end(), std::begin(ARCHIVE_MAGIC), std::end(ARCHIVE_MAGIC));
+		AppendUint32(archive, ARCHIVE_VERSION);
+		AppendUint32(archive, (Uint32)entries.size());
+		for(const ArchiveEntry& entry : entries)
+		{
+			AppendUint64(archive, entry.offset);
+			AppendUint32(archive, entry.storedSize);
+			AppendUint32(archive, entry.size);
+			archive.push_back(entry.flags);
+			AppendUint32(archive, (Uint32)entry.path.size());
+			archive.insert(archive.end(), entry.path.begin(), entry.path.end());
+		}
+		for(size_t i = 0; i < entries.size(); ++i)
+		{
+			archive.resize((size_t)entries[i].offset, 0);
+			archive.insert(archive.end(), storedData[i].begin(), storedData[i].end());
+		}
+
+		std::ofstream outStream{ archivePath, std::ios::binary | std::ios::trunc };
+		if(!outStream.write((const char*)archive.data(), (std::streamsize)archive.size()))
+			throw FileException{ "Failed to write archive " + archivePath };
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|		  Virtual file system	   |
+	//\--------------------------------/--------------------------------------
+	void MountArchive(const std::string& archivePath)
+	{
+		archives.push_back(std::make_shared<const Archive>(archivePath));
+	}
+	void UnmountArchives()
+	{
+		archives.clear();
+	}
+	void SetLooseFileOverride(bool enabled)
+	{
+		looseFilesOverride = enabled;
+	}
+	SDL_RWops* VfsFile::GetRWops() const
+	{
+		return SDL_RWFromConstMem(m_bytes.data(), (int)m_bytes.size());
+	}
+	VfsFile OpenFile(const std::string& filePath)
+	{
+		VfsFile file;
+		std::error_code error;
+		if(archives.empty() || (looseFilesOverride && std::filesystem::is_regular_file(filePath, error)))
+		{
+			file.m_looseFile.Open(filePath);
+			file.m_bytes = file.m_looseFile.GetBytes();
+			return file;
+		}
+
+		const std::string path{ NormalizePath(filePath) };
+		for(auto archiveIt = archives.rbegin(); archiveIt != archives.rend(); ++archiveIt)
+		{
+			const ArchiveEntry* entryPtr{ (*archiveIt)->Find(path) };
+			if(!entryPtr)
+				continue;
+			const std::span<const Uint8> stored{ (*archiveIt)->GetStoredBytes(*entryPtr) };
+			if(entryPtr->IsCompressed())
+			{
+				try
+				{
+					DecompressLZ(stored, entryPtr->size, file.m_buffer);
+				}
+				catch(const CompressionException&)
+				{
+					throw FileException{ "Failed to read " + path + " from archive " + (*archiveIt)->GetPath() };
+				}
+				file.m_bytes = file.m_buffer;
+			}
+			else
+			{
+				file.m_archive = *archiveIt;
+				file.m_bytes = stored;
+			}
+			return file;
+		}
+		file.m_looseFile.Open(filePath);
+		file.m_bytes = file.m_looseFile.GetBytes();
+		return file;
+	}
+}
@@ -294,6 +294,10 @@ namespace d2d
 		{
 			glColor4f(newColor.red, newColor.green, newColor.blue, newColor.alpha);
 		}
+		void SetColor(const Color32& newColor)
+		{
+			glColor4ub(newColor.red, newColor.green, newColor.blue, newColor.alpha);
+		}
 		void SetPointSize(float size)
 		{
 			glPointSize(size);
@@ -571,6 +575,74 @@ namespace d2d
 			}
 			glEnd();
 		}
+		void DrawPoints(const b2Vec2* positions, const Color32* colors, unsigned count)
+		{
+			if(!positions || !colors || !count)
+				return;
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_COLOR_ARRAY);
+			glVertexPointer(2, GL_FLOAT, sizeof(b2Vec2), positions);
+			glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color32), colors);
+			glDrawArrays(GL_POINTS, 0, (GLsizei)count);
+			glDisableClientState(GL_COLOR_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+		}
+		void DrawTexturedQuads(const Texture& texture, const b2Vec2* centers,
+			const Color32* colors, unsigned count, const b2Vec2& size)
+		{
+			if(!centers || !colors || !count)
+				return;
+
+			GLuint glTextureID = texture.GetGLTextureID();
+			if(!m_textureBinded || m_boundGLTextureID != glTextureID)
+			{
+				glBindTexture(GL_TEXTURE_2D, glTextureID);
+				m_boundGLTextureID = glTextureID;
+			}
+
+			// Expand each center into four corners. The buffers are kept between
+			// calls so that steady-state drawing does not allocate.
+			static std::vector<b2Vec2> vertices;
+			static std::vector<b2Vec2> texCoords;
+			static std::vector<Color32> vertexColors;
+			const unsigned vertexCount{ 4 * count };
+			vertices.resize(vertexCount);
+			texCoords.resize(vertexCount);
+			vertexColors.resize(vertexCount);
+
+			const b2Vec2 halfSize{ 0.5f * size };
+			const TextureCoordinates& textureCoords = texture.GetTextureCoordinates();
+			for(unsigned i = 0; i < count; ++i)
+			{
+				const b2Vec2& center{ centers[i] };
+				b2Vec2* quad{ &vertices[4 * i] };
+				quad[0].Set(center.x - halfSize.x, center.y - halfSize.y);
+				quad[1].Set(center.x + halfSize.x, center.y - halfSize.y);
+				quad[2].Set(center.x + halfSize.x, center.y + halfSize.y);
+				quad[3].Set(center.x - halfSize.x, center.y + halfSize.y);
+
+				b2Vec2* quadTexCoords{ &texCoords[4 * i] };
+				quadTexCoords[0] = textureCoords.lowerLeft;
+				quadTexCoords[1] = textureCoords.lowerRight;
+				quadTexCoords[2] = textureCoords.upperRight;
+				quadTexCoords[3] = textureCoords.upperLeft;
+
+				Color32* quadColors{ &vertexColors[4 * i] };
+				quadColors[0] = quadColors[1] = quadColors[2] = quadColors[3] = colors[i];
+			}
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+			glEnableClientState(GL_COLOR_ARRAY);
+			glVertexPointer(2, GL_FLOAT, sizeof(b2Vec2), vertices.data());
+			glTexCoordPointer(2, GL_FLOAT, sizeof(b2Vec2), texCoords.data());
+			glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color32), vertexColors.data());
+			glDrawArrays(GL_QUADS, 0, (GLsizei)vertexCount);
+			glDisableClientState(GL_COLOR_ARRAY);
+			glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+		}
 		void ShowSimpleMessageBox(MessageBoxType type, const std::string& title, const std::string& message)
 		{
 			if(m_windowDef.fullScreen)
@@ -0,0 +1,114 @@
+/**************************************************************************************\
+** File: d2BodyStateBench.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Benchmarks for the batch body state queries against the per-body functions
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2BodyState.h"
+#include "d2Simd.h"
+#include "d2Utility.h"
+#include <benchmark/benchmark.h>
+namespace
+{
+	const int NUM_BODIES{ 50000 };
+
+	// Bodies are allocated one by one like a level's, so the per-body loop
+	//	pays the pointer chasing the gather pays
+	std::vector<b2Body*> AddBodies(b2World& world)
+	{
+		std::vector<b2Body*> bodies;
+		b2CircleShape circle;
+		circle.m_radius = 0.5f;
+		b2FixtureDef fixtureDef;
+		fixtureDef.shape = &circle;
+		for(int i = 0; i < NUM_BODIES; ++i)
+		{
+			float f{ (float)i };
+			b2BodyDef bodyDef;
+			bodyDef.type = b2_dynamicBody;
+			bodyDef.position.Set((float)(i % 256) * 2.0f, (float)(i / 256) * 2.0f);
+			bodyDef.linearVelocity.Set(std::sin(f) * 20.0f, std::cos(f * 0.7f) * 15.0f);
+			bodyDef.angularVelocity = std::sin(f * 1.3f) * 10.0f;
+			b2Body* bodyPtr{ world.CreateBody(&bodyDef) };
+			fixtureDef.density = 0.5f + (float)(i % 5);
+			bodyPtr->CreateFixture(&fixtureDef);
+			bodies.push_back(bodyPtr);
+		}
+		return bodies;
+	}
+
+	// Arg 0 selects the path: 0 per-body loop, 1 SSE2, 2 AVX
+	void SelectPath(benchmark::State& state)
+	{
+		d2d::SetAVXEnabled(state.range(0) == 2);
+		if(state.range(0) == 2 && !d2d::CpuHasAVX())
+			state.SkipWithError("CPU has no AVX");
+	}
+	void ApplyArgs(benchmark::internal::Benchmark* benchmark)
+	{
+		benchmark->ArgNames({ "path" });
+		for(long path : { 0, 1, 2 })
+			benchmark->Arg(path);
+	}
+
+	// The batch paths include the gather, since callers gather every frame
+	void BM_KineticEnergies(benchmark::State& state)
+	{
+		SelectPath(state);
+		b2World world{ { 0.0f, 0.0f } };
+		const std::vector<b2Body*> bodies{ AddBodies(world) };
+		d2d::BodyStates states;
+		std::vector<float> energies(bodies.size());
+		for(auto _ : state)
+		{
+			if(state.range(0) == 0)
+				for(size_t i = 0; i < bodies.size(); ++i)
+					energies[i] = d2d::CalculateKineticEnergy(bodies[i]);
+			else
+			{
+				d2d::GatherBodyStates(bodies, states);
+				d2d::CalculateKineticEnergies(states, energies);
+			}
+			benchmark::DoNotOptimize(energies.data());
+		}
+		state.SetItemsProcessed(state.iterations() * NUM_BODIES);
+		d2d::SetAVXEnabled(true);
+	}
+	BENCHMARK(BM_KineticEnergies)->Apply(ApplyArgs)->Unit(benchmark::kMicrosecond);
+
+	// The threshold keeps a little over half of the bodies, so the masks are mixed
+	void BM_FindBodiesAboveKineticEnergy(benchmark::State& state)
+	{
+		SelectPath(state);
+		b2World world{ { 0.0f, 0.0f } };
+		const std::vector<b2Body*> bodies{ AddBodies(world) };
+		const float threshold{ 200.0f };
+		d2d::BodyStates states;
+		std::vector<b2Body*> found;
+		found.reserve(bodies.size());
+		for(auto _ : state)
+		{
+			if(state.range(0) == 0)
+			{
+				found.clear();
+				for(b2Body* bodyPtr : bodies)
+					if(d2d::CalculateKineticEnergy(bodyPtr) > threshold)
+						found.push_back(bodyPtr);
+			}
+			else
+			{
+				d2d::GatherBodyStates(bodies, states);
+				d2d::FindBodiesAboveKineticEnergy(states, threshold, found);
+			}
+			benchmark::DoNotOptimize(found.data());
+		}
+		state.counters["found"] = (double)found.size();
+		state.SetItemsProcessed(state.iterations() * NUM_BODIES);
+		d2d::SetAVXEnabled(true);
+	}
+	BENCHMARK(BM_FindBodiesAboveKineticEnergy)->Apply(ApplyArgs)->Unit(benchmark::kMicrosecond);
+}
@@ -0,0 +1,135 @@
+/**************************************************************************************\
+** File: d2BodyStateTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Tests for the batch body state queries on the AVX, SSE2 and scalar paths
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2BodyState.h"
+#include "d2Simd.h"
+#include "d2Utility.h"
+#include <gtest/gtest.h>
+#include <numeric>
+namespace
+{
+	// Run every test once on the AVX paths and once on the SSE2 paths
+	class BodyStateTest : public ::testing::TestWithParam<bool>
+	{
+	protected:
+		void SetUp() override { d2d::SetAVXEnabled(GetParam()); }
+		void TearDown() override { d2d::SetAVXEnabled(true); }
+		b2World world{ { 0.0f, 0.0f } };
+	};
+	INSTANTIATE_TEST_SUITE_P(Simd, BodyStateTest, ::testing::Values(true, false),
+		[](const ::testing::TestParamInfo<bool>& info) { return info.param ? "AVX" : "SSE2"; });
+
+	// Not a multiple of 8, so both SIMD widths leave a scalar tail
+	const size_t NUM_BODIES{ 1001 };
+
+	// Bodies of varying size, density and velocity. Every 97th entry is
+	//	null, which the queries treat as a body at rest.
+	std::vector<b2Body*> AddBodies(b2World& world, size_t count)
+	{
+		std::vector<b2Body*> bodies;
+		for(size_t i = 0; i < count; ++i)
+		{
+			if(i % 97 == 96)
+			{
+				bodies.push_back(nullptr);
+				continue;
+			}
+			float f{ (float)i };
+			b2BodyDef bodyDef;
+			bodyDef.type = b2_dynamicBody;
+			bodyDef.position.Set(f * 3.0f, 0.0f);
+			bodyDef.linearVelocity.Set(std::sin(f) * 20.0f, std::cos(f * 0.7f) * 15.0f);
+			bodyDef.angularVelocity = std::sin(f * 1.3f) * 10.0f;
+			b2Body* bodyPtr{ world.CreateBody(&bodyDef) };
+			b2CircleShape circle;
+			circle.m_radius = 0.25f + (float)(i % 7) * 0.1f;
+			b2FixtureDef fixtureDef;
+			fixtureDef.shape = &circle;
+			fixtureDef.density = 0.5f + (float)(i % 5);
+			bodyPtr->CreateFixture(&fixtureDef);
+			bodies.push_back(bodyPtr);
+		}
+		return bodies;
+	}
+	std::vector<b2Body*> FindAboveReference(std::span<b2Body* const> bodies, float threshold)
+	{
+		std::vector<b2Body*> found;
+		for(b2Body* bodyPtr : bodies)
+			if(d2d::CalculateKineticEnergy(bodyPtr) > threshold)
+				found.push_back(bodyPtr);
+		return found;
+	}
+}
+TEST_P(BodyStateTest, KineticEnergiesMatchPerBodyCalculation)
+{
+	const std::vector<b2Body*> bodies{ AddBodies(world, NUM_BODIES) };
+
+	// Every count up to two AVX widths, then the full set
+	std::vector<size_t> counts(17);
+	std::iota(counts.begin(), counts.end(), (size_t)0);
+	counts.push_back(NUM_BODIES);
+	for(size_t count : counts)
+	{
+		std::span<b2Body* const> subset{ bodies.data(), count };
+		d2d::BodyStates states;
+		d2d::GatherBodyStates(subset, states);
+		std::vector<float> energies(count);
+		d2d::CalculateKineticEnergies(states, energies);
+		for(size_t i = 0; i < count; ++i)
+			EXPECT_FLOAT_EQ(d2d::CalculateKineticEnergy(subset[i]), energies[i]) << "count " << count << ", body " << i;
+	}
+}
+TEST_P(BodyStateTest, FindAboveKineticEnergyKeepsBodyOrder)
+{
+	const std::vector<b2Body*> bodies{ AddBodies(world, NUM_BODIES) };
+	d2d::BodyStates states;
+	d2d::GatherBodyStates(bodies, states);
+	std::vector<float> energies(bodies.size());
+	d2d::CalculateKineticEnergies(states, energies);
+
+	// The median splits the bodies in half, so the compaction sees mixed
+	//	masks in nearly every vector
+	std::vector<float> sorted{ energies };
+	std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+	const float median{ sorted[sorted.size() / 2] };
+	std::vector<b2Body*> found;
+	for(float threshold : { -1.0f, median, sorted.back() * 2.0f })
+	{
+		d2d::FindBodiesAboveKineticEnergy(states, threshold, found);
+		EXPECT_EQ(FindAboveReference(bodies, threshold), found) << "threshold " << threshold;
+	}
+	EXPECT_EQ(bodies.size(), FindAboveReference(bodies, -1.0f).size());
+
+	// Short runs end in the scalar tail
+	for(size_t count = 0; count < 17; ++count)
+	{
+		std::span<b2Body* const> subset{ bodies.data(), count };
+		d2d::GatherBodyStates(subset, states);
+		d2d::FindBodiesAboveKineticEnergy(states, median, found);
+		EXPECT_EQ(FindAboveReference(subset, median), found) << "count " << count;
+	}
+}
+TEST_P(BodyStateTest, SpeedsAndMomentaMatchVelocities)
+{
+	const std::vector<b2Body*> bodies{ AddBodies(world, NUM_BODIES) };
+	d2d::BodyStates states;
+	d2d::GatherBodyStates(bodies, states);
+	std::vector<float> speeds(bodies.size());
+	std::vector<float> momenta(bodies.size());
+	d2d::CalculateSpeeds(states, speeds);
+	d2d::CalculateMomenta(states, momenta);
+	for(size_t i = 0; i < bodies.size(); ++i)
+	{
+		float speed{ bodies[i] ? bodies[i]->GetLinearVelocity().Length() : 0.0f };
+		float mass{ bodies[i] ? bodies[i]->GetMass() : 0.0f };
+		EXPECT_FLOAT_EQ(speed, speeds[i]) << "body " << i;
+		EXPECT_FLOAT_EQ(mass * speed, momenta[i]) << "body " << i;
+	}
+}
@@ -0,0 +1,119 @@
+/**************************************************************************************\
+** File: d2ColorTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Tests for the batch color functions
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Color.h"
+#include "d2Simd.h"
+#include <gtest/gtest.h>
+namespace
+{
+	// Run every test once on the AVX paths and once on the SSE2 paths
+	class BatchColorTest : public ::testing::TestWithParam<bool>
+	{
+	protected:
+		void SetUp() override { d2d::SetAVXEnabled(GetParam()); }
+		void TearDown() override { d2d::SetAVXEnabled(true); }
+	};
+	INSTANTIATE_TEST_SUITE_P(Simd, BatchColorTest, ::testing::Values(true, false),
+		[](const ::testing::TestParamInfo<bool>& info) { return info.param ? "AVX" : "SSE2"; });
+
+	// 1001 colors so every kernel has a tail
+	const size_t NUM_COLORS{ 1001 };
+
+	std::vector<d2d::Color> MakeColors(unsigned seed)
+	{
+		std::mt19937 engine{ seed };
+		std::uniform_real_distribution<float> channel{ 0.0f, 1.0f };
+		std::vector<d2d::Color> colors;
+		for(size_t i = 0; i < NUM_COLORS; ++i)
+			colors.push_back({ channel(engine), channel(engine), channel(engine), channel(engine) });
+		return colors;
+	}
+	// Includes percents outside [0, 1], where clamping order matters
+	std::vector<float> MakePercents(float low, float high)
+	{
+		std::mt19937 engine{ 99 };
+		std::uniform_real_distribution<float> percent{ low, high };
+		std::vector<float> percents;
+		for(size_t i = 0; i < NUM_COLORS; ++i)
+			percents.push_back(percent(engine));
+		return percents;
+	}
+	float LerpChannel(float a, float b, float percentB)
+	{
+		return std::clamp(percentB * b + (1.0f - percentB) * a, 0.0f, 1.0f);
+	}
+}
+TEST_P(BatchColorTest, LerpColorsMatchesScalar)
+{
+	const std::vector<d2d::Color> a{ MakeColors(1) };
+	const std::vector<d2d::Color> b{ MakeColors(2) };
+	const std::vector<float> percentB{ MakePercents(-0.5f, 1.5f) };
+	std::vector<d2d::Color> out(NUM_COLORS);
+	d2d::LerpColors(a, b, percentB, out);
+	for(size_t i = 0; i < NUM_COLORS; ++i)
+	{
+		EXPECT_FLOAT_EQ(LerpChannel(a[i].red, b[i].red, percentB[i]), out[i].red) << "index " << i;
+		EXPECT_FLOAT_EQ(LerpChannel(a[i].green, b[i].green, percentB[i]), out[i].green) << "index " << i;
+		EXPECT_FLOAT_EQ(LerpChannel(a[i].blue, b[i].blue, percentB[i]), out[i].blue) << "index " << i;
+		EXPECT_FLOAT_EQ(LerpChannel(a[i].alpha, b[i].alpha, percentB[i]), out[i].alpha) << "index " << i;
+	}
+}
+TEST_P(BatchColorTest, LerpColorsOddCountsMatchFullRun)
+{
+	// Each prefix length lands the AVX/SSE2 boundary somewhere different
+	const std::vector<d2d::Color> a{ MakeColors(3) };
+	const std::vector<d2d::Color> b{ MakeColors(4) };
+	const std::vector<float> percentB{ MakePercents(-2.0f, 3.0f) };
+	std::vector<d2d::Color> full(NUM_COLORS);
+	d2d::LerpColors(a, b, percentB, full);
+	for(size_t count = 0; count <= 9; ++count)
+	{
+		std::vector<d2d::Color> out(count);
+		d2d::LerpColors(std::span{ a }.first(count), std::span{ b }.first(count), std::span{ percentB }.first(count), out);
+		for(size_t i = 0; i < count; ++i)
+		{
+			EXPECT_EQ(full[i].red, out[i].red) << count << " colors, index " << i;
+			EXPECT_EQ(full[i].alpha, out[i].alpha) << count << " colors, index " << i;
+		}
+	}
+}
+TEST(Color32Test, EveryByteRoundTrips)
+{
+	for(int value = 0; value < 256; ++value)
+	{
+		const d2d::Color32 packed{ (Uint8)value, (Uint8)(255 - value), (Uint8)(value / 2), (Uint8)value };
+		EXPECT_EQ(packed, d2d::Color32{ packed.ToColor() }) << value;
+	}
+}
+TEST(Color32Test, PackingRoundsAndClamps)
+{
+	EXPECT_EQ(d2d::Color32(0, 128, 255, 255), (d2d::Color32{ d2d::Color{ 0.0f, 0.5f, 1.0f, 1.0f } }));
+	d2d::Color outOfRange;
+	outOfRange.red = -0.5f;
+	outOfRange.green = 1.5f;
+	outOfRange.blue = 0.2f / 255.0f;
+	outOfRange.alpha = 0.6f / 255.0f;
+	EXPECT_EQ(d2d::Color32(0, 255, 0, 1), d2d::Color32{ outOfRange });
+
+	// Bytes are laid out red, green, blue, alpha for GL_RGBA vertex arrays
+	const d2d::Color32 color{ 1, 2, 3, 4 };
+	const Uint8* bytes{ reinterpret_cast<const Uint8*>(&color) };
+	EXPECT_EQ((std::vector<Uint8>{ 1, 2, 3, 4 }), std::vector<Uint8>(bytes, bytes + 4));
+}
+TEST(Color32Test, LerpManyMatchesLerp)
+{
+	// 1001 is not a multiple of 4 or 8, so the scalar tail runs too
+	const d2d::ColorRange range{ { 0.1f, 0.9f, 0.0f, 1.0f }, { 0.8f, 0.2f, 1.0f, 0.0f } };
+	const std::vector<float> percentMax{ MakePercents(-0.25f, 1.25f) };
+	std::vector<d2d::Color32> out(NUM_COLORS);
+	range.LerpMany(percentMax, out);
+	for(size_t i = 0; i < NUM_COLORS; ++i)
+		EXPECT_EQ(d2d::Color32{ range.Lerp(percentMax[i]) }, out[i]) << "index " << i;
+}
@@ -0,0 +1,109 @@
+/**************************************************************************************\
+** File: d2CompressionBench.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Compression ratio and CPU cost of the LZ codec on snapshot payloads
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Compression.h"
+#include "d2Snapshot.h"
+#include <benchmark/benchmark.h>
+namespace
+{
+	const d2d::ConnectionID CLIENT_ID{ 0 };
+	const unsigned NUM_TICKS{ 64 };
+
+	// Real SnapshotServer output for NUM_TICKS ticks. Arg 0 is the entity
+	//	count, arg 1 the percentage of entities that move each tick, arg 2 is
+	//	1 if the client acks (delta snapshots) or 0 if it never does (full snapshots).
+	std::vector<std::vector<Uint8>> MakeSnapshotPayloads(const benchmark::State& state)
+	{
+		const unsigned numEntities{ (unsigned)state.range(0) };
+		const unsigned movingStride{ state.range(1) > 0 ? (unsigned)(100 / state.range(1)) : numEntities + 1 };
+		const bool acked{ state.range(2) != 0 };
+		d2d::SnapshotServer server;
+		d2d::SnapshotClient client;
+		server.AddClient(CLIENT_ID);
+		for(unsigned i = 0; i < numEntities; ++i)
+			server.SetEntity(i, { { (float)(i % 100), (float)(i / 100) }, 0.0f, { 1.0f, 0.0f }, 0.0f });
+
+		std::vector<std::vector<Uint8>> payloads;
+		d2d::NetworkMessage message;
+		d2d::NetworkMessage ack;
+		float time{ 0.0f };
+		for(unsigned tick = 0; tick < NUM_TICKS; ++tick)
+		{
+			time += 1.0f / 60.0f;
+			for(unsigned i = 0; i < numEntities; i += movingStride)
+				server.SetEntity(i, { { (float)(i % 100) + time, (float)(i / 100) }, time, { 1.0f, 0.0f }, 0.0f });
+			server.Capture();
+			server.WriteSnapshot(CLIENT_ID, message);
+			client.ReadSnapshot(message);
+			if(acked)
+			{
+				client.WriteAck(ack);
+				server.ReadAck(CLIENT_ID, ack);
+			}
+			payloads.emplace_back(message.GetPayload().begin(), message.GetPayload().end());
+		}
+		return payloads;
+	}
+	void SetCounters(benchmark::State& state, size_t totalBytes, size_t totalCompressedBytes)
+	{
+		state.SetBytesProcessed(state.iterations() * (int64_t)totalBytes);
+		state.counters["bytesPerTick"] = (double)totalBytes / NUM_TICKS;
+		state.counters["ratio"] = (double)totalCompressedBytes / (double)totalBytes;
+	}
+
+	void BM_CompressSnapshot(benchmark::State& state)
+	{
+		const std::vector<std::vector<Uint8>> payloads{ MakeSnapshotPayloads(state) };
+		std::vector<Uint8> compressed;
+		size_t totalBytes{ 0 };
+		size_t totalCompressedBytes{ 0 };
+		for(const std::vector<Uint8>& payload : payloads)
+		{
+			totalBytes += payload.size();
+			compressed.clear();
+			totalCompressedBytes += d2d::CompressLZ(payload, compressed);
+		}
+		for(auto _ : state)
+			for(const std::vector<Uint8>& payload : payloads)
+			{
+				compressed.clear();
+				d2d::CompressLZ(payload, compressed);
+				benchmark::DoNotOptimize(compressed.data());
+			}
+		SetCounters(state, totalBytes, totalCompressedBytes);
+	}
+	BENCHMARK(BM_CompressSnapshot)->ArgNames({ "entities", "movingPct", "acked" })
+		->Args({ 1000, 10, 1 })->Args({ 1000, 100, 1 })->Args({ 1000, 10, 0 })->Args({ 1000, 100, 0 });
+
+	void BM_DecompressSnapshot(benchmark::State& state)
+	{
+		const std::vector<std::vector<Uint8>> payloads{ MakeSnapshotPayloads(state) };
+		std::vector<std::vector<Uint8>> compressedPayloads;
+		size_t totalBytes{ 0 };
+		size_t totalCompressedBytes{ 0 };
+		for(const std::vector<Uint8>& payload : payloads)
+		{
+			totalBytes += payload.size();
+			compressedPayloads.emplace_back();
+			totalCompressedBytes += d2d::CompressLZ(payload, compressedPayloads.back());
+		}
+		std::vector<Uint8> decompressed;
+		for(auto _ : state)
+			for(size_t i = 0; i < payloads.size(); ++i)
+			{
+				decompressed.clear();
+				d2d::DecompressLZ(compressedPayloads[i], payloads[i].size(), decompressed);
+				benchmark::DoNotOptimize(decompressed.data());
+			}
+		SetCounters(state, totalBytes, totalCompressedBytes);
+	}
+	BENCHMARK(BM_DecompressSnapshot)->ArgNames({ "entities", "movingPct", "acked" })
+		->Args({ 1000, 10, 1 })->Args({ 1000, 100, 1 })->Args({ 1000, 10, 0 })->Args({ 1000, 100, 0 });
+}
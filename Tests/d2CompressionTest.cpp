@@ -0,0 +1,60 @@
+/**************************************************************************************\
+** File: d2CompressionTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Tests for the LZ codec
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Compression.h"
+#include "d2Utility.h"
+#include <gtest/gtest.h>
+namespace
+{
+	// Repetitive text with some noise, like a typical game message
+	std::vector<Uint8> MakeData(size_t numBytes)
+	{
+		std::vector<Uint8> data(numBytes);
+		for(size_t i = 0; i < numBytes; ++i)
+			data[i] = (Uint8)((i % 61 == 0) ? i * 31 : 'a' + i % 7);
+		return data;
+	}
+}
+TEST(CompressionTest, RoundTrip)
+{
+	for(size_t numBytes : { 0, 1, 12, 13, 100, 70000 })
+	{
+		const std::vector<Uint8> data{ MakeData(numBytes) };
+		std::vector<Uint8> compressed;
+		d2d::CompressLZ(data, compressed);
+		EXPECT_LE(compressed.size(), d2d::GetMaxCompressedSize(numBytes));
+
+		std::vector<Uint8> out{ 9 };
+		d2d::DecompressLZ(compressed, data.size(), out);
+		ASSERT_EQ(numBytes + 1, out.size());
+		EXPECT_TRUE(std::equal(data.begin(), data.end(), out.begin() + 1)) << numBytes << " bytes";
+	}
+}
+TEST(CompressionTest, OversizedOutputIsRefused)
+{
+	const Uint8 compressed[]{ 0xF0, 0xFF, 0xFF, 0xFF };
+	std::vector<Uint8> out;
+	EXPECT_THROW(d2d::DecompressLZ(compressed, d2d::MAX_DECOMPRESSED_BYTES + 1, out), d2d::CompressionException);
+	EXPECT_EQ(0u, out.capacity());
+}
+TEST(CompressionTest, CorruptInputLeavesOutputUnchanged)
+{
+	const std::vector<Uint8> data{ MakeData(1000) };
+	std::vector<Uint8> compressed;
+	d2d::CompressLZ(data, compressed);
+
+	const std::vector<Uint8> prefix{ 1, 2, 3 };
+	std::vector<Uint8> out{ prefix };
+	std::vector<Uint8> truncated{ compressed.begin(), compressed.end() - 3 };
+	EXPECT_THROW(d2d::DecompressLZ(truncated, data.size(), out), d2d::CompressionException);
+	EXPECT_EQ(prefix, out);
+	EXPECT_THROW(d2d::DecompressLZ(compressed, data.size() + 1, out), d2d::CompressionException);
+	EXPECT_EQ(prefix, out);
+}
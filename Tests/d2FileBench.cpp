@@ -0,0 +1,152 @@
+/**************************************************************************************\
+** File: d2FileBench.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Benchmarks comparing file reading and mapping with the old FileToString
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2File.h"
+#include <benchmark/benchmark.h>
+namespace
+{
+	const size_t LARGE_FILE_BYTES{ 16 * 1024 * 1024 };
+	const int NUM_SMALL_FILES{ 500 };
+	const size_t SMALL_FILE_BYTES{ 2048 };
+
+	std::filesystem::path GetDirectory()
+	{
+		return std::filesystem::temp_directory_path() / "d2FileBench";
+	}
+	void WriteFile(const std::string& filePath, size_t numBytes)
+	{
+		std::string contents(numBytes, ' ');
+		for(size_t i = 0; i < numBytes; ++i)
+			contents[i] = (char)('a' + i % 26);
+		std::ofstream{ filePath, std::ios::binary | std::ios::trunc } << contents;
+	}
+	const std::string& GetLargeFilePath()
+	{
+		static std::string filePath;
+		if(filePath.empty())
+		{
+			std::filesystem::create_directories(GetDirectory());
+			filePath = (GetDirectory() / "large.bin").string();
+			WriteFile(filePath, LARGE_FILE_BYTES);
+		}
+		return filePath;
+	}
+	const std::vector<std::string>& GetSmallFilePaths()
+	{
+		static std::vector<std::string> filePaths;
+		if(filePaths.empty())
+		{
+			std::filesystem::create_directories(GetDirectory());
+			for(int i = 0; i < NUM_SMALL_FILES; ++i)
+			{
+				filePaths.push_back((GetDirectory() / ("small" + std::to_string(i) + ".txt")).string());
+				WriteFile(filePaths.back(), SMALL_FILE_BYTES);
+			}
+		}
+		return filePaths;
+	}
+
+	// The old FileToString: ifstream into a stringstream, then copied out
+	std::string OldFileToString(const std::string& filePath)
+	{
+		std::ifstream inStream{ filePath };
+		if(!inStream)
+			return "";
+		std::stringstream sstr;
+		sstr << inStream.rdbuf();
+		return sstr.str();
+	}
+
+	void BM_LargeFileOldFileToString(benchmark::State& state)
+	{
+		for(auto _ : state)
+			benchmark::DoNotOptimize(OldFileToString(GetLargeFilePath()));
+		state.SetBytesProcessed(state.iterations() * LARGE_FILE_BYTES);
+	}
+	BENCHMARK(BM_LargeFileOldFileToString)->Unit(benchmark::kMillisecond);
+
+	void BM_LargeFileReadFile(benchmark::State& state)
+	{
+		for(auto _ : state)
+		{
+			std::string contents;
+			d2d::ReadFile(GetLargeFilePath(), contents);
+			benchmark::DoNotOptimize(contents.data());
+		}
+		state.SetBytesProcessed(state.iterations() * LARGE_FILE_BYTES);
+	}
+	BENCHMARK(BM_LargeFileReadFile)->Unit(benchmark::kMillisecond);
+
+	// Touches every page, as a parser would
+	void BM_LargeFileMapped(benchmark::State& state)
+	{
+		for(auto _ : state)
+		{
+			const d2d::MappedFile file{ GetLargeFilePath() };
+			Uint64 sum{ 0 };
+			for(size_t i = 0; i < file.GetSize(); i += 4096)
+				sum += file.GetBytes()[i];
+			benchmark::DoNotOptimize(sum);
+		}
+		state.SetBytesProcessed(state.iterations() * LARGE_FILE_BYTES);
+	}
+	BENCHMARK(BM_LargeFileMapped)->Unit(benchmark::kMillisecond);
+
+	void BM_SmallFilesOldFileToString(benchmark::State& state)
+	{
+		for(auto _ : state)
+			for(const std::string& filePath : GetSmallFilePaths())
+				benchmark::DoNotOptimize(OldFileToString(filePath));
+		state.SetItemsProcessed(state.iterations() * NUM_SMALL_FILES);
+	}
+	BENCHMARK(BM_SmallFilesOldFileToString)->Unit(benchmark::kMillisecond);
+
+	// One buffer reused for every file
+	void BM_SmallFilesReadFile(benchmark::State& state)
+	{
+		std::vector<Uint8> buffer;
+		for(auto _ : state)
+			for(const std::string& filePath : GetSmallFilePaths())
+			{
+				d2d::ReadFile(filePath, buffer);
+				benchmark::DoNotOptimize(buffer.data());
+			}
+		state.SetItemsProcessed(state.iterations() * NUM_SMALL_FILES);
+	}
+	BENCHMARK(BM_SmallFilesReadFile)->Unit(benchmark::kMillisecond);
+
+	void BM_SmallFilesPrefetchReadFile(benchmark::State& state)
+	{
+		std::vector<Uint8> buffer;
+		for(auto _ : state)
+		{
+			d2d::PrefetchFiles(GetSmallFilePaths());
+			for(const std::string& filePath : GetSmallFilePaths())
+			{
+				d2d::ReadFile(filePath, buffer);
+				benchmark::DoNotOptimize(buffer.data());
+			}
+		}
+		state.SetItemsProcessed(state.iterations() * NUM_SMALL_FILES);
+	}
+	BENCHMARK(BM_SmallFilesPrefetchReadFile)->Unit(benchmark::kMillisecond);
+
+	void BM_SmallFilesMapped(benchmark::State& state)
+	{
+		for(auto _ : state)
+			for(const std::string& filePath : GetSmallFilePaths())
+			{
+				const d2d::MappedFile file{ filePath };
+				benchmark::DoNotOptimize(file.GetBytes()[0]);
+			}
+		state.SetItemsProcessed(state.iterations() * NUM_SMALL_FILES);
+	}
+	BENCHMARK(BM_SmallFilesMapped)->Unit(benchmark::kMillisecond);
+}
@@ -0,0 +1,135 @@
+/**************************************************************************************\
+** File: d2FileTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Tests for file reading and mapping
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2File.h"
+#include "d2Hjson.h"
+#include "d2Utility.h"
+#include <gtest/gtest.h>
+namespace
+{
+	const std::string FILE_TEXT{ "line one\r\nline two\n\0binary"s };
+
+	class FileTest : public ::testing::Test
+	{
+	protected:
+		FileTest()
+			: m_directory{ std::filesystem::temp_directory_path() / "d2FileTest" }
+		{
+			std::filesystem::remove_all(m_directory);
+			std::filesystem::create_directories(m_directory);
+			m_filePath = WriteFile("text.txt", FILE_TEXT);
+			m_missingPath = (m_directory / "missing.txt").string();
+		}
+		~FileTest()
+		{
+			std::filesystem::remove_all(m_directory);
+		}
+		std::string WriteFile(const std::string& fileName, const std::string& contents)
+		{
+			const std::string filePath{ (m_directory / fileName).string() };
+			std::ofstream{ filePath, std::ios::binary | std::ios::trunc } << contents;
+			return filePath;
+		}
+
+		std::filesystem::path m_directory;
+		std::string m_filePath;
+		std::string m_missingPath;
+	};
+}
+TEST_F(FileTest, ReadFileKeepsEveryByte)
+{
+	std::string text;
+	d2d::ReadFile(m_filePath, text);
+	EXPECT_EQ(FILE_TEXT, text);
+
+	std::vector<Uint8> bytes(100, 0xFF);
+	d2d::ReadFile(m_filePath, bytes);
+	EXPECT_EQ(FILE_TEXT, std::string(bytes.begin(), bytes.end()));
+
+	EXPECT_EQ(FILE_TEXT, d2d::FileToString(m_filePath));
+}
+TEST_F(FileTest, ReadFileReusesCapacity)
+{
+	std::vector<Uint8> bytes;
+	bytes.reserve(1000);
+	const Uint8* data{ bytes.data() };
+	d2d::ReadFile(m_filePath, bytes);
+	EXPECT_EQ(data, bytes.data());
+}
+TEST_F(FileTest, MissingFilesThrow)
+{
+	std::string text;
+	EXPECT_THROW(d2d::ReadFile(m_missingPath, text), d2d::FileException);
+	EXPECT_THROW(d2d::FileToString(m_missingPath), d2d::FileException);
+	EXPECT_THROW(d2d::MappedFile{ m_missingPath }, d2d::FileException);
+	EXPECT_THROW(d2d::ReadFile(m_directory.string(), text), d2d::FileException);
+}
+TEST_F(FileTest, MappedFileViewsTheFile)
+{
+	d2d::MappedFile file{ m_filePath };
+	EXPECT_TRUE(file.IsOpen());
+	EXPECT_EQ(FILE_TEXT.size(), file.GetSize());
+	EXPECT_EQ(FILE_TEXT, file.GetText());
+	EXPECT_EQ((Uint8)'l', file.GetBytes()[0]);
+
+	d2d::MappedFile moved{ std::move(file) };
+	EXPECT_FALSE(file.IsOpen());
+	EXPECT_EQ(0u, file.GetSize());
+	EXPECT_EQ(FILE_TEXT, moved.GetText());
+
+	moved.Close();
+	EXPECT_FALSE(moved.IsOpen());
+	EXPECT_TRUE(moved.GetText().empty());
+}
+TEST_F(FileTest, LargeFilesAreMapped)
+{
+	std::string text(d2d::MIN_MAPPED_FILE_BYTES * 3 + 1, ' ');
+	for(size_t i = 0; i < text.size(); ++i)
+		text[i] = (char)('a' + i % 26);
+	const std::string filePath{ WriteFile("large.txt", text) };
+
+	d2d::MappedFile file{ filePath };
+	EXPECT_EQ(text, file.GetText());
+	d2d::MappedFile moved;
+	moved = std::move(file);
+	EXPECT_EQ(text, moved.GetText());
+	moved.Open(m_filePath);
+	EXPECT_EQ(FILE_TEXT, moved.GetText());
+}
+TEST_F(FileTest, EmptyFileMapsToEmptyView)
+{
+	d2d::MappedFile file{ WriteFile("empty.txt", "") };
+	EXPECT_TRUE(file.IsOpen());
+	EXPECT_TRUE(file.GetBytes().empty());
+	EXPECT_EQ("", d2d::FileToString(WriteFile("empty.txt", "")));
+}
+TEST_F(FileTest, HjsonParsesToTheEndOfAPageSizedMapping)
+{
+	// The mapping ends exactly on a page boundary, with nothing after the text
+	std::string text{ "{ value: 12345 }" };
+	text.resize(d2d::MIN_MAPPED_FILE_BYTES, ' ');
+	EXPECT_EQ(12345, d2d::GetInt(d2d::FileToHJSON(WriteFile("page.hjson", text)), "value"));
+}
+TEST_F(FileTest, MemoryInputStreamReadsTheView)
+{
+	d2d::MappedFile file{ m_filePath };
+	d2d::MemoryInputStream stream{ file.GetText() };
+	std::string line;
+	std::getline(stream, line);
+	EXPECT_EQ("line one\r", line);
+	std::getline(stream, line);
+	EXPECT_EQ("line two", line);
+}
+TEST_F(FileTest, PrefetchSkipsMissingFiles)
+{
+	const std::string filePaths[]{ m_filePath, m_missingPath };
+	d2d::PrefetchFiles(filePaths);
+	EXPECT_EQ(FILE_TEXT, d2d::FileToString(m_filePath));
+}
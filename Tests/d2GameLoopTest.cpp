@@ -0,0 +1,129 @@
+/**************************************************************************************\
+** File: d2GameLoopTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Headless tests for the fixed timestep GameLoop, driven with given frame times
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2GameLoop.h"
+#include <gtest/gtest.h>
+namespace
+{
+	const float STEP_SECONDS{ 1.0f / 60.0f };
+
+	// A body falling under constant acceleration, advanced only in fixed steps
+	struct FallingBody
+	{
+		float position{ 0.0f };
+		float velocity{ 0.0f };
+		void Step(float dt)
+		{
+			velocity -= 9.8f * dt;
+			position += velocity * dt;
+		}
+	};
+
+	// Runs seconds of simulated time split into frames of frameSeconds
+	FallingBody Simulate(d2d::GameLoop& loop, float seconds, float frameSeconds)
+	{
+		FallingBody body;
+		for(float elapsed = 0.0f; elapsed < seconds - 0.5f * frameSeconds; elapsed += frameSeconds)
+		{
+			loop.BeginFrame(frameSeconds);
+			while(loop.Step())
+				body.Step(loop.GetStepSeconds());
+			loop.EndFrame();
+		}
+		return body;
+	}
+}
+TEST(GameLoopTest, StepsMatchElapsedTimeAtAnyFrameRate)
+{
+	for(float frameSeconds : { 1.0f / 30.0f, 1.0f / 60.0f, 1.0f / 144.0f, 0.007f })
+	{
+		d2d::GameLoop loop;
+		Simulate(loop, 10.0f, frameSeconds);
+		EXPECT_NEAR(600.0, (double)loop.GetStats().steps, 1.0) << frameSeconds;
+		EXPECT_EQ(0u, loop.GetStats().droppedSteps);
+	}
+}
+TEST(GameLoopTest, SimulationIsIndependentOfFrameRate)
+{
+	// Power of two times, so frame boundaries land exactly on steps
+	d2d::GameLoopDef def;
+	def.stepSeconds = 1.0f / 64.0f;
+	d2d::GameLoop slowLoop{ def };
+	d2d::GameLoop fastLoop{ def };
+	const FallingBody slow{ Simulate(slowLoop, 2.0f, 1.0f / 16.0f) };
+	const FallingBody fast{ Simulate(fastLoop, 2.0f, 1.0f / 256.0f) };
+
+	// The same number of identical steps gives bit-identical results
+	ASSERT_EQ(slowLoop.GetStats().steps, fastLoop.GetStats().steps);
+	EXPECT_EQ(slow.position, fast.position);
+	EXPECT_EQ(slow.velocity, fast.velocity);
+}
+TEST(GameLoopTest, AlphaIsTheLeftoverFractionOfAStep)
+{
+	d2d::GameLoop loop;
+	loop.BeginFrame(2.5f * STEP_SECONDS);
+	unsigned numSteps{ 0 };
+	while(loop.Step())
+		++numSteps;
+	EXPECT_EQ(2u, numSteps);
+	EXPECT_EQ(2u, loop.GetStepsThisFrame());
+	EXPECT_NEAR(0.5f, loop.GetAlpha(), 1e-4f);
+
+	loop.BeginFrame(0.25f * STEP_SECONDS);
+	EXPECT_FALSE(loop.Step());
+	EXPECT_NEAR(0.75f, loop.GetAlpha(), 1e-4f);
+}
+TEST(GameLoopTest, LongFrameDropsTheBacklog)
+{
+	d2d::GameLoopDef def;
+	def.maxStepsPerFrame = 4;
+	d2d::GameLoop loop{ def };
+	loop.BeginFrame(10.25f * STEP_SECONDS);
+	unsigned numSteps{ 0 };
+	while(loop.Step())
+		++numSteps;
+	EXPECT_EQ(4u, numSteps);
+	EXPECT_EQ(6u, loop.GetStats().droppedSteps);
+	EXPECT_NEAR(0.25f, loop.GetAlpha(), 1e-3f);
+
+	// The next normal frame is not slowed down by the hitch
+	loop.BeginFrame(STEP_SECONDS);
+	numSteps = 0;
+	while(loop.Step())
+		++numSteps;
+	EXPECT_EQ(1u, numSteps);
+}
+TEST(GameLoopTest, NegativeFrameTimeIsIgnored)
+{
+	d2d::GameLoop loop;
+	loop.BeginFrame(-1.0f);
+	EXPECT_FALSE(loop.Step());
+	EXPECT_EQ(0.0f, loop.GetAlpha());
+}
+TEST(GameLoopTest, FrameLimiterHoldsTheTargetRate)
+{
+	d2d::GameLoopDef def;
+	def.targetFrameSeconds = 0.01f;
+	d2d::GameLoop loop{ def };
+	const Uint64 startTicks{ SDL_GetPerformanceCounter() };
+	for(int i = 0; i < 20; ++i)
+	{
+		loop.BeginFrame();
+		while(loop.Step());
+		loop.EndFrame();
+	}
+	const double seconds{ (double)(SDL_GetPerformanceCounter() - startTicks) / (double)SDL_GetPerformanceFrequency() };
+
+	// Never faster than the target. No upper bound on wall time, since a
+	//	loaded machine can oversleep; the limiter's own sleeping must fit in it.
+	EXPECT_GE(seconds, 0.2);
+	EXPECT_GT(loop.GetStats().sleptSeconds, 0.0);
+	EXPECT_LE(loop.GetStats().sleptSeconds, seconds);
+}
@@ -0,0 +1,90 @@
+/**************************************************************************************\
+** File: d2HjsonBench.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Benchmarks comparing HJSON struct binding with per-field getters
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Hjson.h"
+#include <benchmark/benchmark.h>
+namespace
+{
+	struct WeaponDef
+	{
+		std::string name;
+		std::string sound;
+		float damage;
+		float range;
+		float cooldown;
+		float spread;
+		int ammo;
+		int projectiles;
+		bool homing;
+		d2d::Color color;
+		static auto hjsonFields()
+		{
+			return std::make_tuple(
+				d2d::MakeHjsonField("name", &WeaponDef::name),
+				d2d::MakeHjsonField("sound", &WeaponDef::sound),
+				d2d::MakeHjsonField("damage", &WeaponDef::damage),
+				d2d::MakeHjsonField("range", &WeaponDef::range),
+				d2d::MakeHjsonField("cooldown", &WeaponDef::cooldown),
+				d2d::MakeHjsonField("spread", &WeaponDef::spread),
+				d2d::MakeHjsonField("ammo", &WeaponDef::ammo),
+				d2d::MakeHjsonField("projectiles", &WeaponDef::projectiles),
+				d2d::MakeHjsonField("homing", &WeaponDef::homing),
+				d2d::MakeHjsonField("color", &WeaponDef::color));
+		}
+	};
+	const std::string WEAPON_HJSON{ R"({
+		name: Blaster
+		sound: blaster.wav
+		damage: 12.5
+		range: 40.0
+		cooldown: 0.25
+		spread: 0.1
+		ammo: 200
+		projectiles: 3
+		homing: false
+		color: [1.0, 0.5, 0.25, 1.0]
+	})" };
+
+	// How game code loads configs today
+	void BM_HjsonGetters(benchmark::State& state)
+	{
+		const d2d::HjsonValue data{ Hjson::Unmarshal(WEAPON_HJSON.c_str(), WEAPON_HJSON.size()) };
+		for(auto _ : state)
+		{
+			WeaponDef weapon;
+			weapon.name = d2d::GetString(data, "name");
+			weapon.sound = d2d::GetString(data, "sound");
+			weapon.damage = d2d::GetFloat(data, "damage");
+			weapon.range = d2d::GetFloat(data, "range");
+			weapon.cooldown = d2d::GetFloat(data, "cooldown");
+			weapon.spread = d2d::GetFloat(data, "spread");
+			weapon.ammo = d2d::GetInt(data, "ammo");
+			weapon.projectiles = d2d::GetInt(data, "projectiles");
+			weapon.homing = d2d::GetBool(data, "homing");
+			weapon.color = d2d::GetColorFloat(data, "color");
+			benchmark::DoNotOptimize(weapon);
+		}
+		state.SetItemsProcessed(state.iterations());
+	}
+	BENCHMARK(BM_HjsonGetters);
+
+	void BM_HjsonBind(benchmark::State& state)
+	{
+		const d2d::HjsonValue data{ Hjson::Unmarshal(WEAPON_HJSON.c_str(), WEAPON_HJSON.size()) };
+		for(auto _ : state)
+		{
+			WeaponDef weapon;
+			d2d::BindHjson(data, weapon);
+			benchmark::DoNotOptimize(weapon);
+		}
+		state.SetItemsProcessed(state.iterations());
+	}
+	BENCHMARK(BM_HjsonBind);
+}
@@ -0,0 +1,99 @@
+/**************************************************************************************\
+** File: d2HjsonCacheBench.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Benchmarks comparing cached HJSON loads with parsing every file
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2HjsonCache.h"
+#include <benchmark/benchmark.h>
+namespace
+{
+	const int NUM_FILES{ 200 };
+	const int FIELDS_PER_FILE{ 40 };
+
+	// Writes NUM_FILES definition files, about 2 KiB each, once
+	const std::vector<std::string>& GetFilePaths()
+	{
+		static std::vector<std::string> filePaths;
+		if(filePaths.empty())
+		{
+			const std::filesystem::path directory{ std::filesystem::temp_directory_path() / "d2HjsonCacheBench" };
+			std::filesystem::remove_all(directory);
+			std::filesystem::create_directories(directory);
+			for(int file = 0; file < NUM_FILES; ++file)
+			{
+				filePaths.push_back((directory / ("def" + std::to_string(file) + ".hjson")).string());
+				std::ofstream outStream{ filePaths.back() };
+				outStream << "{\n\t// Definition " << file << "\n";
+				for(int field = 0; field < FIELDS_PER_FILE; ++field)
+				{
+					outStream << "\tfield" << field << ": ";
+					switch(field % 4)
+					{
+					case 0: outStream << field * file << "\n"; break;
+					case 1: outStream << field * 0.25 << "\n"; break;
+					case 2: outStream << "some text value " << field << "\n"; break;
+					default: outStream << "[" << field << ".5, 1.0, 0.5, 1.0]\n"; break;
+					}
+				}
+				outStream << "}\n";
+			}
+		}
+		return filePaths;
+	}
+	std::string GetCacheDirectory()
+	{
+		return (std::filesystem::temp_directory_path() / "d2HjsonCacheBench" / "cache").string();
+	}
+
+	// How definitions load today
+	void BM_HjsonLoadParse(benchmark::State& state)
+	{
+		const std::vector<std::string>& filePaths{ GetFilePaths() };
+		for(auto _ : state)
+			for(const std::string& filePath : filePaths)
+				benchmark::DoNotOptimize(d2d::FileToHJSON(filePath));
+		state.SetItemsProcessed(state.iterations() * NUM_FILES);
+	}
+	BENCHMARK(BM_HjsonLoadParse)->Unit(benchmark::kMillisecond);
+
+	// First run: every file is parsed and its cache file written
+	void BM_HjsonLoadCacheCold(benchmark::State& state)
+	{
+		const std::vector<std::string>& filePaths{ GetFilePaths() };
+		for(auto _ : state)
+		{
+			state.PauseTiming();
+			std::filesystem::remove_all(GetCacheDirectory());
+			state.ResumeTiming();
+			d2d::HjsonCache cache{ GetCacheDirectory() };
+			for(const std::string& filePath : filePaths)
+				benchmark::DoNotOptimize(cache.Load(filePath));
+		}
+		state.SetItemsProcessed(state.iterations() * NUM_FILES);
+	}
+	BENCHMARK(BM_HjsonLoadCacheCold)->Unit(benchmark::kMillisecond);
+
+	// Later runs: nothing changed
+	void BM_HjsonLoadCacheWarm(benchmark::State& state)
+	{
+		const std::vector<std::string>& filePaths{ GetFilePaths() };
+		{
+			d2d::HjsonCache cache{ GetCacheDirectory() };
+			for(const std::string& filePath : filePaths)
+				cache.Load(filePath);
+		}
+		for(auto _ : state)
+		{
+			d2d::HjsonCache cache{ GetCacheDirectory() };
+			for(const std::string& filePath : filePaths)
+				benchmark::DoNotOptimize(cache.Load(filePath));
+		}
+		state.SetItemsProcessed(state.iterations() * NUM_FILES);
+	}
+	BENCHMARK(BM_HjsonLoadCacheWarm)->Unit(benchmark::kMillisecond);
+}
@@ -0,0 +1,144 @@
+/**************************************************************************************\
+** File: d2HjsonCacheTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Tests for the binary HJSON cache
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2HjsonCache.h"
+#include "d2Utility.h"
+#include <gtest/gtest.h>
+namespace
+{
+	const std::string CONFIG_HJSON{ R"({
+		// Comments are dropped
+		zebra: first key
+		count: 42
+		speed: 2.5
+		enabled: true
+		nothing: null
+		list: [1, "two", [3.0], { nested: "yes" }]
+		apple: last key
+	})" };
+
+	d2d::HjsonValue Parse(const std::string& text)
+	{
+		return Hjson::Unmarshal(text.c_str(), text.size());
+	}
+	class HjsonCacheTest : public ::testing::Test
+	{
+	protected:
+		HjsonCacheTest()
+			: m_directory{ std::filesystem::temp_directory_path() / "d2HjsonCacheTest" }
+		{
+			std::filesystem::remove_all(m_directory);
+			std::filesystem::create_directories(m_directory);
+			m_filePath = (m_directory / "config.hjson").string();
+			m_cacheDirectory = (m_directory / "cache").string();
+			WriteFile(CONFIG_HJSON);
+		}
+		~HjsonCacheTest()
+		{
+			std::filesystem::remove_all(m_directory);
+		}
+		void WriteFile(const std::string& text)
+		{
+			std::ofstream{ m_filePath, std::ios::binary | std::ios::trunc } << text;
+		}
+		void AddToModifiedTime(std::chrono::seconds seconds)
+		{
+			std::filesystem::last_write_time(m_filePath, std::filesystem::last_write_time(m_filePath) + seconds);
+		}
+
+		std::filesystem::path m_directory;
+		std::string m_filePath;
+		std::string m_cacheDirectory;
+	};
+}
+TEST(HjsonBinaryTest, RoundTripKeepsTypesAndOrder)
+{
+	const d2d::HjsonValue original{ Parse(CONFIG_HJSON) };
+	std::vector<Uint8> buffer;
+	d2d::WriteHjsonBinary(original, buffer);
+	const d2d::HjsonValue copy{ d2d::ReadHjsonBinary(buffer) };
+
+	EXPECT_TRUE(original.deep_equal(copy));
+	EXPECT_EQ(Hjson::Type::Int64, copy["count"].type());
+	EXPECT_EQ(Hjson::Type::Double, copy["list"][2][0].type());
+	EXPECT_EQ(Hjson::Type::Null, copy["nothing"].type());
+	EXPECT_EQ("zebra", copy.key(0));
+	EXPECT_EQ("apple", copy.key((int)copy.size() - 1));
+}
+TEST(HjsonBinaryTest, BadDataThrows)
+{
+	std::vector<Uint8> buffer;
+	d2d::WriteHjsonBinary(Parse(CONFIG_HJSON), buffer);
+	for(size_t size : { (size_t)0, (size_t)1, buffer.size() / 2, buffer.size() - 1 })
+		EXPECT_THROW(d2d::ReadHjsonBinary({ buffer.data(), size }), d2d::SerializationException) << size;
+
+	buffer.push_back(0);
+	EXPECT_THROW(d2d::ReadHjsonBinary(buffer), d2d::SerializationException);
+
+	// A vector claiming more elements than there are bytes
+	const std::vector<Uint8> hugeCount{ (Uint8)Hjson::Type::Vector, 0xFF, 0xFF, 0xFF, 0x7F };
+	EXPECT_THROW(d2d::ReadHjsonBinary(hugeCount), d2d::SerializationException);
+}
+TEST_F(HjsonCacheTest, SecondLoadHitsCache)
+{
+	{
+		d2d::HjsonCache cache{ m_cacheDirectory };
+		EXPECT_TRUE(Parse(CONFIG_HJSON).deep_equal(cache.Load(m_filePath)));
+		EXPECT_EQ(1u, cache.GetStats().misses);
+	}
+	// A new cache, as on the next run
+	d2d::HjsonCache cache{ m_cacheDirectory };
+	EXPECT_TRUE(Parse(CONFIG_HJSON).deep_equal(cache.Load(m_filePath)));
+	EXPECT_EQ(1u, cache.GetStats().hits);
+	EXPECT_EQ(0u, cache.GetStats().misses);
+}
+TEST_F(HjsonCacheTest, ChangedFileIsReparsed)
+{
+	d2d::HjsonCache cache{ m_cacheDirectory };
+	cache.Load(m_filePath);
+	WriteFile("{ count: 7 }");
+	AddToModifiedTime(std::chrono::seconds{ 2 });
+	EXPECT_EQ(7, d2d::GetInt(cache.Load(m_filePath), "count"));
+	EXPECT_EQ(2u, cache.GetStats().misses);
+	EXPECT_EQ(7, d2d::GetInt(cache.Load(m_filePath), "count"));
+	EXPECT_EQ(1u, cache.GetStats().hits);
+}
+TEST_F(HjsonCacheTest, TouchedFileIsMatchedByContent)
+{
+	d2d::HjsonCache cache{ m_cacheDirectory };
+	cache.Load(m_filePath);
+	AddToModifiedTime(std::chrono::seconds{ 2 });
+	EXPECT_TRUE(Parse(CONFIG_HJSON).deep_equal(cache.Load(m_filePath)));
+	EXPECT_EQ(1u, cache.GetStats().rehashedHits);
+
+	// The new time was recorded
+	cache.Load(m_filePath);
+	EXPECT_EQ(1u, cache.GetStats().hits);
+	EXPECT_EQ(1u, cache.GetStats().misses);
+}
+TEST_F(HjsonCacheTest, CorruptCacheIsReparsed)
+{
+	d2d::HjsonCache cache{ m_cacheDirectory };
+	cache.Load(m_filePath);
+	for(const auto& entry : std::filesystem::directory_iterator{ m_cacheDirectory })
+		std::filesystem::resize_file(entry.path(), std::filesystem::file_size(entry.path()) / 2);
+
+	EXPECT_TRUE(Parse(CONFIG_HJSON).deep_equal(cache.Load(m_filePath)));
+	EXPECT_EQ(2u, cache.GetStats().misses);
+	cache.Load(m_filePath);
+	EXPECT_EQ(1u, cache.GetStats().hits);
+}
+TEST_F(HjsonCacheTest, MissingFileThrowsLikeFileToHJSON)
+{
+	d2d::HjsonCache cache{ m_cacheDirectory };
+	const std::string missingPath{ (m_directory / "missing.hjson").string() };
+	EXPECT_THROW(d2d::FileToHJSON(missingPath), d2d::FileException);
+	EXPECT_THROW(cache.Load(missingPath), d2d::FileException);
+}
@@ -0,0 +1,202 @@
+/**************************************************************************************\
+** File: d2HjsonTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Tests for binding HJSON maps to structs
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Hjson.h"
+#include "d2Utility.h"
+#include <gtest/gtest.h>
+namespace
+{
+	struct EngineDef
+	{
+		float thrust;
+		int heat{ 7 };
+		static auto hjsonFields()
+		{
+			return std::make_tuple(
+				d2d::MakeHjsonField("thrust", &EngineDef::thrust),
+				d2d::MakeOptionalHjsonField("heat", &EngineDef::heat));
+		}
+	};
+	struct ShipDef
+	{
+		std::string name;
+		float maxSpeed;
+		double mass;
+		unsigned health;
+		bool canWarp{ false };
+		b2Vec2 size;
+		d2d::Color color;
+		d2d::Color trailColor;
+		std::vector<b2Vec2> waypoints;
+		EngineDef engine;
+		static auto hjsonFields()
+		{
+			return std::make_tuple(
+				d2d::MakeHjsonField("name", &ShipDef::name),
+				d2d::MakeHjsonField("maxSpeed", &ShipDef::maxSpeed),
+				d2d::MakeHjsonField("mass", &ShipDef::mass),
+				d2d::MakeHjsonField("health", &ShipDef::health),
+				d2d::MakeOptionalHjsonField("canWarp", &ShipDef::canWarp),
+				d2d::MakeHjsonField("size", &ShipDef::size),
+				d2d::MakeHjsonField("color", &ShipDef::color),
+				d2d::MakeHjsonIntColorField("trailColor", &ShipDef::trailColor),
+				d2d::MakeHjsonField("waypoints", &ShipDef::waypoints),
+				d2d::MakeHjsonField("engine", &ShipDef::engine));
+		}
+	};
+	struct IntegerDef
+	{
+		Uint8 alpha{ 1 };
+		unsigned count{ 2 };
+		Sint16 offset{ 3 };
+		Uint64 id{ 4 };
+		static auto hjsonFields()
+		{
+			return std::make_tuple(
+				d2d::MakeHjsonField("alpha", &IntegerDef::alpha),
+				d2d::MakeHjsonField("count", &IntegerDef::count),
+				d2d::MakeHjsonField("offset", &IntegerDef::offset),
+				d2d::MakeHjsonField("id", &IntegerDef::id));
+		}
+	};
+	const char SHIP_HJSON[]{ R"({
+		name: Viper
+		maxSpeed: 12.5
+		mass: 3
+		health: 100
+		size: [2, 1.5]
+		color: [1.0, 0.5, 0.25, 1.0]
+		trailColor: [255, 0, 51, 255]
+		waypoints: [[0, 0], [1, 2], [3, 4]]
+		engine: { thrust: 40.5 }
+		unusedKey: ignored
+	})" };
+
+	d2d::HjsonValue Parse(const std::string& text)
+	{
+		return Hjson::Unmarshal(text.c_str(), text.size());
+	}
+	std::string GetBindError(const std::string& text)
+	{
+		ShipDef ship;
+		try
+		{
+			d2d::BindHjson(Parse(text), ship);
+		}
+		catch(const d2d::HjsonFailedQueryException& e)
+		{
+			return e.what();
+		}
+		return {};
+	}
+}
+TEST(HjsonTest, BindFillsEveryField)
+{
+	ShipDef ship;
+	d2d::BindHjson(Parse(SHIP_HJSON), ship);
+	EXPECT_EQ("Viper", ship.name);
+	EXPECT_EQ(12.5f, ship.maxSpeed);
+	EXPECT_EQ(3.0, ship.mass);
+	EXPECT_EQ(100u, ship.health);
+	EXPECT_FALSE(ship.canWarp);
+	EXPECT_EQ(2.0f, ship.size.x);
+	EXPECT_EQ(1.5f, ship.size.y);
+	EXPECT_EQ(0.5f, ship.color.green);
+	EXPECT_EQ(0.25f, ship.color.blue);
+	EXPECT_EQ(1.0f, ship.trailColor.red);
+	EXPECT_FLOAT_EQ(0.2f, ship.trailColor.blue);
+	ASSERT_EQ(3u, ship.waypoints.size());
+	EXPECT_EQ(4.0f, ship.waypoints[2].y);
+	EXPECT_EQ(40.5f, ship.engine.thrust);
+	EXPECT_EQ(7, ship.engine.heat);
+}
+TEST(HjsonTest, BindMatchesPerFieldGetters)
+{
+	const d2d::HjsonValue data{ Parse(SHIP_HJSON) };
+	ShipDef ship;
+	d2d::BindHjson(data, ship);
+	EXPECT_EQ(d2d::GetString(data, "name"), ship.name);
+	EXPECT_EQ(d2d::GetFloat(data, "maxSpeed"), ship.maxSpeed);
+	EXPECT_EQ(d2d::GetColorFloat(data, "color").alpha, ship.color.alpha);
+	EXPECT_EQ(d2d::GetColorInt(data, "trailColor").blue, ship.trailColor.blue);
+}
+TEST(HjsonTest, OptionalFieldsOverride)
+{
+	ShipDef ship;
+	d2d::BindHjson(Parse(std::string{ SHIP_HJSON }.replace(1, 0, "canWarp: true\n")), ship);
+	EXPECT_TRUE(ship.canWarp);
+
+	EngineDef engine;
+	d2d::BindHjson(Parse("{ thrust: 1, heat: 3 }"), engine);
+	EXPECT_EQ(3, engine.heat);
+}
+TEST(HjsonTest, AllErrorsAreReportedTogether)
+{
+	const std::string error{ GetBindError(R"({
+		name: 5
+		maxSpeed: fast
+		mass: null
+		health: 100
+		size: [1]
+		color: [1, 0, 0, 1]
+		trailColor: [1.5, 0, 0, 1]
+		waypoints: [[0, 0], [1, "x"]]
+		engine: { heat: 2.5 }
+	})") };
+	EXPECT_NE(std::string::npos, error.find("name is integer, expected string"));
+	EXPECT_NE(std::string::npos, error.find("maxSpeed is string, expected number"));
+	EXPECT_NE(std::string::npos, error.find("mass is missing"));
+	EXPECT_NE(std::string::npos, error.find("size is array, expected [x, y]"));
+	EXPECT_NE(std::string::npos, error.find("trailColor is array"));
+	EXPECT_NE(std::string::npos, error.find("waypoints[1] is array"));
+	EXPECT_NE(std::string::npos, error.find("engine.thrust is missing"));
+	EXPECT_NE(std::string::npos, error.find("engine.heat is number, expected integer"));
+	EXPECT_EQ(std::string::npos, error.find("health"));
+	EXPECT_EQ(std::string::npos, error.find("color is"));
+}
+TEST(HjsonTest, OutOfRangeIntegersAreMismatches)
+{
+	IntegerDef integers;
+	d2d::BindHjson(Parse("{ alpha: 255, count: 4294967295, offset: -32768, id: 0 }"), integers);
+	EXPECT_EQ(255, integers.alpha);
+	EXPECT_EQ(4294967295u, integers.count);
+	EXPECT_EQ(-32768, integers.offset);
+
+	const d2d::HjsonValue data{ Parse("{ alpha: 300, count: -1, offset: 32768, id: -5 }") };
+	std::string error;
+	IntegerDef unchanged;
+	try
+	{
+		d2d::BindHjson(data, unchanged);
+	}
+	catch(const d2d::HjsonFailedQueryException& e)
+	{
+		error = e.what();
+	}
+	EXPECT_NE(std::string::npos, error.find("alpha is integer, expected integer from 0 to 255"));
+	EXPECT_NE(std::string::npos, error.find("count is integer, expected integer from 0 to 4294967295"));
+	EXPECT_NE(std::string::npos, error.find("offset is integer, expected integer from -32768 to 32767"));
+	EXPECT_NE(std::string::npos, error.find("id is integer, expected integer from 0"));
+	EXPECT_EQ(1, unchanged.alpha);
+	EXPECT_EQ(2u, unchanged.count);
+	EXPECT_EQ(3, unchanged.offset);
+	EXPECT_EQ(4u, unchanged.id);
+}
+TEST(HjsonTest, NonMapRootIsAnError)
+{
+	EXPECT_NE(std::string::npos, GetBindError("[1, 2]").find("root is array, expected map"));
+}
+TEST(HjsonTest, GetMemberValueThrowsOnMissing)
+{
+	const d2d::HjsonValue data{ Parse("{ a: 1, b: null }") };
+	EXPECT_EQ(1, d2d::GetInt(data, "a"));
+	EXPECT_THROW(d2d::GetMemberValue(data, "b"), d2d::HjsonFailedQueryException);
+	EXPECT_THROW(d2d::GetMemberValue(data, "c"), d2d::HjsonFailedQueryException);
+}
@@ -0,0 +1,189 @@
+/**************************************************************************************\
+** File: d2NetworkTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Tests for NetworkReactor over loopback TCP
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Network.h"
+#include <gtest/gtest.h>
+namespace
+{
+	const Uint16 TEST_PORT{ 47321 };
+
+	class NetworkReactorTest : public ::testing::Test
+	{
+	protected:
+		static void SetUpTestSuite() { ASSERT_EQ(0, SDLNet_Init()); }
+		static void TearDownTestSuite() { SDLNet_Quit(); }
+
+		NetworkReactorTest()
+			: m_reactor{ TEST_PORT, 8, {
+				[this](d2d::ConnectionID id) { connected.push_back(id); },
+				[this](d2d::ConnectionID id, const d2d::NetworkMessage& message) { OnMessage(id, message); },
+				[this](d2d::ConnectionID id) { disconnected.push_back(id); } } }
+		{}
+
+		// Polls until done() or about two seconds have passed
+		template <typename Predicate> bool PollUntil(Predicate done)
+		{
+			for(int i = 0; i < 200 && !done(); ++i)
+				m_reactor.Poll(10);
+			return done();
+		}
+		TCPsocket OpenRawSocket()
+		{
+			IPaddress address;
+			if(SDLNet_ResolveHost(&address, "127.0.0.1", TEST_PORT) == -1)
+				return nullptr;
+			return SDLNet_TCP_Open(&address);
+		}
+		void OnMessage(d2d::ConnectionID id, const d2d::NetworkMessage& message)
+		{
+			received.push_back(id);
+			if(throwOnMessage)
+				throw std::runtime_error{ "callback failed" };
+			if(echoMessages)
+				m_reactor.Send(id, message);
+		}
+
+		d2d::NetworkReactor m_reactor;
+		std::vector<d2d::ConnectionID> connected;
+		std::vector<d2d::ConnectionID> received;
+		std::vector<d2d::ConnectionID> disconnected;
+		bool throwOnMessage{ false };
+		bool echoMessages{ false };
+	};
+	const Uint8 MESSAGE_BYTES[]{ 1, 2, 3 };
+}
+TEST_F(NetworkReactorTest, MalformedFrameDropsOnlyThatConnection)
+{
+	d2d::ClientTcpSocket good{ "127.0.0.1", TEST_PORT };
+	TCPsocket bad{ OpenRawSocket() };
+	ASSERT_NE(nullptr, bad);
+	ASSERT_TRUE(PollUntil([&] { return connected.size() == 2; }));
+
+	// Header byte 0x03: an empty payload of frame type 3, which does not exist
+	const Uint8 unknownFrame[]{ 0x03 };
+	SDLNet_TCP_Send(bad, unknownFrame, sizeof(unknownFrame));
+	good.Send(d2d::NetworkMessage{ MESSAGE_BYTES, sizeof(MESSAGE_BYTES) });
+
+	EXPECT_NO_THROW(PollUntil([&] { return disconnected.size() == 1 && received.size() == 1; }));
+	EXPECT_EQ(1u, disconnected.size());
+	EXPECT_EQ(1u, received.size());
+	EXPECT_EQ(1u, m_reactor.GetConnectionCount());
+	EXPECT_NE(received.front(), disconnected.front());
+	SDLNet_TCP_Close(bad);
+}
+TEST_F(NetworkReactorTest, ThrowingCallbackDropsThatConnection)
+{
+	d2d::ClientTcpSocket client{ "127.0.0.1", TEST_PORT };
+	ASSERT_TRUE(PollUntil([&] { return connected.size() == 1; }));
+	throwOnMessage = true;
+	client.Send(d2d::NetworkMessage{ MESSAGE_BYTES, sizeof(MESSAGE_BYTES) });
+	EXPECT_NO_THROW(PollUntil([&] { return disconnected.size() == 1; }));
+	EXPECT_EQ(1u, disconnected.size());
+	EXPECT_EQ(0u, m_reactor.GetConnectionCount());
+}
+TEST_F(NetworkReactorTest, DisconnectAfterFailedPollIsImmediate)
+{
+	TCPsocket bad{ OpenRawSocket() };
+	d2d::ClientTcpSocket good{ "127.0.0.1", TEST_PORT };
+	ASSERT_TRUE(PollUntil([&] { return connected.size() == 2; }));
+	const Uint8 unknownFrame[]{ 0x03 };
+	SDLNet_TCP_Send(bad, unknownFrame, sizeof(unknownFrame));
+	ASSERT_TRUE(PollUntil([&] { return disconnected.size() == 1; }));
+
+	// Poll must have left its polling state, so this closes right away
+	//	instead of being queued for a Poll that may never come
+	const d2d::ConnectionID remaining{ connected[0] == disconnected[0] ? connected[1] : connected[0] };
+	m_reactor.Disconnect(remaining);
+	EXPECT_EQ(2u, disconnected.size());
+	SDLNet_TCP_Close(bad);
+}
+TEST_F(NetworkReactorTest, FramesBufferedBeforeCloseAreDispatched)
+{
+	TCPsocket client{ OpenRawSocket() };
+	ASSERT_NE(nullptr, client);
+	ASSERT_TRUE(PollUntil([&] { return connected.size() == 1; }));
+
+	// Two DATA frames, then the peer closes
+	const Uint8 frames[]{ 3 << 2, 1, 2, 3, 3 << 2, 4, 5, 6 };
+	SDLNet_TCP_Send(client, frames, sizeof(frames));
+	SDLNet_TCP_Close(client);
+	ASSERT_TRUE(PollUntil([&] { return disconnected.size() == 1; }));
+	EXPECT_EQ(2u, received.size());
+}
+TEST_F(NetworkReactorTest, PingIsAnsweredWithoutReachingOnMessage)
+{
+	d2d::ClientTcpSocket unconnected;
+	unconnected.SendPing();
+	EXPECT_EQ(0u, unconnected.GetStats().pingsSent);
+
+	d2d::ClientTcpSocket client{ "127.0.0.1", TEST_PORT };
+	ASSERT_TRUE(PollUntil([&] { return connected.size() == 1; }));
+	client.SendPing();
+	EXPECT_EQ(1u, client.GetStats().pingsSent);
+
+	// The reactor answers the PING, and the client consumes the PONG, inside their receive paths
+	d2d::NetworkMessage message;
+	unsigned clientMessages{ 0 };
+	ASSERT_TRUE(PollUntil([&]
+	{
+		while(client.Receive(message))
+			++clientMessages;
+		return client.GetStats().pongsReceived == 1;
+	}));
+	EXPECT_GT(client.GetStats().roundTripMilliseconds, 0.0f);
+	EXPECT_EQ(0u, clientMessages);
+	EXPECT_TRUE(received.empty());
+	EXPECT_EQ(0u, client.GetStats().messagesReceived);
+	EXPECT_EQ(0u, m_reactor.GetStats(connected.front()).messagesReceived);
+}
+TEST_F(NetworkReactorTest, CompressedMessagesRoundTripOnceBothSidesAgree)
+{
+	const size_t THRESHOLD_BYTES{ 64 };
+	d2d::ClientTcpSocket client{ "127.0.0.1", TEST_PORT };
+	ASSERT_TRUE(PollUntil([&] { return connected.size() == 1; }));
+	d2d::NetworkMessage message;
+
+	// Only the client has enabled compression, so HELLOs leave it inactive
+	client.SetCompression(true, THRESHOLD_BYTES);
+	for(int i = 0; i < 20; ++i)
+	{
+		m_reactor.Poll(10);
+		client.Receive(message);
+	}
+	EXPECT_FALSE(client.IsCompressionActive());
+
+	m_reactor.SetCompression(true, THRESHOLD_BYTES);
+	ASSERT_TRUE(PollUntil([&] { client.Receive(message); return client.IsCompressionActive(); }));
+
+	// Repetitive, so compressing saves space; and above the threshold
+	std::vector<Uint8> payload(2000);
+	for(size_t i = 0; i < payload.size(); ++i)
+		payload[i] = (Uint8)('a' + i % 13);
+	echoMessages = true;
+	ASSERT_TRUE(client.Send(payload));
+	unsigned numEchoes{ 0 };
+	ASSERT_TRUE(PollUntil([&]
+	{
+		while(client.Receive(message))
+			++numEchoes;
+		return numEchoes == 1;
+	}));
+	ASSERT_EQ(payload.size(), message.GetSize());
+	EXPECT_TRUE(std::equal(payload.begin(), payload.end(), message.GetPayload().begin()));
+
+	const d2d::SocketStats& clientStats{ client.GetStats() };
+	const d2d::SocketStats& serverStats{ m_reactor.GetStats(connected.front()) };
+	EXPECT_EQ(1u, clientStats.compressedMessagesSent);
+	EXPECT_EQ(1u, clientStats.compressedMessagesReceived);
+	EXPECT_EQ(1u, serverStats.compressedMessagesSent);
+	EXPECT_EQ(1u, serverStats.compressedMessagesReceived);
+	EXPECT_LT(clientStats.bytesAfterCompression, clientStats.bytesBeforeCompression);
+	EXPECT_EQ(1u, received.size());
+}
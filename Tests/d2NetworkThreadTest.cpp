@@ -0,0 +1,108 @@
+/**************************************************************************************\
+** File: d2NetworkThreadTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Tests for NetworkThread against a loopback echo server
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2NetworkThread.h"
+#include <gtest/gtest.h>
+namespace
+{
+	const Uint16 TEST_PORT{ 47322 };
+
+	class NetworkThreadTest : public ::testing::Test
+	{
+	protected:
+		static void SetUpTestSuite() { ASSERT_EQ(0, SDLNet_Init()); }
+		static void TearDownTestSuite() { SDLNet_Quit(); }
+
+		NetworkThreadTest()
+			: m_server{ TEST_PORT, 4, {
+				[this](d2d::ConnectionID id) { m_clientID = id; },
+				[this](d2d::ConnectionID id, const d2d::NetworkMessage& message) { m_server.Send(id, message); },
+				[](d2d::ConnectionID) {} } }
+		{}
+
+		// Polls the server until done() or about two seconds have passed
+		template <typename Predicate> bool PollUntil(Predicate done)
+		{
+			for(int i = 0; i < 400 && !done(); ++i)
+				m_server.Poll(5);
+			return done();
+		}
+		std::unique_ptr<d2d::NetworkThread> Connect(const d2d::NetworkThreadDef& def = d2d::NetworkThreadDef{})
+		{
+			auto threadPtr{ std::make_unique<d2d::NetworkThread>(
+				std::make_unique<d2d::ClientTcpSocket>("127.0.0.1", TEST_PORT), def) };
+			EXPECT_TRUE(PollUntil([&] { return m_server.GetConnectionCount() == 1; }));
+			return threadPtr;
+		}
+
+		d2d::NetworkReactor m_server;
+		d2d::ConnectionID m_clientID{ 0 };
+	};
+}
+TEST_F(NetworkThreadTest, MessagesAreEchoedInOrder)
+{
+	auto threadPtr{ Connect() };
+	const unsigned numMessages{ 200 };
+	for(Uint32 i = 0; i < numMessages; ++i)
+	{
+		d2d::NetworkMessage message{ &i, sizeof(i) };
+		ASSERT_TRUE(threadPtr->Send(message));
+		EXPECT_EQ(0u, message.GetSize());
+	}
+	std::vector<Uint32> echoed;
+	d2d::NetworkMessage received;
+	PollUntil([&] {
+		while(threadPtr->Receive(received))
+		{
+			Uint32 value;
+			std::memcpy(&value, received.GetPayload().data(), sizeof(value));
+			echoed.push_back(value);
+		}
+		return echoed.size() == numMessages;
+	});
+	ASSERT_EQ(numMessages, echoed.size());
+	for(Uint32 i = 0; i < numMessages; ++i)
+		EXPECT_EQ(i, echoed[i]);
+
+	const d2d::NetworkThreadStats stats{ threadPtr->GetStats() };
+	EXPECT_EQ(numMessages, stats.messagesSent);
+	EXPECT_EQ(numMessages, stats.messagesReceived);
+}
+TEST_F(NetworkThreadTest, FullSendQueueRejectsAndCounts)
+{
+	d2d::NetworkThreadDef def;
+	def.queueCapacity = 4;
+	def.waitMilliseconds = 50;
+	auto threadPtr{ Connect(def) };
+
+	// The worker drains between sends, so keep pushing until one is refused
+	const Uint8 bytes[]{ 1, 2, 3 };
+	d2d::NetworkMessage message;
+	bool refused{ false };
+	for(int i = 0; i < 100000 && !refused; ++i)
+	{
+		message = d2d::NetworkMessage{ bytes, sizeof(bytes) };
+		refused = !threadPtr->Send(message);
+	}
+	ASSERT_TRUE(refused);
+	EXPECT_EQ(sizeof(bytes), message.GetSize());
+	EXPECT_GE(threadPtr->GetStats().sendQueueFullCount, 1u);
+}
+TEST_F(NetworkThreadTest, WorkerStopsWhenServerDisconnects)
+{
+	auto threadPtr{ Connect() };
+	m_server.Disconnect(m_clientID);
+	for(int i = 0; i < 400 && threadPtr->IsConnected(); ++i)
+		SDL_Delay(5);
+	EXPECT_FALSE(threadPtr->IsConnected());
+
+	d2d::NetworkMessage message{ &m_clientID, sizeof(m_clientID) };
+	EXPECT_FALSE(threadPtr->Send(message));
+}
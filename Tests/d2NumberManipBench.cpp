@@ -0,0 +1,100 @@
+/**************************************************************************************\
+** File: d2NumberManipBench.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Benchmarks for the batch number manipulation functions
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2NumberManip.h"
+#include "d2Range.h"
+#include "d2Simd.h"
+#include <benchmark/benchmark.h>
+namespace
+{
+	std::vector<float> MakeValues(size_t count)
+	{
+		std::mt19937 engine{ 1 };
+		std::uniform_real_distribution<float> distribution{ -1000.0f, 1000.0f };
+		std::vector<float> values(count);
+		for(float& value : values)
+			value = distribution(engine);
+		return values;
+	}
+
+	// Arg 0 is the value count. Arg 1 selects the path: 0 scalar loop, 1 SSE2, 2 AVX
+	void SelectPath(benchmark::State& state)
+	{
+		d2d::SetAVXEnabled(state.range(1) == 2);
+		if(state.range(1) == 2 && !d2d::CpuHasAVX())
+			state.SkipWithError("CPU has no AVX");
+	}
+	void ApplyArgs(benchmark::internal::Benchmark* benchmark)
+	{
+		benchmark->ArgNames({ "count", "path" });
+		for(long count : { 1024, 65536 })
+			for(long path : { 0, 1, 2 })
+				benchmark->Args({ count, path });
+	}
+
+	void BM_WrapFloats(benchmark::State& state)
+	{
+		SelectPath(state);
+		const std::vector<float> source{ MakeValues((size_t)state.range(0)) };
+		const d2d::Range<float> range{ -3.0f, 7.0f };
+		std::vector<float> values(source.size());
+		for(auto _ : state)
+		{
+			// Wrapped values would stay in range, so rewrap the source each
+			//	time. The copy is timed on every path.
+			std::copy(source.begin(), source.end(), values.begin());
+			if(state.range(1) == 0)
+				for(float& value : values)
+					d2d::WrapFloat(value, range);
+			else
+				d2d::WrapFloats(values, range);
+			benchmark::DoNotOptimize(values.data());
+		}
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+	}
+	BENCHMARK(BM_WrapFloats)->Apply(ApplyArgs);
+
+	void BM_ClampFloats(benchmark::State& state)
+	{
+		SelectPath(state);
+		std::vector<float> values{ MakeValues((size_t)state.range(0)) };
+		const d2d::Range<float> range{ -500.0f, 500.0f };
+		for(auto _ : state)
+		{
+			if(state.range(1) == 0)
+				for(float& value : values)
+					d2d::Clamp(value, range);
+			else
+				d2d::ClampFloats(values, range);
+			benchmark::DoNotOptimize(values.data());
+		}
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+	}
+	BENCHMARK(BM_ClampFloats)->Apply(ApplyArgs);
+
+	void BM_LerpFloats(benchmark::State& state)
+	{
+		SelectPath(state);
+		const std::vector<float> a{ MakeValues((size_t)state.range(0)) };
+		const std::vector<float> b{ a.rbegin(), a.rend() };
+		std::vector<float> out(a.size());
+		for(auto _ : state)
+		{
+			if(state.range(1) == 0)
+				for(size_t i = 0; i < out.size(); ++i)
+					out[i] = d2d::Lerp(a[i], b[i], 0.3f);
+			else
+				d2d::LerpFloats(a, b, 0.3f, out);
+			benchmark::DoNotOptimize(out.data());
+		}
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+	}
+	BENCHMARK(BM_LerpFloats)->Apply(ApplyArgs);
+}
@@ -0,0 +1,142 @@
+/**************************************************************************************\
+** File: d2NumberManipTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Tests for the batch number manipulation functions
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2NumberManip.h"
+#include "d2Range.h"
+#include "d2Rect.h"
+#include "d2Simd.h"
+#include <gtest/gtest.h>
+namespace
+{
+	// Run every test once on the AVX paths and once on the SSE2 paths
+	class BatchNumberManipTest : public ::testing::TestWithParam<bool>
+	{
+	protected:
+		void SetUp() override { d2d::SetAVXEnabled(GetParam()); }
+		void TearDown() override { d2d::SetAVXEnabled(true); }
+	};
+	INSTANTIATE_TEST_SUITE_P(Simd, BatchNumberManipTest, ::testing::Values(true, false),
+		[](const ::testing::TestParamInfo<bool>& info) { return info.param ? "AVX" : "SSE2"; });
+
+	// Random values, plus the cases a fast fmod gets wrong: huge magnitudes,
+	//	values one ulp either side of a multiple of the modulus, and NaN,
+	//	infinity and signed zero. 1001 values so every kernel has a tail.
+	std::vector<float> MakeWrapInputs(float low, float high)
+	{
+		const float size{ high - low };
+		std::mt19937 engine{ 12345 };
+		std::uniform_real_distribution<float> small{ -10.0f * size, 10.0f * size };
+		std::uniform_real_distribution<float> exponent{ 0.0f, 38.0f };
+		std::vector<float> values;
+		for(int i = 0; i < 400; ++i)
+			values.push_back(small(engine));
+		for(int i = 0; i < 200; ++i)
+			values.push_back((i & 1 ? -1.0f : 1.0f) * powf(10.0f, exponent(engine)));
+		for(int k = -100; k < 100; ++k)
+		{
+			float multiple{ low + (float)k * size };
+			values.push_back(nextafterf(multiple, -INFINITY));
+			values.push_back(nextafterf(multiple, INFINITY));
+		}
+		const float specials[]{ 0.0f, -0.0f, INFINITY, -INFINITY, NAN, 1e-40f, -1e-40f };
+		while(values.size() < 1001)
+			values.insert(values.end(), std::begin(specials), std::end(specials));
+		values.resize(1001);
+		return values;
+	}
+	void ExpectSameFloat(float expected, float actual, size_t index)
+	{
+		if(std::isnan(expected))
+			EXPECT_TRUE(std::isnan(actual)) << "index " << index;
+		else
+			EXPECT_EQ(expected, actual) << "index " << index;
+	}
+	void ExpectWrapFloatsMatchScalar(float low, float high)
+	{
+		std::vector<float> values{ MakeWrapInputs(low, high) };
+		std::vector<float> wrapped{ values };
+		d2d::WrapFloats(wrapped, d2d::Range<float>{ low, high });
+		for(size_t i = 0; i < values.size(); ++i)
+			ExpectSameFloat(d2d::GetWrappedFloat(values[i], d2d::Range<float>{ low, high }), wrapped[i], i);
+	}
+}
+TEST_P(BatchNumberManipTest, WrapFloatsMatchesScalar)
+{
+	ExpectWrapFloatsMatchScalar(0.0f, 1.0f);
+	ExpectWrapFloatsMatchScalar(-3.5f, 7.25f);
+	ExpectWrapFloatsMatchScalar(0.0f, d2d::TWO_PI);
+	ExpectWrapFloatsMatchScalar(100.0f, 100.1f);
+	ExpectWrapFloatsMatchScalar(-1e-30f, 1e-30f);
+	ExpectWrapFloatsMatchScalar(0.0f, 1e30f);
+}
+TEST_P(BatchNumberManipTest, WrapFloatsModulusMatchesScalar)
+{
+	std::vector<float> values{ MakeWrapInputs(0.0f, 360.0f) };
+	std::vector<float> wrapped{ values };
+	d2d::WrapDegrees(wrapped);
+	for(size_t i = 0; i < values.size(); ++i)
+		ExpectSameFloat(d2d::GetWrappedDegrees(values[i]), wrapped[i], i);
+}
+TEST_P(BatchNumberManipTest, WrapFloatsZeroSizeMatchesScalar)
+{
+	std::vector<float> values{ MakeWrapInputs(2.0f, 3.0f) };
+	std::vector<float> wrapped{ values };
+	d2d::WrapFloats(wrapped, d2d::Range<float>{ 2.0f, 2.0f });
+	for(size_t i = 0; i < values.size(); ++i)
+		ExpectSameFloat(d2d::GetWrappedFloat(values[i], d2d::Range<float>{ 2.0f, 2.0f }), wrapped[i], i);
+}
+TEST_P(BatchNumberManipTest, WrapVectorsMatchesScalar)
+{
+	const b2Vec2 low{ -5.0f, 10.0f };
+	const b2Vec2 high{ 5.0f, 10.5f };
+	std::vector<float> xs{ MakeWrapInputs(low.x, high.x) };
+	std::vector<float> ys{ MakeWrapInputs(low.y, high.y) };
+	std::vector<b2Vec2> vectors;
+	for(size_t i = 0; i < xs.size(); ++i)
+		vectors.push_back({ xs[i], ys[i] });
+	std::vector<b2Vec2> wrapped{ vectors };
+	d2d::WrapVectors(wrapped, d2d::Rect{ low, high });
+	for(size_t i = 0; i < vectors.size(); ++i)
+	{
+		b2Vec2 expected{ d2d::GetWrappedVector(vectors[i], low, high) };
+		ExpectSameFloat(expected.x, wrapped[i].x, i);
+		ExpectSameFloat(expected.y, wrapped[i].y, i);
+	}
+}
+TEST_P(BatchNumberManipTest, ClampFloatsMatchesScalar)
+{
+	const d2d::Range<float> range{ -1.0f, 2.0f };
+	std::vector<float> values{ MakeWrapInputs(-3.0f, 3.0f) };
+	values.erase(std::remove_if(values.begin(), values.end(), [](float v) { return std::isnan(v); }), values.end());
+	std::vector<float> clamped{ values };
+	d2d::ClampFloats(clamped, range);
+	for(size_t i = 0; i < values.size(); ++i)
+		EXPECT_EQ(d2d::GetClamped(values[i], range), clamped[i]) << "index " << i;
+}
+TEST_P(BatchNumberManipTest, LerpFloatsMatchesScalar)
+{
+	std::vector<float> a{ MakeWrapInputs(-100.0f, 100.0f) };
+	std::vector<float> b{ a.rbegin(), a.rend() };
+	for(float percentB : { 0.0f, 0.25f, 0.5f, 1.0f })
+	{
+		std::vector<float> out(a.size());
+		d2d::LerpFloats(a, b, percentB, out);
+		for(size_t i = 0; i < a.size(); ++i)
+			ExpectSameFloat(d2d::Lerp(a[i], b[i], percentB), out[i], i);
+	}
+}
+TEST_P(BatchNumberManipTest, EmptySpansAreNoOps)
+{
+	std::vector<float> empty;
+	d2d::WrapRadians(empty);
+	d2d::ClampFloats(empty, d2d::Range<float>{ 0.0f, 1.0f });
+	d2d::LerpFloats(empty, empty, 0.5f, empty);
+	EXPECT_TRUE(empty.empty());
+}
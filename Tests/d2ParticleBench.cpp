@@ -0,0 +1,118 @@
+/**************************************************************************************\
+** File: d2ParticleBench.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Headless benchmarks for ParticleEmitter updates at 60 Hz
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2NumberManip.h"
+#include "d2Particle.h"
+#include <benchmark/benchmark.h>
+namespace
+{
+	const unsigned NUM_PARTICLES{ 100000 };
+	const float FRAME_SECONDS{ 1.0f / 60.0f };
+
+	// Lifetimes average 1.5 s, so this spawn rate keeps the pool nearly full
+	d2d::ParticleEmitterDef MakeDef()
+	{
+		d2d::ParticleEmitterDef def;
+		def.capacity = NUM_PARTICLES;
+		def.particlesPerSecond = NUM_PARTICLES / 1.5f;
+		def.lifetimeRange = { 1.0f, 2.0f };
+		def.speedRange = { 1.0f, 5.0f };
+		def.directionRange = { 0.0f, d2d::TWO_PI };
+		def.spawnRect = { { -1.0f, -1.0f }, { 1.0f, 1.0f } };
+		def.colorRange = { d2d::WHITE_OPAQUE, d2d::COLOR_ZERO };
+		return def;
+	}
+
+	// Spawning, moving, recoloring and removing, as one frame does
+	void BM_ParticleUpdate(benchmark::State& state)
+	{
+		d2d::ParticleEmitter emitter;
+		emitter.Init(MakeDef());
+		emitter.Emit(NUM_PARTICLES);
+		for(int i = 0; i < 120; ++i)
+			emitter.Update(FRAME_SECONDS);
+		for(auto _ : state)
+			emitter.Update(FRAME_SECONDS);
+		state.counters["particles"] = (double)emitter.GetCount();
+		state.SetItemsProcessed(state.iterations() * emitter.GetCount());
+	}
+	BENCHMARK(BM_ParticleUpdate)->Unit(benchmark::kMicrosecond);
+
+	// The split path: Spawn, UpdateRange over arg threads, RemoveExpired
+	void BM_ParticleUpdateThreaded(benchmark::State& state)
+	{
+		const unsigned numThreads{ (unsigned)state.range(0) };
+		d2d::ParticleEmitter emitter;
+		emitter.Init(MakeDef());
+		emitter.Emit(NUM_PARTICLES);
+		for(auto _ : state)
+		{
+			emitter.Spawn(FRAME_SECONDS);
+			const unsigned count{ emitter.GetCount() };
+			std::vector<std::thread> threads;
+			for(unsigned t = 0; t < numThreads; ++t)
+			{
+				unsigned first{ count * t / numThreads };
+				unsigned end{ count * (t + 1) / numThreads };
+				threads.emplace_back([&emitter, first, end] { emitter.UpdateRange(FRAME_SECONDS, first, end - first); });
+			}
+			for(std::thread& thread : threads)
+				thread.join();
+			emitter.RemoveExpired();
+		}
+		state.SetItemsProcessed(state.iterations() * NUM_PARTICLES);
+	}
+	BENCHMARK(BM_ParticleUpdateThreaded)->Arg(1)->Arg(4)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+	// What games wrote before ParticleEmitter: one heap object per particle
+	struct HeapParticle
+	{
+		b2Vec2 position;
+		b2Vec2 velocity;
+		float age;
+		float lifetime;
+		d2d::Color color;
+	};
+	void BM_HeapParticleUpdate(benchmark::State& state)
+	{
+		const d2d::ParticleEmitterDef def{ MakeDef() };
+		d2d::RandomStream stream;
+		std::vector<std::unique_ptr<HeapParticle>> particles;
+		float emitAccumulator{ 0.0f };
+		auto spawn = [&](unsigned numParticles)
+		{
+			for(unsigned i = 0; i < numParticles && particles.size() < NUM_PARTICLES; ++i)
+			{
+				float speed{ stream.NextFloat(def.speedRange) };
+				float direction{ stream.NextFloat(def.directionRange) };
+				particles.push_back(std::make_unique<HeapParticle>(HeapParticle{
+					stream.NextVec2InRect(def.spawnRect), speed * d2d::GetUnitVec2FromAngle(direction),
+					0.0f, stream.NextFloat(def.lifetimeRange), def.colorRange.Lerp(0.0f) }));
+			}
+		};
+		spawn(NUM_PARTICLES);
+		for(auto _ : state)
+		{
+			emitAccumulator += FRAME_SECONDS * def.particlesPerSecond;
+			unsigned numToEmit{ (unsigned)emitAccumulator };
+			emitAccumulator -= (float)numToEmit;
+			spawn(numToEmit);
+			for(std::unique_ptr<HeapParticle>& particle : particles)
+			{
+				particle->position += FRAME_SECONDS * particle->velocity;
+				particle->age += FRAME_SECONDS;
+				particle->color = def.colorRange.Lerp(d2d::GetClampedPercent(particle->age / particle->lifetime));
+			}
+			std::erase_if(particles, [](const std::unique_ptr<HeapParticle>& particle) { return particle->age >= particle->lifetime; });
+		}
+		state.SetItemsProcessed(state.iterations() * NUM_PARTICLES);
+	}
+	BENCHMARK(BM_HeapParticleUpdate)->Unit(benchmark::kMicrosecond);
+}
@@ -0,0 +1,68 @@
+/**************************************************************************************\
+** File: d2ParticleTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Tests for ParticleEmitter
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Particle.h"
+#include <gtest/gtest.h>
+namespace
+{
+	d2d::ParticleEmitterDef MakeDef(unsigned capacity)
+	{
+		d2d::ParticleEmitterDef def;
+		def.capacity = capacity;
+		def.lifetimeRange = { 1.0f, 2.0f };
+		def.spawnRect = { { -1.0f, -1.0f }, { 1.0f, 1.0f } };
+		return def;
+	}
+}
+TEST(ParticleEmitterTest, EmitStopsAtCapacity)
+{
+	d2d::ParticleEmitter emitter;
+	emitter.Init(MakeDef(10));
+	emitter.Emit(7);
+	EXPECT_EQ(7u, emitter.GetCount());
+	emitter.Emit(7);
+	EXPECT_EQ(10u, emitter.GetCount());
+}
+TEST(ParticleEmitterTest, EmitIntoFullPoolIsNoOp)
+{
+	d2d::ParticleEmitter emitter;
+	emitter.Init(MakeDef(4));
+	emitter.Emit(4);
+	emitter.Emit(1);
+	emitter.Emit(0);
+	EXPECT_EQ(4u, emitter.GetCount());
+}
+TEST(ParticleEmitterTest, ExpiredParticlesAreRemoved)
+{
+	d2d::ParticleEmitter emitter;
+	emitter.Init(MakeDef(100));
+	emitter.SetEmitting(false);
+	emitter.Emit(100);
+	emitter.Update(0.5f);
+	EXPECT_EQ(100u, emitter.GetCount());
+	emitter.Update(2.0f);
+	EXPECT_EQ(0u, emitter.GetCount());
+}
+TEST(ParticleEmitterTest, UpdatingEmptyRangesIsNoOp)
+{
+	// Empty ranges start at the end of the pool; forming their spans must not index it
+	d2d::ParticleEmitter empty;
+	empty.Init(MakeDef(0));
+	empty.Update(0.1f);
+	empty.UpdateRange(0.1f, 0, 0);
+	EXPECT_EQ(0u, empty.GetCount());
+
+	d2d::ParticleEmitter full;
+	full.Init(MakeDef(4));
+	full.SetEmitting(false);
+	full.Emit(4);
+	full.UpdateRange(0.1f, 4, 0);
+	EXPECT_EQ(4u, full.GetCount());
+}
@@ -0,0 +1,86 @@
+/**************************************************************************************\
+** File: d2PhysicsWorldBench.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Benchmarks for PhysicsWorld substepping and stepping on the worker thread
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2PhysicsWorld.h"
+#include <benchmark/benchmark.h>
+namespace
+{
+	const float DT{ 1.0f / 60.0f };
+
+	void AddBodies(d2d::PhysicsWorld& physics, int numBodies)
+	{
+		b2BodyDef bodyDef;
+		bodyDef.type = b2_dynamicBody;
+		b2PolygonShape box;
+		box.SetAsBox(0.5f, 0.5f);
+		for(int i = 0; i < numBodies; ++i)
+		{
+			bodyDef.position.Set((float)(i % 64) * 2.0f, (float)(i / 64) * 2.0f);
+			bodyDef.linearVelocity.Set(1.0f, 0.0f);
+			b2Body* bodyPtr{ physics.GetWorld().CreateBody(&bodyDef) };
+			b2FixtureDef fixtureDef;
+			fixtureDef.shape = &box;
+			fixtureDef.density = 1.0f;
+			bodyPtr->CreateFixture(&fixtureDef);
+		}
+	}
+	// Stands in for drawing a frame from the published transforms
+	float Draw(std::span<const d2d::BodyTransform> transforms, int numPasses)
+	{
+		float sum{ 0.0f };
+		for(int pass = 0; pass < numPasses; ++pass)
+			for(const d2d::BodyTransform& transform : transforms)
+				sum += std::sin(transform.angle + (float)pass) * transform.position.x;
+		return sum;
+	}
+
+	// Arg 0 is the body count, arg 1 the substep count
+	void BM_PhysicsStep(benchmark::State& state)
+	{
+		d2d::PhysicsWorldDef def;
+		def.gravity.Set(0.0f, -10.0f);
+		def.subSteps = (unsigned)state.range(1);
+		d2d::PhysicsWorld physics{ def };
+		AddBodies(physics, (int)state.range(0));
+		for(auto _ : state)
+			physics.Step(DT);
+		state.SetItemsProcessed(state.iterations());
+	}
+	BENCHMARK(BM_PhysicsStep)->ArgNames({ "bodies", "subSteps" })
+		->Args({ 1024, 1 })->Args({ 1024, 4 });
+
+	// A whole frame: a step plus drawing. Arg 0 is the body count, arg 1
+	//	is 0 to step then draw, 1 to draw while the worker steps.
+	void BM_PhysicsFrame(benchmark::State& state)
+	{
+		d2d::PhysicsWorldDef def;
+		def.gravity.Set(0.0f, -10.0f);
+		def.subSteps = 4;
+		d2d::PhysicsWorld physics{ def };
+		AddBodies(physics, (int)state.range(0));
+		physics.Step(DT);
+		const bool async{ state.range(1) != 0 };
+		for(auto _ : state)
+		{
+			if(async)
+			{
+				physics.WaitForStep();
+				physics.StepAsync(DT);
+			}
+			else
+				physics.Step(DT);
+			benchmark::DoNotOptimize(Draw(physics.GetTransforms(), 8));
+		}
+		physics.WaitForStep();
+		state.SetItemsProcessed(state.iterations());
+	}
+	BENCHMARK(BM_PhysicsFrame)->ArgNames({ "bodies", "async" })
+		->Args({ 1024, 0 })->Args({ 1024, 1 })->UseRealTime();
+}
@@ -0,0 +1,130 @@
+/**************************************************************************************\
+** File: d2PhysicsWorldTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Tests for PhysicsWorld substepping and threaded stepping
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2PhysicsWorld.h"
+#include <gtest/gtest.h>
+namespace
+{
+	const b2Vec2 GRAVITY{ 0.0f, -10.0f };
+	const float DT{ 1.0f / 60.0f };
+
+	b2Body* AddBody(b2World& world, float x)
+	{
+		b2BodyDef bodyDef;
+		bodyDef.type = b2_dynamicBody;
+		bodyDef.position.Set(x, 0.0f);
+		bodyDef.linearVelocity.Set(1.0f, 0.0f);
+		return world.CreateBody(&bodyDef);
+	}
+	d2d::PhysicsWorldDef MakeDef(unsigned subSteps)
+	{
+		d2d::PhysicsWorldDef def;
+		def.gravity = GRAVITY;
+		def.subSteps = subSteps;
+		return def;
+	}
+}
+TEST(PhysicsWorldTest, SubstepsMatchSmallerWorldSteps)
+{
+	d2d::PhysicsWorld physics{ MakeDef(4) };
+	b2World reference{ GRAVITY };
+	b2Body* bodyPtr{ AddBody(physics.GetWorld(), 0.0f) };
+	b2Body* referencePtr{ AddBody(reference, 0.0f) };
+	for(int i = 0; i < 30; ++i)
+	{
+		bodyPtr->ApplyForceToCenter({ 5.0f, 0.0f }, true);
+		referencePtr->ApplyForceToCenter({ 5.0f, 0.0f }, true);
+		physics.Step(DT);
+
+		// Box2D clears forces after every step, so the force is reapplied per substep
+		reference.SetAutoClearForces(false);
+		for(int j = 0; j < 4; ++j)
+			reference.Step(DT / 4.0f, 8, 3);
+		reference.ClearForces();
+		reference.SetAutoClearForces(true);
+	}
+	EXPECT_EQ(referencePtr->GetPosition(), bodyPtr->GetPosition());
+	EXPECT_EQ(30u, physics.GetStats().steps);
+	EXPECT_EQ(1u, physics.GetStats().bodyCount);
+}
+TEST(PhysicsWorldTest, ForcesAreClearedAfterTheStep)
+{
+	d2d::PhysicsWorld physics{ MakeDef(2) };
+	b2Body* bodyPtr{ AddBody(physics.GetWorld(), 0.0f) };
+	bodyPtr->ApplyForceToCenter({ 100.0f, 0.0f }, true);
+	physics.Step(DT);
+	const float velocity{ bodyPtr->GetLinearVelocity().x };
+	physics.Step(DT);
+	EXPECT_EQ(velocity, bodyPtr->GetLinearVelocity().x);
+}
+TEST(PhysicsWorldTest, AsyncStepsMatchSyncSteps)
+{
+	d2d::PhysicsWorld syncPhysics{ MakeDef(2) };
+	d2d::PhysicsWorld asyncPhysics{ MakeDef(2) };
+	for(int i = 0; i < 16; ++i)
+	{
+		AddBody(syncPhysics.GetWorld(), (float)i);
+		AddBody(asyncPhysics.GetWorld(), (float)i);
+	}
+	for(int i = 0; i < 60; ++i)
+	{
+		syncPhysics.Step(DT);
+		asyncPhysics.StepAsync(DT);
+		EXPECT_TRUE(asyncPhysics.IsStepping());
+		asyncPhysics.WaitForStep();
+		EXPECT_FALSE(asyncPhysics.IsStepping());
+	}
+	const std::span<const d2d::BodyTransform> expected{ syncPhysics.GetTransforms() };
+	const std::span<const d2d::BodyTransform> actual{ asyncPhysics.GetTransforms() };
+	ASSERT_EQ(16u, actual.size());
+	for(size_t i = 0; i < actual.size(); ++i)
+	{
+		EXPECT_EQ(expected[i].position, actual[i].position);
+		EXPECT_EQ(expected[i].angle, actual[i].angle);
+	}
+	EXPECT_EQ(60u, asyncPhysics.GetStats().steps);
+}
+TEST(PhysicsWorldTest, TransformsStayOnThePublishedStepWhileStepping)
+{
+	d2d::PhysicsWorld physics{ MakeDef(1) };
+	AddBody(physics.GetWorld(), 0.0f);
+	physics.Step(DT);
+	const b2Vec2 published{ physics.GetTransforms()[0].position };
+
+	physics.StepAsync(DT);
+	EXPECT_EQ(published, physics.GetTransforms()[0].position);
+	physics.WaitForStep();
+	EXPECT_NE(published, physics.GetTransforms()[0].position);
+}
+TEST(PhysicsWorldTest, DestroyedBodiesLeaveNullTransforms)
+{
+	d2d::PhysicsWorld physics{ MakeDef(1) };
+	std::vector<b2Body*> bodies;
+	for(int i = 0; i < 4; ++i)
+		bodies.push_back(AddBody(physics.GetWorld(), (float)i));
+	physics.StepAsync(DT);
+	physics.WaitForStep();
+
+	physics.DestroyBody(bodies[1]);
+	physics.DestroyBody(bodies[3]);
+	unsigned numNull{ 0 };
+	for(const d2d::BodyTransform& transform : physics.GetTransforms())
+	{
+		if(!transform.bodyPtr)
+			++numNull;
+		else
+			EXPECT_TRUE(transform.bodyPtr == bodies[0] || transform.bodyPtr == bodies[2]);
+	}
+	EXPECT_EQ(2u, numNull);
+
+	physics.Step(DT);
+	EXPECT_EQ(2u, physics.GetTransforms().size());
+	EXPECT_EQ(2u, physics.GetStats().bodyCount);
+}
@@ -0,0 +1,98 @@
+/**************************************************************************************\
+** File: d2RandomBench.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Benchmarks comparing RandomStream with the std::mt19937 it replaced
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Random.h"
+#include <benchmark/benchmark.h>
+namespace
+{
+	const d2d::Range<float> FLOAT_RANGE{ -1.0f, 1.0f };
+	const d2d::Range<int> INT_RANGE{ 0, 99 };
+
+	// The old RandomFloat: a global mt19937 and a distribution built per call
+	void BM_Mt19937Float(benchmark::State& state)
+	{
+		std::mt19937 engine{ (unsigned)d2d::DEFAULT_RANDOM_SEED };
+		for(auto _ : state)
+		{
+			std::uniform_real_distribution<float> distribution{ FLOAT_RANGE.GetMin(), FLOAT_RANGE.GetMax() };
+			benchmark::DoNotOptimize(distribution(engine));
+		}
+		state.SetItemsProcessed(state.iterations());
+	}
+	BENCHMARK(BM_Mt19937Float);
+
+	void BM_RandomStreamFloat(benchmark::State& state)
+	{
+		d2d::RandomStream stream;
+		for(auto _ : state)
+			benchmark::DoNotOptimize(stream.NextFloat(FLOAT_RANGE));
+		state.SetItemsProcessed(state.iterations());
+	}
+	BENCHMARK(BM_RandomStreamFloat);
+
+	// Through the thread_local default stream, as game code calls it
+	void BM_RandomFloat(benchmark::State& state)
+	{
+		for(auto _ : state)
+			benchmark::DoNotOptimize(d2d::RandomFloat(FLOAT_RANGE));
+		state.SetItemsProcessed(state.iterations());
+	}
+	BENCHMARK(BM_RandomFloat);
+
+	void BM_Mt19937Int(benchmark::State& state)
+	{
+		std::mt19937 engine{ (unsigned)d2d::DEFAULT_RANDOM_SEED };
+		for(auto _ : state)
+		{
+			std::uniform_int_distribution<int> distribution{ INT_RANGE.GetMin(), INT_RANGE.GetMax() };
+			benchmark::DoNotOptimize(distribution(engine));
+		}
+		state.SetItemsProcessed(state.iterations());
+	}
+	BENCHMARK(BM_Mt19937Int);
+
+	void BM_RandomStreamInt(benchmark::State& state)
+	{
+		d2d::RandomStream stream;
+		for(auto _ : state)
+			benchmark::DoNotOptimize(stream.NextInt(INT_RANGE));
+		state.SetItemsProcessed(state.iterations());
+	}
+	BENCHMARK(BM_RandomStreamInt);
+
+	// Bulk fills, arg is the value count
+	void BM_Mt19937FillFloats(benchmark::State& state)
+	{
+		std::mt19937 engine{ (unsigned)d2d::DEFAULT_RANDOM_SEED };
+		std::uniform_real_distribution<float> distribution{ FLOAT_RANGE.GetMin(), FLOAT_RANGE.GetMax() };
+		std::vector<float> values((size_t)state.range(0));
+		for(auto _ : state)
+		{
+			for(float& value : values)
+				value = distribution(engine);
+			benchmark::DoNotOptimize(values.data());
+		}
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+	}
+	BENCHMARK(BM_Mt19937FillFloats)->Arg(4096);
+
+	void BM_RandomStreamFillFloats(benchmark::State& state)
+	{
+		d2d::RandomStream stream;
+		std::vector<float> values((size_t)state.range(0));
+		for(auto _ : state)
+		{
+			stream.Fill(values, FLOAT_RANGE);
+			benchmark::DoNotOptimize(values.data());
+		}
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+	}
+	BENCHMARK(BM_RandomStreamFillFloats)->Arg(4096);
+}
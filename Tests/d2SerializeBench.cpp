@@ -0,0 +1,84 @@
+/**************************************************************************************\
+** File: d2SerializeBench.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Encode and decode throughput benchmarks for the bit-packed serializer
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Serialize.h"
+#include <benchmark/benchmark.h>
+namespace
+{
+	const d2d::Rect WORLD_RECT{ { -1000.0f, -1000.0f }, { 1000.0f, 1000.0f } };
+	struct EntityState
+	{
+		Uint32 id;
+		b2Vec2 position;
+		float angle;
+		b2Vec2 velocity;
+		bool thrusting;
+		Uint16 health;
+		static auto fields()
+		{
+			return std::make_tuple(
+				d2d::MakeField(&EntityState::id),
+				d2d::MakeQuantizedField(&EntityState::position, WORLD_RECT, 18),
+				d2d::MakeAngleField(&EntityState::angle, 10),
+				d2d::MakeQuantizedField(&EntityState::velocity, d2d::Rect{ { -50.0f, -50.0f }, { 50.0f, 50.0f } }, 12),
+				d2d::MakeField(&EntityState::thrusting),
+				d2d::MakeBitsField(&EntityState::health, 10));
+		}
+	};
+	// Arg is entities per message
+	std::vector<EntityState> MakeEntities(size_t count)
+	{
+		std::vector<EntityState> entities(count);
+		for(size_t i = 0; i < count; ++i)
+			entities[i] = { (Uint32)i, { (float)i, -(float)i }, 0.01f * (float)i, { 1.0f, 2.0f }, (i & 1) != 0, 500 };
+		return entities;
+	}
+
+	void BM_SerializeEncode(benchmark::State& state)
+	{
+		const std::vector<EntityState> entities{ MakeEntities((size_t)state.range(0)) };
+		d2d::NetworkMessage message;
+		for(auto _ : state)
+		{
+			message.Clear();
+			d2d::BitWriter writer{ message.GetBuffer() };
+			for(const EntityState& entity : entities)
+				d2d::Serialize(writer, entity);
+			writer.Finish();
+			benchmark::DoNotOptimize(message.GetBuffer().data());
+		}
+		state.SetItemsProcessed(state.iterations());
+		state.SetBytesProcessed(state.iterations() * (Sint64)message.GetSize());
+		state.counters["bytesPerEntity"] = (double)message.GetSize() / (double)entities.size();
+	}
+	BENCHMARK(BM_SerializeEncode)->Arg(1)->Arg(100);
+
+	void BM_SerializeDecode(benchmark::State& state)
+	{
+		std::vector<EntityState> entities{ MakeEntities((size_t)state.range(0)) };
+		d2d::NetworkMessage message;
+		{
+			d2d::BitWriter writer{ message.GetBuffer() };
+			for(const EntityState& entity : entities)
+				d2d::Serialize(writer, entity);
+			writer.Finish();
+		}
+		for(auto _ : state)
+		{
+			d2d::BitReader reader{ message.GetPayload() };
+			for(EntityState& entity : entities)
+				d2d::Deserialize(reader, entity);
+			benchmark::DoNotOptimize(entities.data());
+		}
+		state.SetItemsProcessed(state.iterations());
+		state.SetBytesProcessed(state.iterations() * (Sint64)message.GetSize());
+	}
+	BENCHMARK(BM_SerializeDecode)->Arg(1)->Arg(100);
+}
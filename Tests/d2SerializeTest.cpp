@@ -0,0 +1,173 @@
+/**************************************************************************************\
+** File: d2SerializeTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Round-trip tests for the bit-packed serializer
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Serialize.h"
+#include <gtest/gtest.h>
+namespace
+{
+	const d2d::Rect WORLD_RECT{ { -100.0f, -50.0f }, { 100.0f, 50.0f } };
+
+	enum class Team : Uint8 { RED, GREEN, BLUE };
+	struct Inventory
+	{
+		Uint16 ammo;
+		Sint32 credits;
+		static auto fields()
+		{
+			return std::make_tuple(d2d::MakeField(&Inventory::ammo), d2d::MakeField(&Inventory::credits));
+		}
+	};
+	struct ShipState
+	{
+		b2Vec2 position;
+		float angle;
+		float throttle;
+		bool thrusting;
+		Uint16 health;
+		Team team;
+		Uint64 id;
+		double score;
+		b2Vec2 velocity;
+		Inventory inventory;
+		static auto fields()
+		{
+			return std::make_tuple(
+				d2d::MakeQuantizedField(&ShipState::position, WORLD_RECT, 16),
+				d2d::MakeAngleField(&ShipState::angle, 10),
+				d2d::MakeQuantizedField(&ShipState::throttle, d2d::Range<float>{ 0.0f, 1.0f }, 8),
+				d2d::MakeField(&ShipState::thrusting),
+				d2d::MakeBitsField(&ShipState::health, 10),
+				d2d::MakeBitsField(&ShipState::team, 2),
+				d2d::MakeField(&ShipState::id),
+				d2d::MakeField(&ShipState::score),
+				d2d::MakeField(&ShipState::velocity),
+				d2d::MakeField(&ShipState::inventory));
+		}
+	};
+	ShipState MakeShip(float seed)
+	{
+		return { { 12.5f * seed, -7.25f }, 1.0f + seed, 0.3f, true, 1000, Team::BLUE,
+			0x0123456789ABCDEFull, -2.5e100, { seed, -seed }, { 513, -70000 } };
+	}
+	// Quantization error is at most half a step
+	float GetHalfStep(float rangeSize, unsigned numBits)
+	{
+		return 0.5f * rangeSize / (float)d2d::GetMaxQuantizedStep(numBits) * 1.0001f;
+	}
+}
+TEST(SerializeTest, BitsRoundTripAtEveryWidth)
+{
+	std::vector<Uint8> buffer;
+	d2d::BitWriter writer{ buffer };
+	for(unsigned numBits = 1; numBits <= 32; ++numBits)
+		writer.WriteBits(0xA5A5A5A5u, numBits);
+	writer.Finish();
+
+	d2d::BitReader reader{ buffer };
+	for(unsigned numBits = 1; numBits <= 32; ++numBits)
+	{
+		Uint32 expected{ numBits == 32 ? 0xA5A5A5A5u : 0xA5A5A5A5u & ((1u << numBits) - 1) };
+		EXPECT_EQ(expected, reader.ReadBits(numBits)) << numBits << " bits";
+	}
+	reader.AlignToByte();
+	EXPECT_TRUE(reader.IsAtEnd());
+}
+TEST(SerializeTest, OutputIsLittleEndian)
+{
+	std::vector<Uint8> buffer;
+	d2d::BitWriter writer{ buffer };
+	writer.WriteBits(0x04030201u, 32);
+	writer.Finish();
+	EXPECT_EQ((std::vector<Uint8>{ 1, 2, 3, 4 }), buffer);
+}
+TEST(SerializeTest, SchemaRoundTrip)
+{
+	const ShipState original{ MakeShip(1.0f) };
+	d2d::NetworkMessage message;
+	d2d::SerializeTo(message, original);
+
+	ShipState copy{};
+	d2d::DeserializeFrom(message, copy);
+	EXPECT_NEAR(original.position.x, copy.position.x, GetHalfStep(200.0f, 16));
+	EXPECT_NEAR(original.position.y, copy.position.y, GetHalfStep(100.0f, 16));
+	EXPECT_NEAR(original.angle, copy.angle, GetHalfStep(d2d::TWO_PI, 10));
+	EXPECT_NEAR(original.throttle, copy.throttle, GetHalfStep(1.0f, 8));
+	EXPECT_EQ(original.thrusting, copy.thrusting);
+	EXPECT_EQ(original.health, copy.health);
+	EXPECT_EQ(original.team, copy.team);
+	EXPECT_EQ(original.id, copy.id);
+	EXPECT_EQ(original.score, copy.score);
+	EXPECT_EQ(original.velocity.x, copy.velocity.x);
+	EXPECT_EQ(original.velocity.y, copy.velocity.y);
+	EXPECT_EQ(original.inventory.ammo, copy.inventory.ammo);
+	EXPECT_EQ(original.inventory.credits, copy.inventory.credits);
+}
+TEST(SerializeTest, SchemaSizeIsPacked)
+{
+	d2d::NetworkMessage message;
+	d2d::SerializeTo(message, MakeShip(1.0f));
+
+	// 32 + 10 + 8 + 1 + 10 + 2 + 64 + 64 + 64 + 16 + 32 bits
+	EXPECT_EQ((303u + 7) / 8, message.GetSize());
+}
+TEST(SerializeTest, ConsecutiveObjectsStartOnByteBoundaries)
+{
+	d2d::NetworkMessage message;
+	for(int i = 0; i < 3; ++i)
+		d2d::SerializeTo(message, MakeShip((float)i));
+
+	d2d::BitReader reader{ message.GetPayload() };
+	for(int i = 0; i < 3; ++i)
+	{
+		ShipState copy{};
+		d2d::Deserialize(reader, copy);
+		reader.AlignToByte();
+		EXPECT_EQ(-(float)i, copy.velocity.y);
+	}
+	EXPECT_TRUE(reader.IsAtEnd());
+}
+TEST(SerializeTest, QuantizedFloatsClampToRange)
+{
+	const d2d::Range<float> range{ -1.0f, 1.0f };
+	EXPECT_EQ(0u, d2d::QuantizeFloat(-5.0f, range, 8));
+	EXPECT_EQ(255u, d2d::QuantizeFloat(5.0f, range, 8));
+	EXPECT_EQ(-1.0f, d2d::DequantizeFloat(0, range, 8));
+	EXPECT_EQ(1.0f, d2d::DequantizeFloat(255, range, 8));
+}
+TEST(SerializeTest, QuantizedFloatErrorIsWithinHalfStep)
+{
+	const d2d::Range<float> range{ -3.0f, 9.0f };
+	for(unsigned numBits : { 4u, 12u, 20u })
+		for(float value = -3.0f; value <= 9.0f; value += 0.0137f)
+		{
+			float decoded{ d2d::DequantizeFloat(d2d::QuantizeFloat(value, range, numBits), range, numBits) };
+			EXPECT_NEAR(value, decoded, GetHalfStep(range.GetSize(), numBits));
+		}
+}
+TEST(SerializeTest, AnglesWrapAroundTheCircle)
+{
+	// Just below 2pi rounds up to the step for 0
+	EXPECT_EQ(0u, d2d::QuantizeAngle(d2d::TWO_PI - 0.0001f, 10));
+	EXPECT_EQ(d2d::QuantizeAngle(1.0f, 10), d2d::QuantizeAngle(1.0f + d2d::TWO_PI, 10));
+	EXPECT_EQ(d2d::QuantizeAngle(1.0f, 10), d2d::QuantizeAngle(1.0f - d2d::TWO_PI, 10));
+	float decoded{ d2d::DequantizeAngle(d2d::GetMaxQuantizedStep(10), 10) };
+	EXPECT_GE(decoded, 0.0f);
+	EXPECT_LT(decoded, d2d::TWO_PI);
+}
+TEST(SerializeTest, TruncatedDataThrows)
+{
+	d2d::NetworkMessage message;
+	d2d::SerializeTo(message, MakeShip(1.0f));
+	std::vector<Uint8> truncated{ message.GetPayload().begin(), message.GetPayload().end() - 1 };
+
+	d2d::BitReader reader{ truncated };
+	ShipState copy{};
+	EXPECT_THROW(d2d::Deserialize(reader, copy), d2d::SerializationException);
+}
@@ -0,0 +1,159 @@
+/**************************************************************************************\
+** File: d2ShapeFactoryBench.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Benchmarks for loading body files and building shapes from models
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2NumberManip.h"
+#include "d2ShapeFactory.h"
+#include <benchmark/benchmark.h>
+#include <filesystem>
+namespace
+{
+	const b2Vec2 SPAWN_SIZE{ 2.0f, 1.0f };
+
+	// Worlds are replaced after this many bodies so memory stays flat
+	const int BODIES_PER_WORLD{ 4096 };
+
+	std::string GetTempPath(const std::string& fileName)
+	{
+		return (std::filesystem::temp_directory_path() / ("d2dBench_" + fileName)).string();
+	}
+
+	// Bodies named model0, model1... each made of numPolygons hexagons, like traced sprites
+	std::string MakeBodyXml(unsigned numBodies, unsigned numPolygons)
+	{
+		std::string xml{ "<bodydef><bodies>" };
+		for(unsigned b = 0; b < numBodies; ++b)
+		{
+			xml += "<body name=\"model" + std::to_string(b) + "\" width=\"64\" height=\"64\"><fixtureGroups>"
+				"<fixtureGroup type=\"POLYGON\"><polygons>";
+			for(unsigned p = 0; p < numPolygons; ++p)
+			{
+				xml += "<polygon>";
+				for(unsigned v = 0; v < 6; ++v)
+				{
+					const float angle{ (float)v * d2d::TWO_PI / 6.0f };
+					xml += "<point x=\"" + std::to_string(32.0f + 8.0f * std::cos(angle) + (float)(p % 4))
+						+ "\" y=\"" + std::to_string(32.0f + 8.0f * std::sin(angle) + (float)(p / 4)) + "\"/>";
+				}
+				xml += "</polygon>";
+			}
+			xml += "</polygons></fixtureGroup></fixtureGroups></body>";
+		}
+		return xml + "</bodies></bodydef>";
+	}
+	d2d::ShapeFactory LoadModel(unsigned numPolygons)
+	{
+		const std::string filePath{ GetTempPath("model.xml") };
+		std::ofstream{ filePath, std::ios::binary | std::ios::trunc } << MakeBodyXml(1, numPolygons);
+		d2d::ShapeFactory factory;
+		factory.LoadFrom(filePath);
+		std::filesystem::remove(filePath);
+		return factory;
+	}
+
+	// Loading 256 bodies of 16 polygons. Arg is 0 for XML, 1 for the binary format.
+	void BM_LoadBodyFile(benchmark::State& state)
+	{
+		const std::string xmlPath{ GetTempPath("bodies.xml") };
+		const std::string binaryPath{ GetTempPath("bodies.bin") };
+		std::ofstream{ xmlPath, std::ios::binary | std::ios::trunc } << MakeBodyXml(256, 16);
+		{
+			d2d::ShapeFactory converter;
+			converter.LoadFrom(xmlPath);
+			converter.SaveBinary(binaryPath);
+		}
+		const std::string& filePath{ state.range(0) ? binaryPath : xmlPath };
+		d2d::ShapeFactory factory;
+		for(auto _ : state)
+			factory.LoadFrom(filePath);
+		state.SetBytesProcessed(state.iterations() * (Sint64)std::filesystem::file_size(filePath));
+		std::filesystem::remove(xmlPath);
+		std::filesystem::remove(binaryPath);
+	}
+	BENCHMARK(BM_LoadBodyFile)->ArgName("binary")->Arg(0)->Arg(1);
+
+	// Arg 0 is the polygon count. Arg 1 is 1 to reuse the same arguments,
+	//	so every call after the first hits the cache, or 0 to give each call
+	//	a new angle, so every call builds its shapes.
+	void BM_AddShapes(benchmark::State& state)
+	{
+		d2d::ShapeFactory factory{ LoadModel((unsigned)state.range(0)) };
+		const d2d::ModelHandle model{ factory.GetModelHandle("model0") };
+		const bool reuse{ state.range(1) != 0 };
+		b2BodyDef bodyDef;
+		bodyDef.type = b2_dynamicBody;
+		auto worldPtr{ std::make_unique<b2World>(b2Vec2_zero) };
+		int numBodies{ 0 };
+		float angle{ 0.0f };
+		for(auto _ : state)
+		{
+			if(++numBodies == BODIES_PER_WORLD)
+			{
+				state.PauseTiming();
+				worldPtr = std::make_unique<b2World>(b2Vec2_zero);
+				numBodies = 0;
+				state.ResumeTiming();
+			}
+			if(!reuse)
+				angle += 0.001f;
+			b2Body* bodyPtr{ worldPtr->CreateBody(&bodyDef) };
+			benchmark::DoNotOptimize(factory.AddShapes(*bodyPtr, SPAWN_SIZE, model,
+				d2d::Material{}, d2d::Filter{}, false, b2Vec2_zero, angle));
+		}
+		state.SetItemsProcessed(state.iterations());
+		const d2d::ShapeCacheStats& stats{ factory.GetShapeCacheStats() };
+		state.counters["hitRate"] = (double)stats.hits / (double)std::max<Uint64>(stats.hits + stats.misses, 1);
+	}
+	BENCHMARK(BM_AddShapes)->ArgNames({ "polygons", "reuse" })
+		->Args({ 4, 0 })->Args({ 4, 1 })->Args({ 32, 0 })->Args({ 32, 1 });
+
+	// Spawning a wave of bodies from one model. Arg 0 is the body count,
+	//	arg 1 is 0 for a CreateBody and AddShapes per body, 1 for SpawnBodies.
+	void BM_SpawnBodies(benchmark::State& state)
+	{
+		d2d::ShapeFactory factory{ LoadModel(8) };
+		const d2d::ModelHandle model{ factory.GetModelHandle("model0") };
+		const size_t numBodies{ (size_t)state.range(0) };
+		std::vector<d2d::BodySpawn> spawns(numBodies);
+		for(size_t i = 0; i < numBodies; ++i)
+			spawns[i] = { { (float)(i % 100), (float)(i / 100) }, 0.01f * (float)i, { 1.0f, 0.0f }, 0.5f };
+		std::vector<b2Body*> bodies(numBodies);
+		std::vector<b2Fixture*> fixtures(numBodies * factory.GetFixtureCount(model));
+		b2BodyDef bodyDef;
+		bodyDef.type = b2_dynamicBody;
+		const d2d::Material material;
+		const d2d::Filter filter;
+		for(auto _ : state)
+		{
+			state.PauseTiming();
+			auto worldPtr{ std::make_unique<b2World>(b2Vec2_zero) };
+			state.ResumeTiming();
+			if(state.range(1))
+				factory.SpawnBodies(*worldPtr, bodyDef, model, SPAWN_SIZE, material, filter, spawns, bodies, fixtures);
+			else
+				for(size_t i = 0; i < numBodies; ++i)
+				{
+					b2BodyDef instanceDef{ bodyDef };
+					instanceDef.position = spawns[i].position;
+					instanceDef.angle = spawns[i].angle;
+					instanceDef.linearVelocity = spawns[i].linearVelocity;
+					instanceDef.angularVelocity = spawns[i].angularVelocity;
+					bodies[i] = worldPtr->CreateBody(&instanceDef);
+					benchmark::DoNotOptimize(factory.AddShapes(*bodies[i], SPAWN_SIZE, model, material, filter));
+				}
+			benchmark::DoNotOptimize(bodies.data());
+			state.PauseTiming();
+			worldPtr.reset();
+			state.ResumeTiming();
+		}
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+	}
+	BENCHMARK(BM_SpawnBodies)->ArgNames({ "bodies", "batch" })
+		->Args({ 1000, 0 })->Args({ 1000, 1 });
+}
@@ -0,0 +1,192 @@
+/**************************************************************************************\
+** File: d2ShapeFactoryTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Tests for ShapeFactory loading and its shape cache
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2ShapeFactory.h"
+#include "d2Utility.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+namespace
+{
+	const char BODY_XML[]{
+		"<bodydef><bodies>\n"
+		"<body name=\"rock\" width=\"100\" height=\"50\"><fixtureGroups>\n"
+		"<fixtureGroup type=\"POLYGON\"><polygons>\n"
+		"<polygon><point x=\"0\" y=\"0\"/><point x=\"50\" y=\"0\"/><point x=\"50\" y=\"25\"/></polygon>\n"
+		"<polygon><point x=\"0\" y=\"0\"/><point x=\"50\" y=\"25\"/><point x=\"0\" y=\"25\"/></polygon>\n"
+		"</polygons></fixtureGroup>\n"
+		"<fixtureGroup type=\"CIRCLE\"><circle r=\"10\" x=\"20\" y=\"20\"/></fixtureGroup>\n"
+		"</fixtureGroups></body>\n"
+		"<body name=\"ship\" width=\"10\" height=\"10\"><fixtureGroups>\n"
+		"<fixtureGroup type=\"CIRCLE\"><circle r=\"5\" x=\"5\" y=\"5\"/></fixtureGroup>\n"
+		"</fixtureGroups></body>\n"
+		"</bodies></bodydef>\n" };
+
+	std::string GetTempPath(const std::string& fileName)
+	{
+		return (std::filesystem::temp_directory_path() / ("d2dTest_" + fileName)).string();
+	}
+	void WriteFile(const std::string& filePath, const void* data, size_t numBytes)
+	{
+		std::ofstream outStream{ filePath, std::ios::binary | std::ios::trunc };
+		outStream.write((const char*)data, (std::streamsize)numBytes);
+	}
+	std::vector<Uint8> ReadFile(const std::string& filePath)
+	{
+		std::ifstream inStream{ filePath, std::ios::binary };
+		return { std::istreambuf_iterator<char>{ inStream }, std::istreambuf_iterator<char>{} };
+	}
+
+	class ShapeFactoryTest : public ::testing::Test
+	{
+	protected:
+		ShapeFactoryTest()
+		{
+			WriteFile(m_xmlPath, BODY_XML, sizeof(BODY_XML) - 1);
+			m_factory.LoadFrom(m_xmlPath);
+			m_rock = m_factory.GetModelHandle("rock");
+		}
+		~ShapeFactoryTest()
+		{
+			std::filesystem::remove(m_xmlPath);
+		}
+		size_t AddRock(float angle)
+		{
+			b2BodyDef bodyDef;
+			b2Body* bodyPtr{ m_world.CreateBody(&bodyDef) };
+			return m_factory.AddShapes(*bodyPtr, { 2.0f, 1.0f }, m_rock, d2d::Material{}, d2d::Filter{},
+				false, b2Vec2_zero, angle).size();
+		}
+
+		const std::string m_xmlPath{ GetTempPath("bodies.xml") };
+		b2World m_world{ b2Vec2_zero };
+		d2d::ShapeFactory m_factory;
+		d2d::ModelHandle m_rock;
+	};
+}
+TEST_F(ShapeFactoryTest, LoadsXmlModels)
+{
+	EXPECT_EQ(2u, m_factory.GetModelCount());
+	const d2d::Body& rock{ m_factory.GetModel(m_rock) };
+	EXPECT_EQ(100.0f, rock.sourceImageSize.x);
+	ASSERT_EQ(2u, rock.fixtureGroups.size());
+	EXPECT_EQ(2u, rock.polygons.size());
+	EXPECT_EQ(0.5f, rock.polygons[0].vertices[1].x);
+	EXPECT_EQ(0.5f, rock.polygons[0].vertices[2].y);
+	EXPECT_TRUE(rock.fixtureGroups[1].isCircle);
+	EXPECT_EQ(0.1f, rock.fixtureGroups[1].circle.radiusRelativeToWidth);
+	EXPECT_EQ(3u, m_factory.GetFixtureCount(m_rock));
+}
+TEST_F(ShapeFactoryTest, RepeatedArgumentsHitTheCache)
+{
+	EXPECT_EQ(3u, AddRock(0.5f));
+	EXPECT_EQ(3u, AddRock(0.5f));
+	EXPECT_EQ(3u, AddRock(0.5f));
+	const d2d::ShapeCacheStats& stats{ m_factory.GetShapeCacheStats() };
+	EXPECT_EQ(1u, stats.misses);
+	EXPECT_EQ(2u, stats.hits);
+	EXPECT_EQ(1u, stats.entries);
+}
+TEST_F(ShapeFactoryTest, FullCacheIsFlushedNotFrozen)
+{
+	m_factory.SetShapeCacheCapacity(4);
+	for(int i = 0; i < 10; ++i)
+		EXPECT_EQ(3u, AddRock((float)i));
+	const d2d::ShapeCacheStats& stats{ m_factory.GetShapeCacheStats() };
+	EXPECT_EQ(10u, stats.misses);
+	EXPECT_EQ(2u, stats.flushes);
+	EXPECT_EQ(2u, stats.entries);
+
+	// Arguments first seen after the cache filled up are still cached
+	AddRock(9.0f);
+	EXPECT_EQ(1u, stats.hits);
+}
+TEST_F(ShapeFactoryTest, ReloadingAModelDropsItsCachedShapes)
+{
+	AddRock(0.0f);
+	m_factory.LoadFrom(m_xmlPath);
+	EXPECT_EQ(m_rock, m_factory.GetModelHandle("rock"));
+	EXPECT_EQ(0u, m_factory.GetShapeCacheStats().entries);
+	AddRock(0.0f);
+	EXPECT_EQ(2u, m_factory.GetShapeCacheStats().misses);
+}
+TEST_F(ShapeFactoryTest, BinaryRoundTrip)
+{
+	const std::string binaryPath{ GetTempPath("bodies.bin") };
+	m_factory.SaveBinary(binaryPath);
+	d2d::ShapeFactory loaded;
+	loaded.LoadFrom(binaryPath);
+	std::filesystem::remove(binaryPath);
+
+	ASSERT_EQ(2u, loaded.GetModelCount());
+	const d2d::Body& original{ m_factory.GetModel(m_rock) };
+	const d2d::Body& copy{ loaded.GetModel(loaded.GetModelHandle("rock")) };
+	EXPECT_EQ(original.sourceImageSize, copy.sourceImageSize);
+	ASSERT_EQ(original.polygons.size(), copy.polygons.size());
+	for(size_t p = 0; p < original.polygons.size(); ++p)
+		for(unsigned v = 0; v < original.polygons[p].numVertices; ++v)
+			EXPECT_EQ(original.polygons[p].vertices[v], copy.polygons[p].vertices[v]);
+}
+TEST_F(ShapeFactoryTest, FailedBinaryLoadKeepsLoadedModels)
+{
+	const std::string binaryPath{ GetTempPath("bodies.bin") };
+	m_factory.SaveBinary(binaryPath);
+	const std::vector<Uint8> data{ ReadFile(binaryPath) };
+
+	// Cut inside the second body, after the first one parsed
+	d2d::ShapeFactory loaded;
+	WriteFile(binaryPath, data.data(), data.size() - 6);
+	EXPECT_THROW(loaded.LoadFrom(binaryPath), d2d::InitException);
+	EXPECT_EQ(0u, loaded.GetModelCount());
+
+	AddRock(0.0f);
+	EXPECT_THROW(m_factory.LoadFrom(binaryPath), d2d::InitException);
+	std::filesystem::remove(binaryPath);
+	EXPECT_EQ(2u, m_factory.GetModelCount());
+	EXPECT_EQ(2u, m_factory.GetModel(m_rock).polygons.size());
+	EXPECT_EQ(1u, m_factory.GetShapeCacheStats().entries);
+}
+TEST_F(ShapeFactoryTest, FailedXmlLoadKeepsLoadedModels)
+{
+	const char badXml[]{ "<bodies><body name=\"rock\" width=\"10\" height=\"10\"></body>"
+		"<body name=\"ship\" width=\"ten\" height=\"10\"></body></bodies>" };
+	const std::string badPath{ GetTempPath("bad.xml") };
+	WriteFile(badPath, badXml, sizeof(badXml) - 1);
+	EXPECT_THROW(m_factory.LoadFrom(badPath), d2d::InitException);
+	std::filesystem::remove(badPath);
+	EXPECT_EQ(100.0f, m_factory.GetModel(m_rock).sourceImageSize.x);
+	EXPECT_EQ(2u, m_factory.GetModel(m_rock).polygons.size());
+}
+TEST_F(ShapeFactoryTest, CorruptBinaryCountsAndTypesThrow)
+{
+	const std::string binaryPath{ GetTempPath("bodies.bin") };
+	m_factory.SaveBinary(binaryPath);
+	const std::vector<Uint8> data{ ReadFile(binaryPath) };
+
+	// The first body is "rock": its name, then two floats, then the group count and first group type
+	const char rockName[]{ "rock" };
+	const auto nameIt{ std::search(data.begin(), data.end(), rockName, rockName + 4) };
+	ASSERT_NE(data.end(), nameIt);
+	const size_t groupCountOffset{ (size_t)(nameIt - data.begin()) + 4 + 2 * sizeof(float) };
+	const size_t groupTypeOffset{ groupCountOffset + sizeof(Uint32) };
+
+	// A count this large would reserve about 100 GB
+	std::vector<Uint8> hugeCount{ data };
+	std::fill_n(hugeCount.begin() + (ptrdiff_t)groupCountOffset, sizeof(Uint32), (Uint8)0xFF);
+	WriteFile(binaryPath, hugeCount.data(), hugeCount.size());
+	d2d::ShapeFactory loaded;
+	EXPECT_THROW(loaded.LoadFrom(binaryPath), d2d::InitException);
+
+	std::vector<Uint8> unknownType{ data };
+	unknownType[groupTypeOffset] = 7;
+	WriteFile(binaryPath, unknownType.data(), unknownType.size());
+	EXPECT_THROW(loaded.LoadFrom(binaryPath), d2d::InitException);
+	std::filesystem::remove(binaryPath);
+	EXPECT_EQ(0u, loaded.GetModelCount());
+}
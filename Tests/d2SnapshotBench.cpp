@@ -0,0 +1,49 @@
+/**************************************************************************************\
+** File: d2SnapshotBench.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Bytes per tick and encode time for snapshot replication
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Snapshot.h"
+#include <benchmark/benchmark.h>
+namespace
+{
+	const d2d::ConnectionID CLIENT_ID{ 0 };
+
+	// Arg 0 is the entity count, arg 1 the percentage of entities that move each tick
+	void BM_SnapshotTick(benchmark::State& state)
+	{
+		const unsigned numEntities{ (unsigned)state.range(0) };
+		const unsigned movingStride{ state.range(1) > 0 ? (unsigned)(100 / state.range(1)) : numEntities + 1 };
+		d2d::SnapshotServer server;
+		d2d::SnapshotClient client;
+		server.AddClient(CLIENT_ID);
+		for(unsigned i = 0; i < numEntities; ++i)
+			server.SetEntity(i, { { (float)(i % 100), (float)(i / 100) }, 0.0f, { 1.0f, 0.0f }, 0.0f });
+
+		d2d::NetworkMessage message;
+		d2d::NetworkMessage ack;
+		float time{ 0.0f };
+		size_t totalBytes{ 0 };
+		for(auto _ : state)
+		{
+			time += 1.0f / 60.0f;
+			for(unsigned i = 0; i < numEntities; i += movingStride)
+				server.SetEntity(i, { { (float)(i % 100) + time, (float)(i / 100) }, time, { 1.0f, 0.0f }, 0.0f });
+			server.Capture();
+			server.WriteSnapshot(CLIENT_ID, message);
+			client.ReadSnapshot(message);
+			client.WriteAck(ack);
+			server.ReadAck(CLIENT_ID, ack);
+			totalBytes += message.GetSize();
+		}
+		state.SetItemsProcessed(state.iterations());
+		state.counters["bytesPerTick"] = (double)totalBytes / (double)state.iterations();
+	}
+	BENCHMARK(BM_SnapshotTick)->ArgNames({ "entities", "movingPct" })
+		->Args({ 1000, 0 })->Args({ 1000, 10 })->Args({ 1000, 100 });
+}
@@ -0,0 +1,125 @@
+/**************************************************************************************\
+** File: d2SnapshotTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Tests for delta-compressed snapshot replication
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Snapshot.h"
+#include <gtest/gtest.h>
+namespace
+{
+	const d2d::ConnectionID CLIENT_ID{ 3 };
+
+	d2d::EntityState MakeEntity(unsigned slot)
+	{
+		return { { 1.5f * slot, -2.0f * slot }, 0.25f * slot, { 0.5f, -0.5f }, 1.0f };
+	}
+	class SnapshotTest : public ::testing::Test
+	{
+	protected:
+		SnapshotTest()
+		{
+			m_server.AddClient(CLIENT_ID);
+			for(unsigned slot = 0; slot < 8; ++slot)
+				m_server.SetEntity(slot, MakeEntity(slot));
+		}
+		// Captures, sends to the client and acks back
+		void RoundTrip()
+		{
+			m_server.Capture();
+			d2d::NetworkMessage message;
+			m_server.WriteSnapshot(CLIENT_ID, message);
+			ASSERT_TRUE(m_client.ReadSnapshot(message));
+			m_client.WriteAck(message);
+			ASSERT_TRUE(m_server.ReadAck(CLIENT_ID, message));
+		}
+
+		d2d::SnapshotServer m_server;
+		d2d::SnapshotClient m_client;
+	};
+}
+TEST_F(SnapshotTest, ClientDecodesServerState)
+{
+	RoundTrip();
+	m_server.SetEntity(2, MakeEntity(20));
+	m_server.RemoveEntity(5);
+	RoundTrip();
+
+	EXPECT_EQ(8u, m_client.GetSlotCount());
+	d2d::EntityState state;
+	ASSERT_TRUE(m_client.GetEntity(2, state));
+	EXPECT_NEAR(30.0f, state.position.x, 0.01f);
+	EXPECT_NEAR(-40.0f, state.position.y, 0.01f);
+	EXPECT_NEAR(0.5f, state.velocity.x, 0.01f);
+	EXPECT_FALSE(m_client.GetEntity(5, state));
+	EXPECT_EQ(m_client.GetLatestSequence(), m_server.GetAckedSequence(CLIENT_ID));
+}
+TEST_F(SnapshotTest, UnchangedSlotsCostOneBit)
+{
+	RoundTrip();
+	m_server.Capture();
+	d2d::NetworkMessage message;
+	m_server.WriteSnapshot(CLIENT_ID, message);
+
+	// Two sequence numbers and the slot count, then one bit per slot
+	EXPECT_EQ((32u + 32u + 20u + 8u + 7u) / 8, message.GetSize());
+}
+TEST_F(SnapshotTest, MalformedAcksAreIgnored)
+{
+	RoundTrip();
+	const Uint32 acked{ m_server.GetAckedSequence(CLIENT_ID) };
+	m_server.Capture();
+
+	const Uint8 shortAck[]{ 2, 0, 0 };
+	const Uint8 longAck[]{ 2, 0, 0, 0, 0 };
+	EXPECT_FALSE(m_server.ReadAck(CLIENT_ID, d2d::NetworkMessage{}));
+	EXPECT_FALSE(m_server.ReadAck(CLIENT_ID, d2d::NetworkMessage{ shortAck, sizeof(shortAck) }));
+	EXPECT_FALSE(m_server.ReadAck(CLIENT_ID, d2d::NetworkMessage{ longAck, sizeof(longAck) }));
+	EXPECT_EQ(acked, m_server.GetAckedSequence(CLIENT_ID));
+}
+TEST_F(SnapshotTest, AcksCannotMoveBackOrAhead)
+{
+	RoundTrip();
+	RoundTrip();
+	const Uint32 acked{ m_server.GetAckedSequence(CLIENT_ID) };
+
+	const Uint8 oldAck[]{ 1, 0, 0, 0 };
+	const Uint8 futureAck[]{ 99, 0, 0, 0 };
+	EXPECT_TRUE(m_server.ReadAck(CLIENT_ID, d2d::NetworkMessage{ oldAck, sizeof(oldAck) }));
+	EXPECT_TRUE(m_server.ReadAck(CLIENT_ID, d2d::NetworkMessage{ futureAck, sizeof(futureAck) }));
+	EXPECT_EQ(acked, m_server.GetAckedSequence(CLIENT_ID));
+}
+TEST_F(SnapshotTest, AcksFromUnknownClientsAreIgnored)
+{
+	const Uint8 ack[]{ 1, 0, 0, 0 };
+	m_server.Capture();
+	EXPECT_FALSE(m_server.ReadAck(CLIENT_ID + 1, d2d::NetworkMessage{ ack, sizeof(ack) }));
+	m_server.RemoveClient(CLIENT_ID);
+	EXPECT_FALSE(m_server.ReadAck(CLIENT_ID, d2d::NetworkMessage{ ack, sizeof(ack) }));
+}
+TEST_F(SnapshotTest, AcksForUnsentSnapshotsAreIgnored)
+{
+	RoundTrip();
+	const Uint32 acked{ m_server.GetAckedSequence(CLIENT_ID) };
+
+	// Captured but never written to this client
+	const Uint32 skipped{ m_server.Capture() };
+	const Uint8 skippedAck[]{ (Uint8)skipped, 0, 0, 0 };
+	EXPECT_TRUE(m_server.ReadAck(CLIENT_ID, d2d::NetworkMessage{ skippedAck, sizeof(skippedAck) }));
+	EXPECT_EQ(acked, m_server.GetAckedSequence(CLIENT_ID));
+
+	// Written to another client only
+	m_server.AddClient(CLIENT_ID + 1);
+	const Uint32 otherOnly{ m_server.Capture() };
+	d2d::NetworkMessage message;
+	m_server.WriteSnapshot(CLIENT_ID + 1, message);
+	const Uint8 otherAck[]{ (Uint8)otherOnly, 0, 0, 0 };
+	EXPECT_TRUE(m_server.ReadAck(CLIENT_ID, d2d::NetworkMessage{ otherAck, sizeof(otherAck) }));
+	EXPECT_EQ(acked, m_server.GetAckedSequence(CLIENT_ID));
+	EXPECT_TRUE(m_server.ReadAck(CLIENT_ID + 1, d2d::NetworkMessage{ otherAck, sizeof(otherAck) }));
+	EXPECT_EQ(otherOnly, m_server.GetAckedSequence(CLIENT_ID + 1));
+}
@@ -0,0 +1,143 @@
+/**************************************************************************************\
+** File: d2UdpConnectionTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Tests for UdpConnection over a SimulatedLink with loss, latency and jitter
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2UdpConnection.h"
+#include <gtest/gtest.h>
+namespace
+{
+	const Uint32 TICK_MILLISECONDS{ 5 };
+
+	// Connection 0 sends, connection 1 receives; both are updated every tick
+	class UdpConnectionTest : public ::testing::Test
+	{
+	protected:
+		explicit UdpConnectionTest(const d2d::UdpConnectionDef& def = d2d::UdpConnectionDef{})
+			: m_sender{ m_link.GetEndpoint(0), m_link.GetAddress(1), def },
+			  m_receiver{ m_link.GetEndpoint(1), m_link.GetAddress(0), def }
+		{}
+		void Tick()
+		{
+			m_time += TICK_MILLISECONDS;
+			m_link.SetTime(m_time);
+			m_sender.Update(m_time);
+			m_receiver.Update(m_time);
+			d2d::NetworkMessage message;
+			while(m_receiver.Receive(message))
+			{
+				ASSERT_EQ(sizeof(Uint32), message.GetSize());
+				Uint32 value;
+				std::memcpy(&value, message.GetPayload().data(), sizeof(value));
+				m_received.push_back(value);
+			}
+		}
+		// Ticks until done() or the time limit, in simulated milliseconds
+		template <typename Predicate> bool TickUntil(Predicate done, Uint32 limitMilliseconds = 60000)
+		{
+			const Uint32 endTime{ m_time + limitMilliseconds };
+			while(!done() && m_time < endTime)
+				Tick();
+			return done();
+		}
+		void QueueValue(Uint32 value, d2d::UdpChannel channel)
+		{
+			Uint8 payload[sizeof(value)];
+			std::memcpy(payload, &value, sizeof(value));
+			m_sender.Queue(payload, channel);
+		}
+		void ExpectReceivedInOrder(Uint32 count)
+		{
+			ASSERT_EQ(count, m_received.size());
+			for(Uint32 i = 0; i < count; ++i)
+				if(m_received[i] != i)
+				{
+					ADD_FAILURE() << "message " << i << " arrived as " << m_received[i];
+					return;
+				}
+		}
+
+		d2d::SimulatedLink m_link{ { 20.0f, 30, 40 } };
+		d2d::UdpConnection m_sender;
+		d2d::UdpConnection m_receiver;
+		Uint32 m_time{ 0 };
+		std::vector<Uint32> m_received;
+	};
+
+	// A window that does not divide the 16-bit ID space
+	class UdpConnectionWrapTest : public UdpConnectionTest
+	{
+	protected:
+		UdpConnectionWrapTest() : UdpConnectionTest{ { 1200, 100, 1000 } } {}
+	};
+}
+TEST_F(UdpConnectionTest, ReliableMessagesArriveInOrderUnderLoss)
+{
+	const Uint32 NUM_MESSAGES{ 500 };
+	for(Uint32 i = 0; i < NUM_MESSAGES; ++i)
+	{
+		QueueValue(i, d2d::UdpChannel::RELIABLE_ORDERED);
+		if(i % 10 == 9)
+			Tick();
+	}
+	ASSERT_TRUE(TickUntil([&] { return m_received.size() >= NUM_MESSAGES; }));
+	ExpectReceivedInOrder(NUM_MESSAGES);
+	EXPECT_GT(m_link.GetDroppedCount(), 0u);
+	EXPECT_GT(m_sender.GetStats().reliableResends, 0u);
+}
+TEST_F(UdpConnectionTest, EveryReliableMessageIsAcked)
+{
+	for(Uint32 i = 0; i < 300; ++i)
+	{
+		QueueValue(i, d2d::UdpChannel::RELIABLE_ORDERED);
+		Tick();
+	}
+	ASSERT_TRUE(TickUntil([&] { return m_sender.GetUnackedReliableCount() == 0; }));
+	EXPECT_FALSE(m_sender.IsReliableWindowFull());
+	ExpectReceivedInOrder(300);
+
+	// Resends of acked messages are not delivered twice
+	TickUntil([] { return false; }, 1000);
+	EXPECT_EQ(300u, m_received.size());
+	EXPECT_GT(m_sender.GetStats().packetsAcked, 0u);
+	EXPECT_GT(m_sender.GetStats().roundTripMilliseconds, 0.0f);
+}
+TEST_F(UdpConnectionTest, UnreliableMessagesAreDroppedNotRetried)
+{
+	const Uint32 NUM_MESSAGES{ 400 };
+	m_link.SetDef({ 50.0f, 30, 40 });
+	for(Uint32 i = 0; i < NUM_MESSAGES; ++i)
+	{
+		QueueValue(i, d2d::UdpChannel::UNRELIABLE);
+		Tick();
+	}
+	TickUntil([] { return false; }, 2000);
+
+	EXPECT_EQ(NUM_MESSAGES, m_sender.GetStats().messagesSent);
+	EXPECT_EQ(0u, m_sender.GetStats().reliableResends);
+	EXPECT_GT(m_received.size(), 0u);
+	EXPECT_LT(m_received.size(), NUM_MESSAGES);
+	std::vector<Uint32> sorted{ m_received };
+	std::sort(sorted.begin(), sorted.end());
+	EXPECT_EQ(sorted.end(), std::adjacent_find(sorted.begin(), sorted.end()));
+}
+TEST_F(UdpConnectionWrapTest, ReliableIDsWrapAround)
+{
+	// Past 65535 with the window kept full, so IDs on both sides of the
+	//	wrap are in flight together
+	const Uint32 NUM_MESSAGES{ 70000 };
+	m_link.SetDef({ 5.0f, 20, 20 });
+	Uint32 numQueued{ 0 };
+	ASSERT_TRUE(TickUntil([&]
+	{
+		while(numQueued < NUM_MESSAGES && !m_sender.IsReliableWindowFull())
+			QueueValue(numQueued++, d2d::UdpChannel::RELIABLE_ORDERED);
+		return m_received.size() >= NUM_MESSAGES && m_sender.GetUnackedReliableCount() == 0;
+	}, 600000));
+	ExpectReceivedInOrder(NUM_MESSAGES);
+}
@@ -0,0 +1,105 @@
+/**************************************************************************************\
+** File: d2VfsBench.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Benchmarks comparing loading assets from loose files and from a packed archive
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Vfs.h"
+#include <benchmark/benchmark.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+namespace
+{
+	const int NUM_FILES{ 500 };
+	const int NUM_LINES_PER_FILE{ 60 };
+
+	std::filesystem::path GetDirectory()
+	{
+		return std::filesystem::temp_directory_path() / "d2VfsBench";
+	}
+	const std::string& GetArchivePath()
+	{
+		static const std::string archivePath{ (GetDirectory() / "assets.d2pk").string() };
+		return archivePath;
+	}
+	// HJSON-like text, so the archive compresses it as it would real assets
+	const std::vector<std::string>& GetFilePaths()
+	{
+		static std::vector<std::string> filePaths;
+		if(filePaths.empty())
+		{
+			std::filesystem::remove_all(GetDirectory());
+			std::filesystem::create_directories(GetDirectory() / "assets");
+			for(int i = 0; i < NUM_FILES; ++i)
+			{
+				filePaths.push_back((GetDirectory() / "assets" / ("entity" + std::to_string(i) + ".hjson")).generic_string());
+				std::ofstream outStream{ filePaths.back(), std::ios::binary | std::ios::trunc };
+				for(int line = 0; line < NUM_LINES_PER_FILE; ++line)
+					outStream << "\tproperty" << line << ": " << (i * 31 + line) % 997 << "\n";
+			}
+			d2d::WriteArchive(GetArchivePath(), d2d::GetArchiveSources((GetDirectory() / "assets").string()));
+		}
+		return filePaths;
+	}
+	// Drops the files from the page cache, so the next read goes to the disk
+	void EvictFile(const std::string& filePath)
+	{
+#ifndef _WIN32
+		int fd{ open(filePath.c_str(), O_RDONLY) };
+		if(fd != -1)
+		{
+			fdatasync(fd);
+			posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+			close(fd);
+		}
+#endif
+	}
+	void LoadAll(benchmark::State& state, bool cold, bool fromArchive)
+	{
+		const std::vector<std::string>& filePaths{ GetFilePaths() };
+		for(auto _ : state)
+		{
+			if(cold)
+			{
+				state.PauseTiming();
+				d2d::UnmountArchives();
+				for(const std::string& filePath : filePaths)
+					EvictFile(filePath);
+				EvictFile(GetArchivePath());
+				state.ResumeTiming();
+			}
+			if(fromArchive && cold)
+				d2d::MountArchive(GetArchivePath());
+			size_t numBytes{ 0 };
+			for(const std::string& filePath : filePaths)
+				numBytes += d2d::OpenFile(filePath).GetBytes().size();
+			benchmark::DoNotOptimize(numBytes);
+		}
+		state.SetItemsProcessed(state.iterations() * NUM_FILES);
+	}
+
+	// Arg 1 evicts every file from the page cache before each iteration
+	void BM_LoadLooseFiles(benchmark::State& state)
+	{
+		d2d::UnmountArchives();
+		LoadAll(state, state.range(0) != 0, false);
+	}
+	BENCHMARK(BM_LoadLooseFiles)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+	// Mounting is timed in the cold case, since a cold start pays for it
+	void BM_LoadFromArchive(benchmark::State& state)
+	{
+		GetFilePaths();
+		d2d::UnmountArchives();
+		d2d::MountArchive(GetArchivePath());
+		LoadAll(state, state.range(0) != 0, true);
+		d2d::UnmountArchives();
+	}
+	BENCHMARK(BM_LoadFromArchive)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+}
@@ -0,0 +1,173 @@
+/**************************************************************************************\
+** File: d2VfsTest.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Tests for packed archives and the virtual file system
+**
+\**************************************************************************************/
+#include "d2pch.h"
+#include "d2Vfs.h"
+#include "d2Compression.h"
+#include "d2Utility.h"
+#include <gtest/gtest.h>
+namespace
+{
+	class VfsTest : public ::testing::Test
+	{
+	protected:
+		VfsTest()
+			: m_directory{ std::filesystem::temp_directory_path() / "d2VfsTest" }
+		{
+			std::filesystem::remove_all(m_directory);
+			std::filesystem::create_directories(m_directory / "assets" / "sub");
+			m_archivePath = (m_directory / "assets.d2pk").string();
+
+			for(int i = 0; i < 200; ++i)
+				m_textContents += "a line of text that compresses well\n";
+			std::mt19937 engine{ 7 };
+			for(int i = 0; i < 5000; ++i)
+				m_binaryContents.push_back((char)engine());
+			m_textPath = WriteFile("assets/text.txt", m_textContents);
+			m_binaryPath = WriteFile("assets/sub/noise.bin", m_binaryContents);
+			m_emptyPath = WriteFile("assets/empty.txt", "");
+		}
+		~VfsTest()
+		{
+			d2d::UnmountArchives();
+			d2d::SetLooseFileOverride(false);
+			std::filesystem::remove_all(m_directory);
+		}
+		std::string WriteFile(const std::string& fileName, const std::string& contents)
+		{
+			const std::string filePath{ (m_directory / fileName).generic_string() };
+			std::ofstream{ filePath, std::ios::binary | std::ios::trunc } << contents;
+			return filePath;
+		}
+		void WriteAssetsArchive()
+		{
+			d2d::WriteArchive(m_archivePath, d2d::GetArchiveSources((m_directory / "assets").string()));
+		}
+
+		std::filesystem::path m_directory;
+		std::string m_archivePath;
+		std::string m_textContents;
+		std::string m_binaryContents;
+		std::string m_textPath;
+		std::string m_binaryPath;
+		std::string m_emptyPath;
+	};
+}
+TEST_F(VfsTest, ArchiveHoldsEveryFile)
+{
+	WriteAssetsArchive();
+	const d2d::Archive archive{ m_archivePath };
+	ASSERT_EQ(3u, archive.GetEntries().size());
+	EXPECT_TRUE(std::is_sorted(archive.GetEntries().begin(), archive.GetEntries().end(),
+		[](const d2d::ArchiveEntry& a, const d2d::ArchiveEntry& b) { return a.path < b.path; }));
+	for(const d2d::ArchiveEntry& entry : archive.GetEntries())
+		EXPECT_EQ(0u, entry.offset % d2d::ARCHIVE_ALIGNMENT) << entry.path;
+
+	const d2d::ArchiveEntry* textEntryPtr{ archive.Find(m_textPath) };
+	ASSERT_NE(nullptr, textEntryPtr);
+	EXPECT_TRUE(textEntryPtr->IsCompressed());
+	EXPECT_LT(textEntryPtr->storedSize, m_textContents.size() / 4);
+
+	const d2d::ArchiveEntry* binaryEntryPtr{ archive.Find(m_binaryPath) };
+	ASSERT_NE(nullptr, binaryEntryPtr);
+	EXPECT_FALSE(binaryEntryPtr->IsCompressed());
+	const std::span<const Uint8> stored{ archive.GetStoredBytes(*binaryEntryPtr) };
+	EXPECT_EQ(m_binaryContents, std::string(stored.begin(), stored.end()));
+
+	EXPECT_EQ(nullptr, archive.Find(m_textPath + "x"));
+}
+TEST_F(VfsTest, OpenFileReadsMountedArchives)
+{
+	WriteAssetsArchive();
+	d2d::MountArchive(m_archivePath);
+	std::filesystem::remove_all(m_directory / "assets");
+
+	EXPECT_EQ(m_textContents, d2d::OpenFile(m_textPath).GetText());
+	EXPECT_EQ(m_binaryContents, d2d::OpenFile(m_binaryPath).GetText());
+	EXPECT_TRUE(d2d::OpenFile(m_emptyPath).GetBytes().empty());
+	EXPECT_EQ(m_textContents, d2d::FileToString(m_textPath));
+}
+TEST_F(VfsTest, LooseFilesOverrideOnlyWhenEnabled)
+{
+	WriteAssetsArchive();
+	d2d::MountArchive(m_archivePath);
+	WriteFile("assets/text.txt", "edited");
+
+	EXPECT_EQ(m_textContents, d2d::OpenFile(m_textPath).GetText());
+	d2d::SetLooseFileOverride(true);
+	EXPECT_EQ("edited", d2d::OpenFile(m_textPath).GetText());
+	EXPECT_EQ(m_binaryContents, d2d::OpenFile(m_binaryPath).GetText());
+}
+TEST_F(VfsTest, FilesMissingFromArchivesAreReadFromDisk)
+{
+	WriteAssetsArchive();
+	d2d::MountArchive(m_archivePath);
+	const std::string otherPath{ WriteFile("other.txt", "loose") };
+	EXPECT_EQ("loose", d2d::OpenFile(otherPath).GetText());
+	EXPECT_THROW(d2d::OpenFile((m_directory / "missing.txt").string()), d2d::FileException);
+}
+TEST_F(VfsTest, NewestMountWins)
+{
+	WriteAssetsArchive();
+	d2d::MountArchive(m_archivePath);
+	const std::string patchPath{ (m_directory / "patch.d2pk").string() };
+	const std::string patchedPath{ WriteFile("patched.txt", "patched") };
+	const d2d::ArchiveSource patch[]{ { m_textPath, patchedPath } };
+	d2d::WriteArchive(patchPath, patch);
+	d2d::MountArchive(patchPath);
+
+	EXPECT_EQ("patched", d2d::OpenFile(m_textPath).GetText());
+	EXPECT_EQ(m_binaryContents, d2d::OpenFile(m_binaryPath).GetText());
+}
+TEST_F(VfsTest, PathsAreNormalized)
+{
+	const d2d::ArchiveSource sources[]{ { "./dir\\file.txt", m_textPath } };
+	d2d::WriteArchive(m_archivePath, sources);
+	d2d::MountArchive(m_archivePath);
+	EXPECT_EQ(m_textContents, d2d::OpenFile("dir/file.txt").GetText());
+	EXPECT_EQ(m_textContents, d2d::OpenFile("./dir\\file.txt").GetText());
+
+	const d2d::ArchiveSource twice[]{ { "a.txt", m_textPath }, { "./a.txt", m_binaryPath } };
+	EXPECT_THROW(d2d::WriteArchive(m_archivePath + "2", twice), d2d::FileException);
+}
+TEST_F(VfsTest, BadArchivesThrow)
+{
+	WriteAssetsArchive();
+	std::vector<Uint8> bytes;
+	d2d::ReadFile(m_archivePath, bytes);
+
+	const std::string truncatedPath{ WriteFile("truncated.d2pk", std::string(bytes.begin(), bytes.begin() + 40)) };
+	EXPECT_THROW(d2d::MountArchive(truncatedPath), d2d::FileException);
+	const std::string notArchivePath{ WriteFile("text.d2pk", m_textContents) };
+	EXPECT_THROW(d2d::MountArchive(notArchivePath), d2d::FileException);
+
+	// The entry count follows the magic and version. A count that the bytes
+	//	after it can't hold, at 21 bytes per entry, is rejected up front.
+	std::vector<Uint8> badCount{ bytes };
+	const Uint32 entryCount{ SDL_SwapLE32((Uint32)((bytes.size() - 12) / 21 + 1)) };
+	std::memcpy(badCount.data() + 8, &entryCount, sizeof(entryCount));
+	const std::string badCountPath{ WriteFile("badcount.d2pk", std::string(badCount.begin(), badCount.end())) };
+	try
+	{
+		d2d::MountArchive(badCountPath);
+		ADD_FAILURE() << "Mounted an archive with a bad entry count";
+	}
+	catch(const d2d::FileException& e)
+	{
+		EXPECT_NE(std::string::npos, std::string{ e.what() }.find("bad entry count"));
+	}
+
+	// Corrupt the compressed text entry
+	const d2d::Archive archive{ m_archivePath };
+	const d2d::ArchiveEntry& entry{ *archive.Find(m_textPath) };
+	std::fill(bytes.begin() + (ptrdiff_t)entry.offset, bytes.begin() + (ptrdiff_t)(entry.offset + entry.storedSize), (Uint8)0xFF);
+	const std::string corruptPath{ WriteFile("corrupt.d2pk", std::string(bytes.begin(), bytes.end())) };
+	d2d::MountArchive(corruptPath);
+	EXPECT_THROW(d2d::OpenFile(m_textPath), d2d::FileException);
+}